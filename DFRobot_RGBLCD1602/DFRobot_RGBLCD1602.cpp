@@ -138,7 +138,7 @@ void DFRobot_RGBLCD1602::customSymbol(uint8_t location, uint8_t charmap[]) {
   command(LCD_SETCGRAMADDR | (location << 3));
 
   uint8_t data[9];
-  data[0] = 0x40;
+  data[0] = LCD_CONTROL_DATA;
   for (int i = 0; i < 8; i++) {
     data[i + 1] = charmap[i];
   }
@@ -147,7 +147,7 @@ void DFRobot_RGBLCD1602::customSymbol(uint8_t location, uint8_t charmap[]) {
 
 void DFRobot_RGBLCD1602::setCursor(uint8_t col, uint8_t row) {
   col = (row == 0 ? col | 0x80 : col | 0xc0);
-  uint8_t data[3] = {0x80, col};
+  uint8_t data[3] = {LCD_CONTROL_COMMAND, col};
 
   send(data, 2);
 }
@@ -180,13 +180,49 @@ void DFRobot_RGBLCD1602::setColor(uint8_t color) {
 
 inline size_t DFRobot_RGBLCD1602::write(uint8_t value) {
 
-  uint8_t data[3] = {0x40, value};
-  send(data, 2);
+  uint8_t data[3] = {LCD_CONTROL_DATA, value};
+  send(data, 2, LCD_DATA_TIME_US);
   return 1; // assume sucess
 }
 
+size_t DFRobot_RGBLCD1602::writeRun(const char *data_p, size_t len) {
+  uint8_t data[1 + LCD_MAX_RUN];
+  size_t written = 0;
+
+  data[0] = LCD_CONTROL_DATA;
+  while (written < len) {
+    size_t run = len - written;
+    if (run > LCD_MAX_RUN) {
+      run = LCD_MAX_RUN;
+    }
+    memcpy(data + 1, data_p + written, run);
+    send(data, 1 + run, LCD_DATA_TIME_US);
+    written += run;
+  }
+  return written;
+}
+
+size_t DFRobot_RGBLCD1602::writeRunAt(uint8_t col, uint8_t row,
+                                      const char *data_p, size_t len) {
+  uint8_t data[3 + LCD_MAX_RUN];
+
+  if (len > LCD_MAX_RUN) {
+    setCursor(col, row);
+    return writeRun(data_p, len);
+  }
+
+  ///< the command byte is followed by the 0x40 control byte, which gives the
+  ///< controller more than the 37 us it needs before the first character
+  data[0] = LCD_CONTROL_COMMAND;
+  data[1] = (row == 0 ? col | 0x80 : col | 0xc0);
+  data[2] = LCD_CONTROL_DATA;
+  memcpy(data + 3, data_p, len);
+  send(data, 3 + len, len ? LCD_DATA_TIME_US : LCD_EXEC_TIME_US);
+  return len;
+}
+
 inline void DFRobot_RGBLCD1602::command(uint8_t value) {
-  uint8_t data[3] = {0x80, value};
+  uint8_t data[3] = {LCD_CONTROL_COMMAND, value};
   send(data, 2);
 }
 
@@ -209,8 +245,7 @@ void DFRobot_RGBLCD1602::printf(const char *fmt_p, ...) {
   vsnprintf(buffer, 50, fmt_p, argptr);
   va_end(argptr);
 
-  for (int i = 0; i < strlen(buffer); i++)
-    write(buffer[i]);
+  writeRun(buffer, strlen(buffer));
 }
 
 /*******************************private*******************************/
@@ -279,14 +314,15 @@ void DFRobot_RGBLCD1602::begin(uint8_t rows, uint8_t charSize) {
   setColorWhite();
 }
 
-void DFRobot_RGBLCD1602::send(uint8_t *data_p, uint8_t len) {
+void DFRobot_RGBLCD1602::send(uint8_t *data_p, uint8_t len, uint16_t execUs) {
   static uint32_t failed = 0;
 
   if (_i2c_p->write(_lcdAddr8b, (char *)data_p, len) != 0) {
     std::printf("DFRobot_RGBLCD1602::send(addr=0x%x) failed #%u\n",
                 (_lcdAddr7b << 1), ++failed);
   }
-  ThisThread::sleep_for(1ms);
+  ///< wait for the last byte to execute instead of a fixed 1 ms sleep
+  wait_us(execUs);
 }
 
 void DFRobot_RGBLCD1602::setReg(uint8_t addr, uint8_t data) {
@@ -104,6 +104,29 @@ the hardware version
 #define LCD_5x10DOTS 0x04
 #define LCD_5x8DOTS 0x00
 
+/*!
+ *  @brief I2C control bytes, Co = 0 so every following byte is a command or
+ *  data byte, Co = 1 when another control byte follows the next byte
+ */
+#define LCD_CONTROL_COMMAND 0x80
+#define LCD_CONTROL_DATA 0x40
+
+/*!
+ *  @brief execution times from the HD44780 datasheet at fOSC = 270 kHz.
+ *  A data write takes 37 us plus 4 us to update the address counter.
+ *  Clear display and return home take 1.52 ms and are handled by clear() and
+ *  home(). On a 100 kHz bus one byte takes 90 us, which is longer than a
+ *  data write, so a run of characters can be streamed in one transaction.
+ */
+#define LCD_EXEC_TIME_US 37
+#define LCD_DATA_TIME_US 41
+
+/*!
+ *  @brief longest run of characters sent in one I2C transaction, one full
+ *  DDRAM line
+ */
+#define LCD_MAX_RUN 40
+
 class DFRobot_RGBLCD1602 {
 public:
   /**
@@ -269,6 +292,28 @@ public:
    */
   virtual size_t write(uint8_t data);
 
+  /**
+   * @fn writeRun
+   * @brief write a run of characters at the current cursor position in one
+   * I2C transaction
+   * @param data_p the characters to write
+   * @param len number of characters, runs longer than LCD_MAX_RUN are split
+   * @return number of characters written
+   */
+  size_t writeRun(const char *data_p, size_t len);
+
+  /**
+   * @fn writeRunAt
+   * @brief set the cursor and write a run of characters in the same I2C
+   * transaction
+   * @param col columns optional range 0-15
+   * @param row rows optional range 0-1
+   * @param data_p the characters to write
+   * @param len number of characters
+   * @return number of characters written
+   */
+  size_t writeRunAt(uint8_t col, uint8_t row, const char *data_p, size_t len);
+
   /**
    * @fn command
    * @brief send command
@@ -297,11 +342,12 @@ private:
 
   /**
    * @fn send
-   * @brief set cursor
+   * @brief send one I2C transaction to the LCD controller
    * @param data_p the data to send
    * @param len length of the data
+   * @param execUs time the controller needs to execute the last byte
    */
-  void send(uint8_t *data_p, uint8_t len);
+  void send(uint8_t *data_p, uint8_t len, uint16_t execUs = LCD_EXEC_TIME_US);
 
   /**
    * @fn setReg
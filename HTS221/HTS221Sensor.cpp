@@ -45,7 +45,8 @@
 /* Class Implementation ------------------------------------------------------*/
 
 HTS221Sensor::HTS221Sensor(SPI *spi, PinName cs_pin, PinName drdy_pin) :
-    _dev_spi(spi), _cs_pin(cs_pin), _drdy_pin(drdy_pin)  // SPI3W ONLY
+    _dev_spi(spi), _cs_pin(cs_pin), _drdy_pin(drdy_pin), _drdy_connected(drdy_pin != NC),
+    _calib_loaded(false)  // SPI3W ONLY
 {
     assert(spi);
     _dev_i2c = NULL;
@@ -56,7 +57,8 @@ HTS221Sensor::HTS221Sensor(SPI *spi, PinName cs_pin, PinName drdy_pin) :
  * @param address the address of the component's instance
  */
 HTS221Sensor::HTS221Sensor(DevI2C *i2c, uint8_t address, PinName drdy_pin) :
-    _dev_i2c(i2c), _address(address), _cs_pin(NC), _drdy_pin(drdy_pin)
+    _dev_i2c(i2c), _address(address), _cs_pin(NC), _drdy_pin(drdy_pin),
+    _drdy_connected(drdy_pin != NC), _calib_loaded(false)
 {
     assert(i2c);
     _dev_spi = NULL;
@@ -83,6 +85,32 @@ int HTS221Sensor::init(void *init)
         return 1;
     }
 
+    if (load_calibration() != 0) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  Read the factory calibration coefficients and keep them, so a
+ *         sample only needs the output registers to be read.
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::load_calibration(void)
+{
+    HTS221_Calibration_st calib;
+
+    if (HTS221_Get_Calibration((void *)this, &calib) == HTS221_ERROR) {
+        return 1;
+    }
+
+    if (HTS221_Get_Conversion(&calib, &_conv) == HTS221_ERROR) {
+        return 1;
+    }
+
+    _calib_loaded = true;
+
     return 0;
 }
 
@@ -165,14 +193,13 @@ int HTS221Sensor::reset(void)
  */
 int HTS221Sensor::get_humidity(float *pfData)
 {
-    uint16_t uint16data = 0;
+    uint16_t permille = 0;
 
-    /* Read data from HTS221. */
-    if (HTS221_Get_Humidity((void *)this, &uint16data) == HTS221_ERROR) {
+    if (get_humidity_permille(&permille) != 0) {
         return 1;
     }
 
-    *pfData = (float)uint16data / 10.0f;
+    *pfData = (float)permille / 10.0f;
 
     return 0;
 }
@@ -184,14 +211,144 @@ int HTS221Sensor::get_humidity(float *pfData)
  */
 int HTS221Sensor::get_temperature(float *pfData)
 {
-    int16_t int16data = 0;
+    int16_t centi = 0;
+
+    if (get_temperature_centi(&centi) != 0) {
+        return 1;
+    }
+
+    *pfData = (float)centi / 100.0f;
+
+    return 0;
+}
+
+/**
+ * @brief  Read humidity and temperature with one burst of the output registers
+ * @param  humidity the pointer to the humidity output
+ * @param  temperature the pointer to the temperature output
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::get_measurement(float *humidity, float *temperature)
+{
+    uint16_t permille = 0;
+    int16_t centi = 0;
+
+    if (get_measurement_fixed(&permille, &centi) != 0) {
+        return 1;
+    }
+
+    *humidity = (float)permille / 10.0f;
+    *temperature = (float)centi / 100.0f;
+
+    return 0;
+}
+
+/**
+ * @brief  Read HTS221 output register, and calculate the humidity without
+ *         floating point
+ * @param  permille the pointer to the humidity output in [permille]
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::get_humidity_permille(uint16_t *permille)
+{
+    int16_t raw = 0;
+
+    if (!_calib_loaded && load_calibration() != 0) {
+        return 1;
+    }
 
     /* Read data from HTS221. */
-    if (HTS221_Get_Temperature((void *)this, &int16data) == HTS221_ERROR) {
+    if (HTS221_Get_HumidityRaw((void *)this, &raw) == HTS221_ERROR) {
         return 1;
     }
 
-    *pfData = (float)int16data / 10.0f;
+    HTS221_Calc_Humidity_Permille(&_conv, raw, permille);
+
+    return 0;
+}
+
+/**
+ * @brief  Read HTS221 output register, and calculate the temperature without
+ *         floating point
+ * @param  centi the pointer to the temperature output in ['C/100]
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::get_temperature_centi(int16_t *centi)
+{
+    int16_t raw = 0;
+
+    if (!_calib_loaded && load_calibration() != 0) {
+        return 1;
+    }
+
+    /* Read data from HTS221. */
+    if (HTS221_Get_TemperatureRaw((void *)this, &raw) == HTS221_ERROR) {
+        return 1;
+    }
+
+    HTS221_Calc_Temperature_Centi(&_conv, raw, centi);
+
+    return 0;
+}
+
+/**
+ * @brief  Read humidity and temperature with one burst of the output
+ *         registers, without floating point
+ * @param  permille the pointer to the humidity output in [permille]
+ * @param  centi the pointer to the temperature output in ['C/100]
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::get_measurement_fixed(uint16_t *permille, int16_t *centi)
+{
+    int16_t raw_h = 0, raw_t = 0;
+
+    if (!_calib_loaded && load_calibration() != 0) {
+        return 1;
+    }
+
+    /* Read HR_OUT_L..TEMP_OUT_H in one transaction. */
+    if (HTS221_Get_RawMeasurement((void *)this, &raw_h, &raw_t) == HTS221_ERROR) {
+        return 1;
+    }
+
+    HTS221_Calc_Humidity_Permille(&_conv, raw_h, permille);
+    HTS221_Calc_Temperature_Centi(&_conv, raw_t, centi);
+
+    return 0;
+}
+
+/**
+ * @brief  Enable the data ready signal on the DRDY pin, active high and
+ *         push-pull. The pin goes high when a new sample is available and
+ *         low again when the output registers have been read.
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::enable_drdy_irq(void)
+{
+    if (HTS221_Set_IrqActiveLevel((void *)this, HTS221_HIGH_LVL) == HTS221_ERROR) {
+        return 1;
+    }
+
+    if (HTS221_Set_IrqOutputType((void *)this, HTS221_PUSHPULL) == HTS221_ERROR) {
+        return 1;
+    }
+
+    if (HTS221_Set_IrqEnable((void *)this, HTS221_ENABLE) == HTS221_ERROR) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  Disable the data ready signal on the DRDY pin
+ * @retval 0 in case of success, an error code otherwise
+ */
+int HTS221Sensor::disable_drdy_irq(void)
+{
+    if (HTS221_Set_IrqEnable((void *)this, HTS221_DISABLE) == HTS221_ERROR) {
+        return 1;
+    }
 
     return 0;
 }
@@ -64,6 +64,27 @@ public:
     virtual int read_id(uint8_t *id);
     virtual int get_humidity(float *pfData);
     virtual int get_temperature(float *pfData);
+    int get_measurement(float *humidity, float *temperature);
+    int get_humidity_permille(uint16_t *permille);
+    int get_temperature_centi(int16_t *centi);
+    int get_measurement_fixed(uint16_t *permille, int16_t *centi);
+    int enable_drdy_irq(void);
+    int disable_drdy_irq(void);
+
+    /**
+     * @brief Attach a function to the rising edge of the DRDY pin.
+     * @param  func callback run in interrupt context, or nullptr to detach.
+     * @retval 0 if ok, 1 if the sensor was created without a DRDY pin.
+     */
+    int attach_drdy(Callback<void()> func)
+    {
+        if (!_drdy_connected) {
+            return 1;
+        }
+        _drdy_pin.rise(func);
+        return 0;
+    }
+    int load_calibration(void);
     int enable(void);
     int disable(void);
     int reset(void);
@@ -131,6 +152,11 @@ private:
     uint8_t _address;
     DigitalOut  _cs_pin;
     InterruptIn _drdy_pin;
+    bool _drdy_connected;
+
+    /* Integer conversion from the factory calibration, set by load_calibration() */
+    HTS221_Conversion_st _conv;
+    bool _calib_loaded;
 };
 
 #ifdef __cplusplus
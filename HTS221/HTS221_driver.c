@@ -330,38 +330,17 @@ HTS221_Error_et HTS221_Get_RawMeasurement(void *handle, int16_t *humidity, int16
 */
 HTS221_Error_et HTS221_Get_Humidity(void *handle, uint16_t *value)
 {
-    int16_t H0_T0_out, H1_T0_out, H_T_out;
-    int16_t H0_rh, H1_rh;
-    uint8_t buffer[2];
-    float   tmp_f;
-
-    if (HTS221_read_reg(handle, HTS221_H0_RH_X2, 2, buffer)) {
-        return HTS221_ERROR;
-    }
-    H0_rh = buffer[0] >> 1;
-    H1_rh = buffer[1] >> 1;
-
-    if (HTS221_read_reg(handle, HTS221_H0_T0_OUT_L, 2, buffer)) {
-        return HTS221_ERROR;
-    }
-    H0_T0_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
+    HTS221_Calibration_st calib;
+    int16_t H_T_out;
 
-    if (HTS221_read_reg(handle, HTS221_H1_T0_OUT_L, 2, buffer)) {
+    if (HTS221_Get_Calibration(handle, &calib) == HTS221_ERROR) {
         return HTS221_ERROR;
     }
-    H1_T0_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
-
-    if (HTS221_read_reg(handle, HTS221_HR_OUT_L_REG, 2, buffer)) {
+    if (HTS221_Get_HumidityRaw(handle, &H_T_out) == HTS221_ERROR) {
         return HTS221_ERROR;
     }
-    H_T_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
 
-    tmp_f = (float)(H_T_out - H0_T0_out) * (float)(H1_rh - H0_rh) / (float)(H1_T0_out - H0_T0_out)  +  H0_rh;
-    tmp_f *= 10.0f;
-
-    *value = (tmp_f > 1000.0f) ? 1000
-             : (tmp_f <    0.0f) ?    0
-             : (uint16_t)tmp_f;
+    HTS221_Calc_Humidity(&calib, H_T_out, value);
 
     return HTS221_OK;
 }
@@ -393,63 +372,173 @@ HTS221_Error_et HTS221_Get_HumidityRaw(void *handle, int16_t *value)
 */
 HTS221_Error_et HTS221_Get_Temperature(void *handle, int16_t *value)
 {
-    int16_t T0_out, T1_out, T_out, T0_degC_x8_u16, T1_degC_x8_u16;
-    int16_t T0_degC, T1_degC;
-    uint8_t buffer[4], tmp;
-    float   tmp_f;
+    HTS221_Calibration_st calib;
+    int16_t T_out;
 
-    if (HTS221_read_reg(handle, HTS221_T0_DEGC_X8, 2, buffer)) {
+    if (HTS221_Get_Calibration(handle, &calib) == HTS221_ERROR) {
         return HTS221_ERROR;
     }
-    if (HTS221_read_reg(handle, HTS221_T0_T1_DEGC_H2, 1, &tmp)) {
+    if (HTS221_Get_TemperatureRaw(handle, &T_out) == HTS221_ERROR) {
         return HTS221_ERROR;
     }
 
-    T0_degC_x8_u16 = (((uint16_t)(tmp & 0x03)) << 8) | ((uint16_t)buffer[0]);
-    T1_degC_x8_u16 = (((uint16_t)(tmp & 0x0C)) << 6) | ((uint16_t)buffer[1]);
-    T0_degC = T0_degC_x8_u16 >> 3;
-    T1_degC = T1_degC_x8_u16 >> 3;
+    HTS221_Calc_Temperature(&calib, T_out, value);
 
-    if (HTS221_read_reg(handle, HTS221_T0_OUT_L, 4, buffer)) {
-        return HTS221_ERROR;
-    }
+    return HTS221_OK;
+}
 
-    T0_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
-    T1_out = (((uint16_t)buffer[3]) << 8) | (uint16_t)buffer[2];
+/**
+* @brief  Read HTS221 temperature output registers.
+* @param  *handle Device handle.
+* @param  Pointer to the returned temperature raw value.
+* @retval Error code [HTS221_OK, HTS221_ERROR].
+*/
+HTS221_Error_et HTS221_Get_TemperatureRaw(void *handle, int16_t *value)
+{
+    uint8_t buffer[2];
 
     if (HTS221_read_reg(handle, HTS221_TEMP_OUT_L_REG, 2, buffer)) {
         return HTS221_ERROR;
     }
 
-    T_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
-
-    tmp_f = (float)(T_out - T0_out) * (float)(T1_degC - T0_degC) / (float)(T1_out - T0_out)  +  T0_degC;
-    tmp_f *= 10.0f;
-
-    *value = (int16_t)tmp_f;
+    *value = (int16_t)((((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0]);
 
     return HTS221_OK;
 }
 
 /**
-* @brief  Read HTS221 temperature output registers.
+* @brief  Read the HTS221 factory calibration registers in a single burst.
+*         The coefficients never change, so they can be read once and kept.
 * @param  *handle Device handle.
-* @param  Pointer to the returned temperature raw value.
+* @param  calib pointer to the returned calibration coefficients.
 * @retval Error code [HTS221_OK, HTS221_ERROR].
 */
-HTS221_Error_et HTS221_Get_TemperatureRaw(void *handle, int16_t *value)
+HTS221_Error_et HTS221_Get_Calibration(void *handle, HTS221_Calibration_st *calib)
 {
-    uint8_t buffer[2];
+    uint8_t buffer[HTS221_CALIB_SIZE];
+    uint16_t T0_degC_x8_u16, T1_degC_x8_u16;
 
-    if (HTS221_read_reg(handle, HTS221_TEMP_OUT_L_REG, 2, buffer)) {
+    if (HTS221_read_reg(handle, HTS221_H0_RH_X2, HTS221_CALIB_SIZE, buffer)) {
         return HTS221_ERROR;
     }
 
-    *value = (int16_t)((((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0]);
+    calib->H0_rh = buffer[HTS221_H0_RH_X2 - HTS221_H0_RH_X2] >> 1;
+    calib->H1_rh = buffer[HTS221_H1_RH_X2 - HTS221_H0_RH_X2] >> 1;
+
+    T0_degC_x8_u16 = (((uint16_t)(buffer[HTS221_T0_T1_DEGC_H2 - HTS221_H0_RH_X2] & 0x03)) << 8) |
+                     ((uint16_t)buffer[HTS221_T0_DEGC_X8 - HTS221_H0_RH_X2]);
+    T1_degC_x8_u16 = (((uint16_t)(buffer[HTS221_T0_T1_DEGC_H2 - HTS221_H0_RH_X2] & 0x0C)) << 6) |
+                     ((uint16_t)buffer[HTS221_T1_DEGC_X8 - HTS221_H0_RH_X2]);
+    calib->T0_degC = T0_degC_x8_u16 >> 3;
+    calib->T1_degC = T1_degC_x8_u16 >> 3;
+
+    calib->H0_T0_out = (int16_t)((((uint16_t)buffer[HTS221_H0_T0_OUT_H - HTS221_H0_RH_X2]) << 8) |
+                                 (uint16_t)buffer[HTS221_H0_T0_OUT_L - HTS221_H0_RH_X2]);
+    calib->H1_T0_out = (int16_t)((((uint16_t)buffer[HTS221_H1_T0_OUT_H - HTS221_H0_RH_X2]) << 8) |
+                                 (uint16_t)buffer[HTS221_H1_T0_OUT_L - HTS221_H0_RH_X2]);
+    calib->T0_out = (int16_t)((((uint16_t)buffer[HTS221_T0_OUT_H - HTS221_H0_RH_X2]) << 8) |
+                              (uint16_t)buffer[HTS221_T0_OUT_L - HTS221_H0_RH_X2]);
+    calib->T1_out = (int16_t)((((uint16_t)buffer[HTS221_T1_OUT_H - HTS221_H0_RH_X2]) << 8) |
+                              (uint16_t)buffer[HTS221_T1_OUT_L - HTS221_H0_RH_X2]);
 
     return HTS221_OK;
 }
 
+/**
+* @brief  Calculate humidity from a raw output value and the calibration coefficients.
+* @param  calib pointer to the calibration coefficients.
+* @param  raw humidity raw value.
+* @param  Pointer to the returned humidity value that must be divided by 10 to get the value in [%].
+* @retval None
+*/
+void HTS221_Calc_Humidity(const HTS221_Calibration_st *calib, int16_t raw, uint16_t *value)
+{
+    float   tmp_f;
+
+    tmp_f = (float)(raw - calib->H0_T0_out) * (float)(calib->H1_rh - calib->H0_rh) /
+            (float)(calib->H1_T0_out - calib->H0_T0_out)  +  calib->H0_rh;
+    tmp_f *= 10.0f;
+
+    *value = (tmp_f > 1000.0f) ? 1000
+             : (tmp_f <    0.0f) ?    0
+             : (uint16_t)tmp_f;
+}
+
+/**
+* @brief  Calculate temperature from a raw output value and the calibration coefficients.
+* @param  calib pointer to the calibration coefficients.
+* @param  raw temperature raw value.
+* @param  Pointer to the returned temperature value that must be divided by 10 to get the value in ['C].
+* @retval None
+*/
+void HTS221_Calc_Temperature(const HTS221_Calibration_st *calib, int16_t raw, int16_t *value)
+{
+    float   tmp_f;
+
+    tmp_f = (float)(raw - calib->T0_out) * (float)(calib->T1_degC - calib->T0_degC) /
+            (float)(calib->T1_out - calib->T0_out)  +  calib->T0_degC;
+    tmp_f *= 10.0f;
+
+    *value = (int16_t)tmp_f;
+}
+
+/**
+* @brief  Derive the integer conversion from the calibration coefficients.
+*         With the raw output limited to int16 and the calibration points to
+*         10 bits, every intermediate value of the conversion fits in 32 bits.
+* @param  calib pointer to the calibration coefficients.
+* @param  conv pointer to the returned conversion.
+* @retval Error code [HTS221_OK, HTS221_ERROR] if the calibration points are equal.
+*/
+HTS221_Error_et HTS221_Get_Conversion(const HTS221_Calibration_st *calib, HTS221_Conversion_st *conv)
+{
+    conv->h_num = (int32_t)(calib->H1_rh - calib->H0_rh) * 10;
+    conv->h_den = (int32_t)calib->H1_T0_out - calib->H0_T0_out;
+    conv->h_offset = (int32_t)calib->H0_rh * 10 * conv->h_den - (int32_t)calib->H0_T0_out * conv->h_num;
+
+    conv->t_num = (int32_t)(calib->T1_degC - calib->T0_degC) * 100;
+    conv->t_den = (int32_t)calib->T1_out - calib->T0_out;
+    conv->t_offset = (int32_t)calib->T0_degC * 100 * conv->t_den - (int32_t)calib->T0_out * conv->t_num;
+
+    if (conv->h_den == 0 || conv->t_den == 0) {
+        return HTS221_ERROR;
+    }
+
+    return HTS221_OK;
+}
+
+/**
+* @brief  Calculate humidity without floating point.
+* @param  conv pointer to the conversion from HTS221_Get_Conversion().
+* @param  raw humidity raw value.
+* @param  Pointer to the returned humidity value in [permille], limited to 0..1000.
+* @retval None
+*/
+void HTS221_Calc_Humidity_Permille(const HTS221_Conversion_st *conv, int16_t raw, uint16_t *value)
+{
+    int32_t tmp = ((int32_t)raw * conv->h_num + conv->h_offset) / conv->h_den;
+
+    *value = (tmp > 1000) ? 1000
+             : (tmp <    0) ?    0
+             : (uint16_t)tmp;
+}
+
+/**
+* @brief  Calculate temperature without floating point.
+* @param  conv pointer to the conversion from HTS221_Get_Conversion().
+* @param  raw temperature raw value.
+* @param  Pointer to the returned temperature value in ['C/100], saturated to the int16 range.
+* @retval None
+*/
+void HTS221_Calc_Temperature_Centi(const HTS221_Conversion_st *conv, int16_t raw, int16_t *value)
+{
+    int32_t tmp = ((int32_t)raw * conv->t_num + conv->t_offset) / conv->t_den;
+
+    *value = (tmp > INT16_MAX) ? INT16_MAX
+             : (tmp < INT16_MIN) ? INT16_MIN
+             : (int16_t)tmp;
+}
+
 /**
 * @brief  Get the availability of new data for humidity and temperature.
 * @param  *handle Device handle.
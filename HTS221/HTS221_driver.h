@@ -188,6 +188,33 @@ typedef struct {
     HTS221_State_et       irq_enable;       /*!< HTS221_ENABLE/HTS221_DISABLE interrupt on DRDY pin */
 } HTS221_Init_st;
 
+/**
+* @brief  HTS221 factory calibration coefficients, decoded from registers 0x30 to 0x3F.
+*/
+typedef struct {
+    int16_t   H0_rh;                        /*!< Humidity at the first calibration point [%] */
+    int16_t   H1_rh;                        /*!< Humidity at the second calibration point [%] */
+    int16_t   H0_T0_out;                    /*!< Humidity raw output at the first calibration point */
+    int16_t   H1_T0_out;                    /*!< Humidity raw output at the second calibration point */
+    int16_t   T0_degC;                      /*!< Temperature at the first calibration point ['C] */
+    int16_t   T1_degC;                      /*!< Temperature at the second calibration point ['C] */
+    int16_t   T0_out;                       /*!< Temperature raw output at the first calibration point */
+    int16_t   T1_out;                       /*!< Temperature raw output at the second calibration point */
+} HTS221_Calibration_st;
+
+/**
+* @brief  Integer conversion derived from the calibration coefficients.
+*         value = (raw * num + offset) / den, with humidity in [permille] and temperature in ['C/100].
+*/
+typedef struct {
+    int32_t   h_num;                        /*!< Humidity slope numerator */
+    int32_t   h_den;                        /*!< Humidity slope denominator */
+    int32_t   h_offset;                     /*!< Humidity offset, scaled by h_den */
+    int32_t   t_num;                        /*!< Temperature slope numerator */
+    int32_t   t_den;                        /*!< Temperature slope denominator */
+    int32_t   t_offset;                     /*!< Temperature offset, scaled by t_den */
+} HTS221_Conversion_st;
+
 /**
 * @}
 */
@@ -428,6 +455,8 @@ typedef struct {
 #define HTS221_T1_OUT_L        (uint8_t)0x3E
 #define HTS221_T1_OUT_H        (uint8_t)0x3F
 
+#define HTS221_CALIB_SIZE      (uint8_t)16
+
 
 /**
 * @}
@@ -461,6 +490,12 @@ HTS221_Error_et HTS221_Get_Humidity(void *handle, uint16_t *value);
 HTS221_Error_et HTS221_Get_HumidityRaw(void *handle, int16_t *value);
 HTS221_Error_et HTS221_Get_TemperatureRaw(void *handle, int16_t *value);
 HTS221_Error_et HTS221_Get_Temperature(void *handle, int16_t *value);
+HTS221_Error_et HTS221_Get_Calibration(void *handle, HTS221_Calibration_st *calib);
+void HTS221_Calc_Humidity(const HTS221_Calibration_st *calib, int16_t raw, uint16_t *value);
+void HTS221_Calc_Temperature(const HTS221_Calibration_st *calib, int16_t raw, int16_t *value);
+HTS221_Error_et HTS221_Get_Conversion(const HTS221_Calibration_st *calib, HTS221_Conversion_st *conv);
+void HTS221_Calc_Humidity_Permille(const HTS221_Conversion_st *conv, int16_t raw, uint16_t *value);
+void HTS221_Calc_Temperature_Centi(const HTS221_Conversion_st *conv, int16_t raw, int16_t *value);
 HTS221_Error_et HTS221_Get_DataStatus(void *handle, HTS221_BitStatus_et *humidity, HTS221_BitStatus_et *temperature);
 HTS221_Error_et HTS221_Activate(void *handle);
 HTS221_Error_et HTS221_DeActivate(void *handle);
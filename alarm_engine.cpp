@@ -0,0 +1,249 @@
+/**
+ * @file alarm_engine.cpp
+ * @brief Min-heap alarm scheduling, see alarm_engine.h
+ */
+#include "alarm_engine.h"
+
+#include <string.h>
+
+#define SECONDS_PER_DAY 86400
+// 1 January 1970 was a Thursday
+#define EPOCH_WEEKDAY 4
+
+AlarmEngine::AlarmEngine(EventQueue *queue, Handler fired, Clock clock)
+    : _queue(queue), _fired(fired), _clock(clock), _heap_size(0),
+      _clock_valid(false) {
+  memset(_alarms, 0, sizeof(_alarms));
+  memset(_used, 0, sizeof(_used));
+  memset(_where, -1, sizeof(_where));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+int AlarmEngine::add(uint8_t hour, uint8_t minute, uint8_t weekdays) {
+  if (!valid(hour, minute, weekdays)) {
+    return -1;
+  }
+  for (int id = 0; id < ALARM_MAX; id++) {
+    if (!_used[id]) {
+      _used[id] = true;
+      set(id, hour, minute, weekdays);
+      return id;
+    }
+  }
+  return -1;
+}
+
+bool AlarmEngine::set(int id, uint8_t hour, uint8_t minute,
+                      uint8_t weekdays) {
+  if (id < 0 || id >= ALARM_MAX || !_used[id] ||
+      !valid(hour, minute, weekdays)) {
+    return false;
+  }
+  Alarm *alarm = &_alarms[id];
+  alarm->hour = hour;
+  alarm->minute = minute;
+  alarm->weekdays = weekdays;
+  alarm->enabled = true;
+  schedule(id, next_time(*alarm, wall_clock()));
+  arm();
+  return true;
+}
+
+bool AlarmEngine::remove(int id) {
+  if (!enable(id, false)) {
+    return false;
+  }
+  _used[id] = false;
+  return true;
+}
+
+bool AlarmEngine::enable(int id, bool enabled) {
+  if (id < 0 || id >= ALARM_MAX || !_used[id]) {
+    return false;
+  }
+  Alarm *alarm = &_alarms[id];
+  if (enabled == alarm->enabled) {
+    return true;
+  }
+  alarm->enabled = enabled;
+  if (enabled) {
+    schedule(id, next_time(*alarm, wall_clock()));
+  } else {
+    unschedule(id);
+  }
+  arm();
+  return true;
+}
+
+bool AlarmEngine::snooze(int id, std::chrono::seconds delay) {
+  if (id < 0 || id >= ALARM_MAX || !_used[id]) {
+    return false;
+  }
+  _alarms[id].enabled = true;
+  schedule(id, wall_clock() + delay.count());
+  arm();
+  return true;
+}
+
+bool AlarmEngine::get(int id, Alarm *alarm) const {
+  if (id < 0 || id >= ALARM_MAX || !_used[id]) {
+    return false;
+  }
+  *alarm = _alarms[id];
+  return true;
+}
+
+void AlarmEngine::clock_set() {
+  _clock_valid = true;
+  time_t now = wall_clock();
+  for (int id = 0; id < ALARM_MAX; id++) {
+    if (_used[id] && _alarms[id].enabled) {
+      schedule(id, next_time(_alarms[id], now));
+    }
+  }
+  arm();
+}
+
+time_t AlarmEngine::next_fire() const {
+  return _heap_size ? _alarms[_heap[0]].next : 0;
+}
+
+// First time after the given one at hour:minute on one of the weekdays
+time_t AlarmEngine::next_time(const Alarm &alarm, time_t after) {
+  time_t day = after / SECONDS_PER_DAY;
+  time_t time_of_day = alarm.hour * 3600 + alarm.minute * 60;
+  for (int i = 0; i < 8; i++) {
+    time_t t = (day + i) * SECONDS_PER_DAY + time_of_day;
+    int weekday = (day + i + EPOCH_WEEKDAY) % 7;
+    if (t > after &&
+        (alarm.weekdays == ALARM_ONCE || (alarm.weekdays & (1 << weekday)))) {
+      return t;
+    }
+  }
+  return 0;
+}
+
+bool AlarmEngine::valid(uint8_t hour, uint8_t minute, uint8_t weekdays) {
+  return hour < 24 && minute < 60 && weekdays <= ALARM_EVERY_DAY;
+}
+
+void AlarmEngine::schedule(int id, time_t next) {
+  _alarms[id].next = next;
+  int pos = _where[id];
+  if (pos < 0) {
+    pos = _heap_size++;
+    _heap[pos] = id;
+    _where[id] = pos;
+  }
+  // The key may have moved either way
+  sift_up(pos);
+  sift_down(_where[id]);
+}
+
+void AlarmEngine::unschedule(int id) {
+  int pos = _where[id];
+  if (pos < 0) {
+    return;
+  }
+  _heap_size--;
+  if (pos != _heap_size) {
+    swap(pos, _heap_size);
+    sift_up(pos);
+    sift_down(_where[_heap[pos]]);
+  }
+  _where[id] = -1;
+}
+
+void AlarmEngine::arm() {
+  _timeout.detach();
+  if (!_clock_valid || _heap_size == 0) {
+    return;
+  }
+
+  time_t now = wall_clock();
+  time_t next = _alarms[_heap[0]].next;
+  std::chrono::seconds wait(next > now ? next - now : 0);
+  if (wait > ALARM_MAX_WAIT) {
+    wait = ALARM_MAX_WAIT;
+  }
+  _due = Kernel::Clock::now() + wait;
+  _timeout.attach(callback(this, &AlarmEngine::expired), wait);
+}
+
+void AlarmEngine::expired() {
+  // Interrupt context. A full queue would lose the wakeup and with it every
+  // alarm, so the post is tried again shortly.
+  if (_queue->call(callback(this, &AlarmEngine::service)) == 0) {
+    _stats.retries++;
+    _timeout.attach(callback(this, &AlarmEngine::expired), ALARM_RETRY_WAIT);
+  }
+}
+
+void AlarmEngine::service() {
+  _stats.wakeups++;
+  // Time spent behind other events on the queue, and on retries. Negative
+  // when the Timeout was armed again since it posted this.
+  Kernel::Clock::duration late = Kernel::Clock::now() - _due;
+  if (late > ALARM_LATE_LIMIT) {
+    _stats.late++;
+  }
+  // Kernel::Clock counts milliseconds
+  if (late.count() > (int64_t)_stats.max_late_ms) {
+    _stats.max_late_ms = late.count();
+  }
+  time_t now = wall_clock();
+
+  // A wakeup that comes early, or after a split wait, only re-arms
+  while (_clock_valid && _heap_size && _alarms[_heap[0]].next <= now) {
+    int id = _heap[0];
+    Alarm *alarm = &_alarms[id];
+    if (alarm->weekdays == ALARM_ONCE) {
+      alarm->enabled = false;
+      unschedule(id);
+    } else {
+      // Occurrences missed while the clock jumped are skipped
+      schedule(id, next_time(*alarm, now));
+    }
+    _stats.fired++;
+    _fired(id);
+  }
+  arm();
+}
+
+bool AlarmEngine::before(int a, int b) const {
+  return _alarms[_heap[a]].next < _alarms[_heap[b]].next;
+}
+
+void AlarmEngine::swap(int a, int b) {
+  uint8_t id = _heap[a];
+  _heap[a] = _heap[b];
+  _heap[b] = id;
+  _where[_heap[a]] = a;
+  _where[_heap[b]] = b;
+}
+
+void AlarmEngine::sift_up(int pos) {
+  while (pos > 0 && before(pos, (pos - 1) / 2)) {
+    swap(pos, (pos - 1) / 2);
+    pos = (pos - 1) / 2;
+  }
+}
+
+void AlarmEngine::sift_down(int pos) {
+  while (true) {
+    int first = pos;
+    int left = 2 * pos + 1;
+    int right = left + 1;
+    if (left < _heap_size && before(left, first)) {
+      first = left;
+    }
+    if (right < _heap_size && before(right, first)) {
+      first = right;
+    }
+    if (first == pos) {
+      return;
+    }
+    swap(pos, first);
+    pos = first;
+  }
+}
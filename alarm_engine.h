@@ -0,0 +1,148 @@
+/**
+ * @file alarm_engine.h
+ * @brief Alarms at a time of day, once or on chosen weekdays, kept in a
+ * min-heap on their next fire time and served by a single Timeout armed for
+ * the earliest one, so nothing is checked while no alarm is due.
+ */
+#ifndef __ALARM_ENGINE_H__
+#define __ALARM_ENGINE_H__
+
+#include "mbed.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <time.h>
+
+#define ALARM_MAX 8
+
+/*
+The Timeout runs on the microsecond ticker and the alarms on the RTC, which
+drift apart. Longer waits are split into steps of this size, so the drift
+never builds up to more than a fraction of a second.
+*/
+#define ALARM_MAX_WAIT 1h
+
+// Wait before posting again when the queue was full as the Timeout expired
+#define ALARM_RETRY_WAIT 100ms
+
+// Wakeups the queue runs later than this after the Timeout was due
+#define ALARM_LATE_LIMIT 50ms
+
+// Weekday bits, bit 0 is Sunday as in tm_wday
+#define ALARM_ONCE 0x00 // the next time the clock reaches hour:minute
+#define ALARM_SUNDAY 0x01
+#define ALARM_MONDAY 0x02
+#define ALARM_TUESDAY 0x04
+#define ALARM_WEDNESDAY 0x08
+#define ALARM_THURSDAY 0x10
+#define ALARM_FRIDAY 0x20
+#define ALARM_SATURDAY 0x40
+#define ALARM_WORKDAYS 0x3E
+#define ALARM_WEEKEND 0x41
+#define ALARM_EVERY_DAY 0x7F
+
+struct Alarm {
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t weekdays; // ALARM_* bits
+  bool enabled;
+  time_t next; // next fire time, valid while enabled
+};
+
+struct AlarmStats {
+  uint32_t wakeups; // Timeout expiries
+  uint32_t fired;
+  uint32_t retries; // posts that found the queue full
+  uint32_t late;    // wakeups later than ALARM_LATE_LIMIT
+  uint32_t max_late_ms;
+};
+
+/**
+ * Everything but the Timeout runs on the queue's thread, the Timeout only
+ * posts to it. The times are the wall clock from time(), or from the clock
+ * given, which no alarm trusts before clock_set().
+ */
+class AlarmEngine {
+public:
+  typedef Callback<void(int)> Handler;
+  typedef Callback<time_t()> Clock;
+
+  /**
+   * @param queue runs the handler and all heap updates
+   * @param fired called on the queue with the id of an alarm that went off.
+   * A one-shot alarm is disabled before the call, a recurring one already
+   * points at its next day.
+   * @param clock wall clock, called on the queue. time() when not given.
+   */
+  AlarmEngine(EventQueue *queue, Handler fired, Clock clock = nullptr);
+
+  /**
+   * @brief add an enabled alarm
+   * @param weekdays ALARM_* bits, ALARM_ONCE to go off only once
+   * @return id of the alarm, or -1 when ALARM_MAX are in use or the time is
+   * invalid
+   */
+  int add(uint8_t hour, uint8_t minute, uint8_t weekdays);
+
+  /**
+   * @brief change the time and days of an alarm and enable it
+   */
+  bool set(int id, uint8_t hour, uint8_t minute, uint8_t weekdays);
+
+  bool remove(int id);
+  bool enable(int id, bool enabled);
+
+  /**
+   * @brief let the alarm go off again after delay, e.g. to snooze it. The
+   * days it repeats on are kept.
+   */
+  bool snooze(int id, std::chrono::seconds delay);
+
+  bool get(int id, Alarm *alarm) const;
+
+  /**
+   * @brief the wall clock was set, compute every alarm from the new time and
+   * arm the Timeout. No alarm goes off before the first call.
+   */
+  void clock_set();
+
+  /**
+   * @return earliest fire time, 0 when no alarm is enabled
+   */
+  time_t next_fire() const;
+
+  const AlarmStats &stats() const { return _stats; }
+
+private:
+  static time_t next_time(const Alarm &alarm, time_t after);
+  static bool valid(uint8_t hour, uint8_t minute, uint8_t weekdays);
+
+  time_t wall_clock() const { return _clock ? _clock() : time(NULL); }
+  void schedule(int id, time_t next);
+  void unschedule(int id);
+  void arm();
+  void expired();
+  void service();
+
+  bool before(int a, int b) const;
+  void swap(int a, int b);
+  void sift_up(int pos);
+  void sift_down(int pos);
+
+  EventQueue *_queue;
+  Handler _fired;
+  Clock _clock;
+  Timeout _timeout;
+  Kernel::Clock::time_point _due; // of the Timeout
+
+  Alarm _alarms[ALARM_MAX];
+  bool _used[ALARM_MAX];
+  int8_t _where[ALARM_MAX]; // position in _heap, -1 when not in it
+  uint8_t _heap[ALARM_MAX]; // alarm ids, earliest next first
+  int _heap_size;
+
+  bool _clock_valid;
+  AlarmStats _stats;
+};
+
+#endif
@@ -0,0 +1,186 @@
+/**
+ * @file dns_cache.cpp
+ * @brief Cached host name lookups, see dns_cache.h
+ */
+#include "dns_cache.h"
+
+#include <string.h>
+
+DnsCache::DnsCache(NetworkInterface *network)
+    : _network(network), _changed(_mutex) {
+  memset(&_stats, 0, sizeof(_stats));
+  for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+    _entries[i].cache = this;
+    _entries[i].host[0] = '\0';
+    _entries[i].pending = false;
+  }
+}
+
+nsapi_error_t DnsCache::gethostbyname(const char *host,
+                                      SocketAddress *address) {
+  _mutex.lock();
+  Entry *entry = find(host);
+  if (entry && entry->pending) {
+    // The prewarm query is already out, wait for its answer
+    Kernel::Clock::time_point deadline =
+        Kernel::Clock::now() + DNS_PREWARM_WAIT;
+    while (entry->pending &&
+           _changed.wait_until(deadline) != cv_status::timeout) {
+    }
+    if (entry->pending || strcmp(entry->host, host) != 0) {
+      entry = nullptr;
+    }
+  }
+
+  Kernel::Clock::time_point now = Kernel::Clock::now();
+  if (entry && !entry->pending && now < entry->expires) {
+    nsapi_error_t result = entry->result;
+    if (result == NSAPI_ERROR_OK) {
+      *address = entry->address;
+      _stats.hits++;
+    } else {
+      _stats.negative_hits++;
+    }
+    entry->last_used = now;
+    _mutex.unlock();
+    return result;
+  }
+  _stats.misses++;
+  _mutex.unlock();
+
+  SocketAddress answer;
+  nsapi_error_t result = _network->gethostbyname(host, &answer);
+
+  _mutex.lock();
+  entry = find(host);
+  if (!entry) {
+    entry = allocate(host);
+  }
+  if (entry && !entry->pending) {
+    store(entry, result, &answer);
+  }
+  _mutex.unlock();
+
+  if (result == NSAPI_ERROR_OK) {
+    *address = answer;
+  }
+  return result;
+}
+
+void DnsCache::prewarm(const char *const *hosts, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    _mutex.lock();
+    Entry *entry = find(hosts[i]);
+    if (entry && (entry->pending || Kernel::Clock::now() < entry->expires)) {
+      _mutex.unlock();
+      continue;
+    }
+    if (!entry) {
+      entry = allocate(hosts[i]);
+    }
+    if (!entry) {
+      _mutex.unlock();
+      continue;
+    }
+    entry->pending = true;
+    _mutex.unlock();
+
+    // The answer may arrive before this returns, even on this thread
+    nsapi_value_or_error_t id = _network->gethostbyname_async(
+        hosts[i], callback(resolved, entry));
+    if (id < 0) {
+      _mutex.lock();
+      store(entry, (nsapi_error_t)id, nullptr);
+      _changed.notify_all();
+      _mutex.unlock();
+    }
+  }
+}
+
+void DnsCache::forget(const char *host) {
+  _mutex.lock();
+  Entry *entry = find(host);
+  if (entry && !entry->pending) {
+    entry->host[0] = '\0';
+  }
+  _mutex.unlock();
+}
+
+DnsCacheStats DnsCache::stats() {
+  _mutex.lock();
+  DnsCacheStats stats = _stats;
+  _mutex.unlock();
+  return stats;
+}
+
+DnsCache::Entry *DnsCache::find(const char *host) {
+  for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+    if (_entries[i].host[0] && strcmp(_entries[i].host, host) == 0) {
+      return &_entries[i];
+    }
+  }
+  return nullptr;
+}
+
+DnsCache::Entry *DnsCache::allocate(const char *host) {
+  if (strlen(host) >= DNS_HOST_SIZE) {
+    // Looked up every time rather than cached under a truncated name
+    return nullptr;
+  }
+
+  // A free entry, otherwise the least recently used one. Entries waiting
+  // for a prewarm answer are never taken, the answer is written into them.
+  Entry *victim = nullptr;
+  for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+    Entry *entry = &_entries[i];
+    if (entry->pending) {
+      continue;
+    }
+    if (entry->host[0] == '\0') {
+      victim = entry;
+      break;
+    }
+    if (!victim || entry->last_used < victim->last_used) {
+      victim = entry;
+    }
+  }
+  if (victim) {
+    strcpy(victim->host, host);
+    victim->result = NSAPI_ERROR_DNS_FAILURE;
+    victim->expires = Kernel::Clock::now();
+    victim->last_used = victim->expires;
+  }
+  return victim;
+}
+
+void DnsCache::store(Entry *entry, nsapi_error_t result,
+                     const SocketAddress *address) {
+  Kernel::Clock::time_point now = Kernel::Clock::now();
+  entry->pending = false;
+  entry->result = result;
+  entry->last_used = now;
+  if (result == NSAPI_ERROR_OK) {
+    entry->address = *address;
+    entry->expires = now + DNS_CACHE_TTL;
+  } else if (result == NSAPI_ERROR_DNS_FAILURE) {
+    entry->expires = now + DNS_NEGATIVE_TTL;
+  } else {
+    // No network or out of memory says nothing about the name
+    entry->host[0] = '\0';
+  }
+}
+
+void DnsCache::resolved(Entry *entry, nsapi_value_or_error_t result,
+                        SocketAddress *address) {
+  DnsCache *cache = entry->cache;
+  cache->_mutex.lock();
+  if (result >= 0 && address) {
+    cache->store(entry, NSAPI_ERROR_OK, address);
+  } else {
+    nsapi_error_t error = result < 0 ? result : NSAPI_ERROR_DNS_FAILURE;
+    cache->store(entry, error, nullptr);
+  }
+  cache->_stats.prewarmed++;
+  cache->_changed.notify_all();
+  cache->_mutex.unlock();
+}
@@ -0,0 +1,87 @@
+/**
+ * @file dns_cache.h
+ * @brief Small fixed-size cache in front of NetworkInterface::gethostbyname,
+ * so a request to a host looked up recently skips the DNS round trip.
+ */
+#ifndef __DNS_CACHE_H__
+#define __DNS_CACHE_H__
+
+#include "NetworkInterface.h"
+#include "mbed.h"
+
+#define DNS_CACHE_SIZE 4
+#define DNS_HOST_SIZE 64
+
+/*
+gethostbyname() does not report the TTL of the records, so every answer is
+kept for DNS_CACHE_TTL. Keeping an address past its record only matters
+when the host moves, and then the failed connect drops the entry. Names
+that do not resolve are remembered for DNS_NEGATIVE_TTL, so a misconfigured
+host does not cost a full DNS timeout on every retry.
+*/
+#define DNS_CACHE_TTL 1h
+#define DNS_NEGATIVE_TTL 30s
+
+// How long a lookup waits for a prewarm of the same host to finish
+#define DNS_PREWARM_WAIT 5s
+
+struct DnsCacheStats {
+  uint32_t hits;
+  uint32_t negative_hits; // cached failures returned
+  uint32_t misses;
+  uint32_t prewarmed;     // asynchronous lookups that finished
+};
+
+/**
+ * Lookups run on the caller's thread, prewarm answers arrive on the network
+ * stack's event thread, so the entries are kept under a mutex.
+ */
+class DnsCache {
+public:
+  explicit DnsCache(NetworkInterface *network);
+
+  /**
+   * @brief same as NetworkInterface::gethostbyname, answered from the cache
+   * while the entry is fresh
+   */
+  nsapi_error_t gethostbyname(const char *host, SocketAddress *address);
+
+  /**
+   * @brief start asynchronous lookups for all hosts at once and return.
+   * A gethostbyname() for one of them waits for its answer instead of
+   * sending a second query.
+   */
+  void prewarm(const char *const *hosts, size_t count);
+
+  /**
+   * @brief drop the entry for host, e.g. after connecting to it failed
+   */
+  void forget(const char *host);
+
+  DnsCacheStats stats();
+
+private:
+  struct Entry {
+    DnsCache *cache;
+    char host[DNS_HOST_SIZE];
+    SocketAddress address;
+    nsapi_error_t result;
+    Kernel::Clock::time_point expires;
+    Kernel::Clock::time_point last_used;
+    bool pending; // prewarm lookup running
+  };
+
+  Entry *find(const char *host);
+  Entry *allocate(const char *host);
+  void store(Entry *entry, nsapi_error_t result, const SocketAddress *address);
+  static void resolved(Entry *entry, nsapi_value_or_error_t result,
+                       SocketAddress *address);
+
+  NetworkInterface *_network;
+  Entry _entries[DNS_CACHE_SIZE];
+  DnsCacheStats _stats;
+  Mutex _mutex;
+  ConditionVariable _changed;
+};
+
+#endif
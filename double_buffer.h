@@ -0,0 +1,81 @@
+/**
+ * @file double_buffer.h
+ * @brief Latest-value mailbox for handing results from one writer thread to
+ * one reader thread without locks.
+ */
+#ifndef __DOUBLE_BUFFER_H__
+#define __DOUBLE_BUFFER_H__
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * The writer fills the slot the reader is not pointed at and then bumps the
+ * version, so publishing never waits for the reader. Each slot has its own
+ * sequence count, odd while the slot is being written. A reader that was
+ * preempted long enough for the writer to come back to its slot sees the
+ * count change, or find it odd, and starts again from the newer version;
+ * with one writer that slot is never the one being written.
+ */
+template <typename T> class DoubleBuffer {
+public:
+  DoubleBuffer() : _version(0) {
+    _slots[0].seq = 0;
+    _slots[1].seq = 0;
+  }
+
+  /**
+   * @brief writer side, make a new value visible
+   */
+  void publish(const T &value) {
+    uint32_t version = _version.load(std::memory_order_relaxed);
+    Slot &slot = _slots[(version + 1) & 1];
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.value = value;
+    slot.seq.store(seq + 2, std::memory_order_release);
+    _version.store(version + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief reader side, copy the value if it is newer than *seen
+   * @param seen version last read, updated on success. Start at 0.
+   * @return false when nothing has been published since *seen
+   */
+  bool read(T *value, uint32_t *seen) const {
+    while (true) {
+      uint32_t version = _version.load(std::memory_order_acquire);
+      if (version == *seen) {
+        return false;
+      }
+      const Slot &slot = _slots[version & 1];
+      uint32_t seq = slot.seq.load(std::memory_order_acquire);
+      if (seq & 1) {
+        continue;
+      }
+      *value = slot.value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == seq) {
+        *seen = version;
+        return true;
+      }
+    }
+  }
+
+  /**
+   * @return number of values published so far
+   */
+  uint32_t version() const { return _version.load(std::memory_order_acquire); }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    T value;
+  };
+
+  Slot _slots[2];
+  std::atomic<uint32_t> _version;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file drift_estimator.cpp
+ * @brief Least-squares RTC drift, see drift_estimator.h
+ */
+#include "drift_estimator.h"
+
+#include <math.h>
+#include <string.h>
+
+DriftEstimator::DriftEstimator()
+    : _count(0), _next(0), _ppm(0), _anchor(0), _residual_ms(0) {
+  memset(_records, 0, sizeof(_records));
+}
+
+void DriftEstimator::add(time_t rtc, int64_t elapsed_ms, int64_t drift_ms,
+                         int32_t residual_ms) {
+  DriftRecord *record = &_records[_next];
+  record->time = rtc;
+  record->elapsed_ms = elapsed_ms;
+  record->drift_ms = drift_ms;
+  record->error_ms = 0;
+  if (_count > 0) {
+    const DriftRecord &last =
+        _records[(_next + DRIFT_HISTORY - 1) % DRIFT_HISTORY];
+    int64_t predicted =
+        last.drift_ms +
+        (int64_t)llround(_ppm * 1e-6 * (elapsed_ms - last.elapsed_ms));
+    record->error_ms = drift_ms - predicted;
+  }
+
+  _next = (_next + 1) % DRIFT_HISTORY;
+  if (_count < DRIFT_HISTORY) {
+    _count++;
+  }
+  _anchor = rtc;
+  _residual_ms = residual_ms;
+  fit();
+  record->ppm = _ppm;
+}
+
+void DriftEstimator::fit() {
+  const DriftRecord &first =
+      _records[(_next + DRIFT_HISTORY - _count) % DRIFT_HISTORY];
+  const DriftRecord &last =
+      _records[(_next + DRIFT_HISTORY - 1) % DRIFT_HISTORY];
+  if (_count < 2 ||
+      last.elapsed_ms - first.elapsed_ms < (int64_t)DRIFT_MIN_SPAN_S * 1000) {
+    _ppm = 0;
+    return;
+  }
+
+  // Relative to the oldest record, so the sums keep their precision
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (size_t i = 0; i < _count; i++) {
+    const DriftRecord &r = _records[(_next + DRIFT_HISTORY - _count + i) %
+                                    DRIFT_HISTORY];
+    double x = (r.elapsed_ms - first.elapsed_ms) / 1000.0;
+    double y = (double)(r.drift_ms - first.drift_ms);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  double n = _count;
+  // ms per second is thousandths, ppm are millionths
+  double ppm = (n * sxy - sx * sy) / (n * sxx - sx * sx) * 1000;
+  _ppm = fabs(ppm) <= DRIFT_MAX_PPM ? ppm : 0;
+}
+
+int32_t DriftEstimator::correction_ms() const {
+  return correction_at(time(NULL));
+}
+
+int32_t DriftEstimator::correction_at(time_t rtc) const {
+  if (_count == 0) {
+    return 0;
+  }
+  return _residual_ms + (int32_t)lround(_ppm * 1e-3 * (rtc - _anchor));
+}
+
+time_t DriftEstimator::now() const {
+  // The RTC's phase within its second is not known, rounding keeps the
+  // error within half a second
+  time_t rtc = time(NULL);
+  int32_t correction = correction_at(rtc);
+  int32_t seconds =
+      correction >= 0 ? (correction + 500) / 1000 : (correction - 500) / 1000;
+  return rtc + seconds;
+}
+
+size_t DriftEstimator::history(DriftRecord *records, size_t max) const {
+  size_t count = _count < max ? _count : max;
+  for (size_t i = 0; i < count; i++) {
+    records[i] = _records[(_next + DRIFT_HISTORY - count + i) % DRIFT_HISTORY];
+  }
+  return count;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file drift_estimator.h
+ * @brief Fits the RTC's rate error in ppm to what the time syncs measured,
+ * and corrects time() with it in between, so the clock and the alarms stay
+ * right while the device runs on the RTC alone.
+ */
+#ifndef __DRIFT_ESTIMATOR_H__
+#define __DRIFT_ESTIMATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Syncs the fit is made over. A crystal's rate follows its temperature, so
+// old syncs are dropped rather than averaged in.
+#define DRIFT_HISTORY 8
+
+// RTC time the syncs have to span before a rate is trusted
+#define DRIFT_MIN_SPAN_S (30 * 60)
+
+// A 32 kHz crystal is within about 100 ppm. A fit beyond this comes from a
+// bad sync and is not applied.
+#define DRIFT_MAX_PPM 500
+
+struct DriftRecord {
+  time_t time;          // RTC right after the sync
+  int64_t elapsed_ms;   // RTC time since the first sync
+  int64_t drift_ms;     // behind the reference since the first sync
+  int32_t error_ms;     // drift_ms minus what the previous fit predicted
+  float ppm;            // fit including this sync
+};
+
+/**
+ * The syncs are (RTC time, drift) points on one line, as if the RTC had
+ * never been set, so a step or a missed sync does not disturb the fit.
+ * Not thread-safe, keep it on the thread that reads the clock.
+ */
+class DriftEstimator {
+public:
+  DriftEstimator();
+
+  /**
+   * @brief add a sync
+   * @param rtc RTC right after the sync
+   * @param elapsed_ms RTC time since the first sync, without steps
+   * @param drift_ms how far the RTC fell behind the reference (+) or ran
+   * ahead since the first sync
+   * @param residual_ms how far the RTC is still behind after the sync, 0
+   * when it was set
+   */
+  void add(time_t rtc, int64_t elapsed_ms, int64_t drift_ms,
+           int32_t residual_ms);
+
+  /**
+   * @return time() with the drift since the last sync added
+   */
+  time_t now() const;
+
+  /**
+   * @return correction now() adds, in ms
+   */
+  int32_t correction_ms() const;
+
+  /**
+   * @return rate the RTC is slow by, negative when fast. 0 until the syncs
+   * span DRIFT_MIN_SPAN_S.
+   */
+  float ppm() const { return _ppm; }
+
+  /**
+   * @brief copy the syncs the fit is made over, oldest first
+   * @return number of records copied
+   */
+  size_t history(DriftRecord *records, size_t max) const;
+
+private:
+  void fit();
+  int32_t correction_at(time_t rtc) const;
+
+  DriftRecord _records[DRIFT_HISTORY];
+  size_t _count;
+  size_t _next; // ring position of the next record
+  float _ppm;
+  time_t _anchor;       // RTC at the last sync
+  int32_t _residual_ms; // RTC behind the reference then
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * @file env_sampler.cpp
+ * @brief Interrupt-driven HTS221 acquisition, see env_sampler.h
+ */
+#include "env_sampler.h"
+
+EnvSampler::EnvSampler(HTS221Sensor *sensor, EventQueue *queue)
+    : _sensor(sensor), _queue(queue), _use_drdy(false), _pending(false),
+      _fresh(false), _batch(ENV_SAMPLER_RING_SIZE) {}
+
+int EnvSampler::start() {
+  if (_sensor->attach_drdy(callback(this, &EnvSampler::on_drdy)) == 0) {
+    if (_sensor->enable_drdy_irq() != 0) {
+      return 1;
+    }
+    _use_drdy = true;
+  }
+
+  _queue->call_every(ENV_SAMPLER_WATCHDOG,
+                     callback(this, &EnvSampler::watchdog));
+  // Read once now, DRDY may already be high from a sample nobody collected
+  _queue->call(callback(this, &EnvSampler::acquire));
+  return 0;
+}
+
+void EnvSampler::attach(Callback<void()> notify, size_t batch) {
+  _notify = notify;
+  set_batch(batch);
+}
+
+void EnvSampler::set_batch(size_t batch) {
+  // A batch larger than the ring would never be reached
+  _batch = batch < 1 ? 1 : batch > ENV_SAMPLER_RING_SIZE ? ENV_SAMPLER_RING_SIZE
+                                                          : batch;
+}
+
+void EnvSampler::on_drdy() {
+  // Interrupt context, the I2C transfer runs on the queue
+  if (!_pending) {
+    _pending = true;
+    _queue->call(callback(this, &EnvSampler::acquire));
+  }
+}
+
+void EnvSampler::acquire() {
+  EnvSample sample;
+
+  _pending = false;
+  if (_sensor->get_measurement_fixed(&sample.humidity, &sample.temperature) !=
+      0) {
+    return;
+  }
+  sample.time = time(NULL);
+  _ring.push(sample);
+  _fresh = true;
+  if (_notify && _ring.size() >= _batch) {
+    _notify();
+  }
+}
+
+void EnvSampler::watchdog() {
+  if (!_use_drdy || !_fresh) {
+    acquire();
+  }
+  _fresh = false;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file env_sampler.h
+ * @brief Interrupt-driven HTS221 acquisition. DRDY defers a burst read to an
+ * EventQueue and the result is handed to the UI through a lock-free ring.
+ */
+#ifndef __ENV_SAMPLER_H__
+#define __ENV_SAMPLER_H__
+
+#include "HTS221Sensor.h"
+#include "mbed.h"
+#include "spsc_ring.h"
+
+#define ENV_SAMPLER_RING_SIZE 8
+
+/*
+If no sample has arrived for this long the output registers are read anyway.
+That clears DRDY, so a missed edge cannot stop the acquisition. Without a
+DRDY pin the sensor is polled at this rate instead.
+*/
+#define ENV_SAMPLER_WATCHDOG 2s
+
+struct EnvSample {
+  time_t time;
+  int16_t temperature; // centi-degrees
+  uint16_t humidity;   // permille
+};
+
+class EnvSampler {
+public:
+  /**
+   * @param sensor initialised sensor, only used from the queue afterwards
+   * @param queue event queue that runs the I2C reads
+   */
+  EnvSampler(HTS221Sensor *sensor, EventQueue *queue);
+
+  /**
+   * @brief enable DRDY on the sensor and start acquiring
+   * @return 0 in case of success, 1 if the sensor could not be configured
+   */
+  int start();
+
+  /**
+   * @brief consumer side, take the oldest sample not yet read. Never touches
+   * the bus.
+   * @return false when there are no new samples
+   */
+  bool pop(EnvSample *sample) { return _ring.pop(sample); }
+
+  /**
+   * @brief call notify from the queue once batch samples are waiting, so the
+   * consumer wakes up per batch instead of polling. A batch of 1 notifies on
+   * every sample. Has to be called before start().
+   */
+  void attach(Callback<void()> notify, size_t batch);
+
+  /**
+   * @brief change the batch size, from any thread
+   */
+  void set_batch(size_t batch);
+
+  uint32_t dropped() const { return _ring.dropped(); }
+
+private:
+  void on_drdy();
+  void acquire();
+  void watchdog();
+
+  HTS221Sensor *_sensor;
+  EventQueue *_queue;
+  SpscRing<EnvSample, ENV_SAMPLER_RING_SIZE> _ring;
+  bool _use_drdy;
+  volatile bool _pending;
+  bool _fresh;
+  Callback<void()> _notify;
+  volatile size_t _batch;
+};
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file headline_ticker.cpp
+ * @brief Event-driven LCD ticker, see headline_ticker.h
+ */
+#include "headline_ticker.h"
+
+#include <string.h>
+
+using namespace std::chrono;
+
+static_assert(TICKER_DDRAM_COLS % TICKER_REFILL == 0 &&
+                  TICKER_REFILL <= TICKER_DDRAM_COLS - LCD_FB_COLS,
+              "TICKER_REFILL has to divide the line and stay out of view");
+
+HeadlineTicker::HeadlineTicker(LcdFrameBuffer *screen, DFRobot_RGBLCD1602 *lcd,
+                               EventQueue *queue)
+    : _screen(screen), _lcd(lcd), _queue(queue), _length(0), _offset(0),
+      _row(0), _event(0), _stopped(true), _shifted(false) {
+  _text[0] = '\0';
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void HeadlineTicker::start(const char *text, uint8_t row,
+                           Kernel::Clock::duration step) {
+  if (_event) {
+    _queue->cancel(_event);
+    _event = 0;
+  }
+  unshift();
+  strncpy(_text, text, TICKER_TEXT_SIZE - 1);
+  _text[TICKER_TEXT_SIZE - 1] = '\0';
+  _length = strlen(_text);
+  _offset = 0;
+  _row = row;
+  _stopped = false;
+
+  render();
+  if (_length <= LCD_FB_COLS) {
+    // Text that fits is shown as it is, without a step event
+    _screen->flush();
+    return;
+  }
+
+  if (TICKER_HARDWARE_SHIFT) {
+    _screen->suspend();
+    preload(true);
+    _shifted = true;
+  } else {
+    _screen->flush();
+  }
+  _event = _queue->call_every(duration_cast<milliseconds>(step),
+                              callback(this, &HeadlineTicker::step));
+}
+
+void HeadlineTicker::render() {
+  // While shifted the frame is not shown, it keeps the start of the text
+  _screen->setCursor(0, _row);
+  size_t offset = _shifted ? 0 : _offset;
+  for (size_t i = 0; i < LCD_FB_COLS; i++) {
+    size_t pos = offset + i;
+    _screen->write(pos < _length ? _text[pos] : ' ');
+  }
+}
+
+void HeadlineTicker::step() {
+  if (_stopped) {
+    _queue->cancel(_event);
+    _event = 0;
+    if (_shifted) {
+      unshift();
+      // Shows whatever screen the UI has drawn since
+      _screen->flush();
+    }
+    return;
+  }
+
+  Timer timer;
+  timer.start();
+
+  if (_shifted) {
+    shift_step();
+  } else {
+    // Starts over once the end of the text has come into view
+    _offset = _offset + LCD_FB_COLS < _length ? _offset + 1 : 0;
+    render();
+    _stats.chars += _screen->flush();
+  }
+
+  uint32_t us = duration_cast<microseconds>(timer.elapsed_time()).count();
+  _stats.steps++;
+  _stats.total_us += us;
+  if (us > _stats.max_us) {
+    _stats.max_us = us;
+  }
+}
+
+void HeadlineTicker::shift_step() {
+  if (_offset + LCD_FB_COLS >= _length) {
+    // Back to the start, which is still in DDRAM unless it was refilled
+    _offset = 0;
+    _lcd->home();
+    if (_length > TICKER_DDRAM_COLS) {
+      preload(false);
+    }
+    return;
+  }
+
+  _lcd->scrollDisplayLeft();
+  _stats.shifts++;
+  _offset++;
+
+  // Text position p lives in DDRAM column p % 40. The columns that just
+  // went out of view on the left are next seen 40 positions further on.
+  if (_length > TICKER_DDRAM_COLS && _offset % TICKER_REFILL == 0) {
+    size_t pos = _offset - TICKER_REFILL + TICKER_DDRAM_COLS;
+    write_text(pos % TICKER_DDRAM_COLS, pos, TICKER_REFILL);
+  }
+}
+
+void HeadlineTicker::preload(bool all_rows) {
+  write_text(0, 0, TICKER_DDRAM_COLS);
+  if (!all_rows) {
+    return;
+  }
+
+  // Twice per line, so it stays in view as the display shifts
+  char line[TICKER_DDRAM_COLS];
+  for (uint8_t row = 0; row < LCD_FB_ROWS; row++) {
+    if (row == _row) {
+      continue;
+    }
+    memset(line, ' ', sizeof(line));
+    memcpy(line, _screen->row(row), LCD_FB_COLS);
+    memcpy(line + TICKER_DDRAM_COLS / 2, _screen->row(row), LCD_FB_COLS);
+    _lcd->writeRunAt(0, row, line, TICKER_DDRAM_COLS);
+    _stats.chars += TICKER_DDRAM_COLS;
+  }
+}
+
+void HeadlineTicker::write_text(uint8_t col, size_t pos, size_t length) {
+  char run[TICKER_DDRAM_COLS];
+  for (size_t i = 0; i < length; i++) {
+    run[i] = pos + i < _length ? _text[pos + i] : ' ';
+  }
+  _lcd->writeRunAt(col, _row, run, length);
+  _stats.chars += length;
+}
+
+void HeadlineTicker::unshift() {
+  if (_shifted) {
+    _lcd->home();
+    _shifted = false;
+    _screen->resume();
+  }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file headline_ticker.h
+ * @brief Scrolls a line of text across one row of the LCD, one column per
+ * EventQueue tick, so the rest of the UI keeps running while it scrolls.
+ */
+#ifndef __HEADLINE_TICKER_H__
+#define __HEADLINE_TICKER_H__
+
+#include "DFRobot_RGBLCD1602.h"
+#include "lcd_framebuffer.h"
+#include "mbed.h"
+
+#define TICKER_TEXT_SIZE 1024
+
+/*
+With hardware shift the text is written into the controller's 40 column
+DDRAM line once, and a step is a single display shift command instead of a
+rewrite of the row. The HD44780 shifts both lines together, so the other row
+is written twice into its line and moves along with the text. Text longer
+than a DDRAM line is refilled TICKER_REFILL columns at a time, into the part
+of the line that has scrolled out of view.
+
+That is the trade-off: a step costs one command instead of 16 characters
+over I2C, but on the news screen the title on row 0 scrolls away with the
+headline instead of staying put. So it is off unless "lcd-hardware-scroll"
+is set in mbed_app.json, and each step rewrites the ticker's row.
+*/
+#ifdef MBED_CONF_APP_LCD_HARDWARE_SCROLL
+#define TICKER_HARDWARE_SHIFT MBED_CONF_APP_LCD_HARDWARE_SCROLL
+#else
+#define TICKER_HARDWARE_SHIFT 0
+#endif
+
+#define TICKER_DDRAM_COLS 40
+
+// Divides the DDRAM line, so a refill never wraps, and leaves the refilled
+// columns out of view until they are written
+#define TICKER_REFILL 20
+
+struct TickerStats {
+  uint32_t steps;
+  uint32_t chars;    // written to the display
+  uint32_t shifts;   // display shift commands
+  uint32_t total_us; // rendering and I2C, all steps
+  uint32_t max_us;   // longest step
+};
+
+/**
+ * Each step rewrites only the ticker's row, the rest of the frame is left to
+ * the screen drawn around it. While the display is shifted the frame buffer
+ * is suspended, and redrawn once the ticker stops. Everything but stop() has
+ * to be called from the thread dispatching the queue, which also owns the
+ * frame buffer.
+ */
+class HeadlineTicker {
+public:
+  HeadlineTicker(LcdFrameBuffer *screen, DFRobot_RGBLCD1602 *lcd,
+                 EventQueue *queue);
+
+  /**
+   * @brief show text on a row, moving it one column left every step when it
+   * is longer than the row. Replaces whatever was scrolling before. The
+   * other row is taken from the frame as it is now.
+   */
+  void start(const char *text, uint8_t row, Kernel::Clock::duration step);
+
+  /**
+   * @brief stop scrolling before the next step. Safe to call from interrupt
+   * context, the text stays where it is.
+   */
+  void stop() { _stopped = true; }
+
+  bool running() const { return !_stopped; }
+
+  /**
+   * @brief put the visible part of the text into the frame, for screens that
+   * clear and redraw the frame around the ticker
+   */
+  void render();
+
+  const TickerStats &stats() const { return _stats; }
+
+private:
+  void step();
+  void shift_step();
+  void preload(bool all_rows);
+  void write_text(uint8_t col, size_t pos, size_t length);
+  void unshift();
+
+  LcdFrameBuffer *_screen;
+  DFRobot_RGBLCD1602 *_lcd;
+  EventQueue *_queue;
+  char _text[TICKER_TEXT_SIZE];
+  size_t _length;
+  size_t _offset;
+  uint8_t _row;
+  int _event;
+  volatile bool _stopped;
+  bool _shifted; // the display is shifted and the frame buffer suspended
+  TickerStats _stats;
+};
+
+#endif
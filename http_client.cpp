@@ -0,0 +1,337 @@
+/**
+ * @file http_client.cpp
+ * @brief Keep-alive HTTPS client, see http_client.h
+ */
+#include "http_client.h"
+
+#include <string.h>
+
+using namespace std::chrono;
+
+HttpClient::HttpClient(NetworkInterface *network, DnsCache *dns)
+    : _network(network), _dns(dns), _next_victim(0) {
+  memset(&_stats, 0, sizeof(_stats));
+  for (int i = 0; i < HTTP_CLIENT_MAX_HOSTS; i++) {
+    _connections[i].host[0] = '\0';
+    _connections[i].socket = nullptr;
+  }
+}
+
+HttpClient::~HttpClient() { close_all(); }
+
+int HttpClient::get(const char *host, const char *path, const char *ca_cert,
+                    HttpBodyCallback body, HttpValidators *validators,
+                    HttpRange *range) {
+  _stats.requests++;
+  close_idle();
+
+  Connection *conn = slot(host);
+  bool reused = conn->socket != nullptr;
+  if (reused) {
+    _stats.reused++;
+    _stats.last_connect_ms = 0;
+  } else {
+    nsapi_error_t err = connect(conn, host, ca_cert);
+    if (err != NSAPI_ERROR_OK) {
+      return err;
+    }
+  }
+
+  bool retry = false;
+  int status = request(conn, host, path, body, validators, range, &retry);
+  if (retry && reused) {
+    // The server closed the kept connection before answering
+    _stats.reused--;
+    nsapi_error_t err = connect(conn, host, ca_cert);
+    if (err != NSAPI_ERROR_OK) {
+      return err;
+    }
+    status = request(conn, host, path, body, validators, range, &retry);
+  }
+  return status;
+}
+
+void HttpClient::close_idle() {
+  Kernel::Clock::time_point now = Kernel::Clock::now();
+  for (int i = 0; i < HTTP_CLIENT_MAX_HOSTS; i++) {
+    Connection *conn = &_connections[i];
+    if (conn->socket && now - conn->last_used > HTTP_IDLE_TIMEOUT) {
+      close(conn);
+    }
+  }
+}
+
+void HttpClient::close_all() {
+  for (int i = 0; i < HTTP_CLIENT_MAX_HOSTS; i++) {
+    close(&_connections[i]);
+  }
+}
+
+HttpClient::Connection *HttpClient::slot(const char *host) {
+  Connection *free_slot = nullptr;
+  for (int i = 0; i < HTTP_CLIENT_MAX_HOSTS; i++) {
+    Connection *conn = &_connections[i];
+    if (strcmp(conn->host, host) == 0) {
+      return conn;
+    }
+    if (!free_slot && !conn->socket) {
+      free_slot = conn;
+    }
+  }
+
+  if (!free_slot) {
+    free_slot = &_connections[_next_victim];
+    _next_victim = (_next_victim + 1) % HTTP_CLIENT_MAX_HOSTS;
+    close(free_slot);
+  }
+  strncpy(free_slot->host, host, HTTP_HOST_SIZE - 1);
+  free_slot->host[HTTP_HOST_SIZE - 1] = '\0';
+  return free_slot;
+}
+
+nsapi_error_t HttpClient::connect(Connection *conn, const char *host,
+                                  const char *ca_cert) {
+  Timer timer;
+  timer.start();
+
+  SocketAddress address;
+  nsapi_error_t err = _dns ? _dns->gethostbyname(host, &address)
+                          : _network->gethostbyname(host, &address);
+  if (err != NSAPI_ERROR_OK) {
+    return err;
+  }
+  address.set_port(443);
+
+  TLSSocket *socket = new TLSSocket;
+  socket->set_timeout(HTTP_TIMEOUT_MS);
+  err = socket->open(_network);
+  if (err == NSAPI_ERROR_OK) {
+    err = socket->set_root_ca_cert(ca_cert);
+  }
+  if (err == NSAPI_ERROR_OK) {
+    socket->set_hostname(host);
+    err = socket->connect(address);
+  }
+  if (err != NSAPI_ERROR_OK) {
+    socket->close();
+    delete socket;
+    if (_dns) {
+      // The cached address may be the reason
+      _dns->forget(host);
+    }
+    return err;
+  }
+
+  conn->socket = socket;
+  conn->last_used = Kernel::Clock::now();
+  _stats.handshakes++;
+  _stats.last_connect_ms =
+      duration_cast<milliseconds>(timer.elapsed_time()).count();
+  return NSAPI_ERROR_OK;
+}
+
+void HttpClient::close(Connection *conn) {
+  if (conn->socket) {
+    conn->socket->close();
+    delete conn->socket;
+    conn->socket = nullptr;
+  }
+}
+
+nsapi_error_t HttpClient::send_all(TLSSocket *socket, const char *data,
+                                   size_t size) {
+  while (size) {
+    nsapi_size_or_error_t sent = socket->send(data, size);
+    if (sent < 0) {
+      return sent;
+    }
+    data += sent;
+    size -= sent;
+  }
+  return NSAPI_ERROR_OK;
+}
+
+// Appends to the request, returns -1 once it no longer fits
+static int append(char *request, size_t size, int length, const char *format,
+                  const char *value) {
+  if (length < 0) {
+    return -1;
+  }
+  int n = snprintf(request + length, size - length, format, value);
+  if (n < 0 || (size_t)n >= size - length) {
+    return -1;
+  }
+  return length + n;
+}
+
+struct PartFilter {
+  HttpResponseParser *response;
+  HttpBodyCallback *body;
+};
+
+// Drops a whole document sent in place of the part asked for
+static bool only_partial(PartFilter *filter, const char *data, size_t size) {
+  if (filter->response->status() != 206) {
+    return false;
+  }
+  return (*filter->body)(data, size);
+}
+
+struct BodyDecoder {
+  HttpResponseParser *response;
+  Inflater *inflater;
+  HttpBodyCallback *body;
+  bool started;
+  bool refused; // a compressed 206
+};
+
+// Undoes the Content-Encoding on the way from the parser to the body
+static bool decode_body(BodyDecoder *decoder, const char *data, size_t size) {
+  HttpResponseParser::Encoding encoding = decoder->response->encoding();
+  if (encoding == HttpResponseParser::IDENTITY) {
+    return (*decoder->body)(data, size);
+  }
+  if (decoder->response->status() == 206) {
+    // A part of the compressed document, which cannot be inflated without
+    // the bytes before it
+    decoder->refused = true;
+    return false;
+  }
+  if (!decoder->started) {
+    decoder->inflater->reset(encoding == HttpResponseParser::GZIP
+                                 ? Inflater::GZIP
+                                 : Inflater::DEFLATE);
+    decoder->started = true;
+  }
+  return decoder->inflater->feed(data, size, decoder->body);
+}
+
+int HttpClient::request(Connection *conn, const char *host, const char *path,
+                        HttpBodyCallback &body, HttpValidators *validators,
+                        HttpRange *range, bool *retry) {
+  char http_request[512];
+  size_t size = sizeof(http_request);
+  int length = append(http_request, size, 0, "GET %s HTTP/1.1\r\n", path);
+  length = append(http_request, size, length, "Host: %s\r\n", host);
+  bool continuation = range && range->first > 0;
+  if (range) {
+    char bytes[32];
+    snprintf(bytes, sizeof(bytes), "%lu-%lu", (unsigned long)range->first,
+             (unsigned long)range->last);
+    length = append(http_request, size, length, "Range: bytes=%s\r\n", bytes);
+    // Without it the server may pick a coding and send a part of that
+    length = append(http_request, size, length, "Accept-Encoding: %s\r\n",
+                    "identity");
+  } else if (HTTP_COMPRESSION) {
+    length = append(http_request, size, length, "Accept-Encoding: %s\r\n",
+                    "gzip, deflate");
+  }
+  if (continuation && validators) {
+    // The rest of the same document, or all of it when it changed
+    const char *validator =
+        validators->etag[0] ? validators->etag : validators->last_modified;
+    if (validator[0]) {
+      length = append(http_request, size, length, "If-Range: %s\r\n",
+                      validator);
+    }
+  } else {
+    if (validators && validators->etag[0]) {
+      length = append(http_request, size, length, "If-None-Match: %s\r\n",
+                      validators->etag);
+    }
+    if (validators && validators->last_modified[0]) {
+      length = append(http_request, size, length,
+                      "If-Modified-Since: %s\r\n", validators->last_modified);
+    }
+  }
+  length = append(http_request, size, length, "%s", "\r\n");
+  if (length < 0) {
+    return NSAPI_ERROR_PARAMETER;
+  }
+
+  *retry = false;
+  Timer timer;
+  timer.start();
+
+  nsapi_error_t err = send_all(conn->socket, http_request, length);
+  if (err != NSAPI_ERROR_OK) {
+    *retry = true;
+    close(conn);
+    return err;
+  }
+
+  HttpResponseParser response;
+  PartFilter filter = {&response, &body};
+  HttpBodyCallback part = callback(only_partial, &filter);
+  BodyDecoder decoder = {&response, &_inflater, continuation ? &part : &body,
+                         false, false};
+  HttpBodyCallback decoded = callback(decode_body, &decoder);
+  char buffer[HTTP_CHUNK_SIZE];
+  size_t received = 0;
+  size_t discarded = 0;
+  nsapi_size_or_error_t result = 0;
+
+  while (!response.done() && !response.failed()) {
+    result = conn->socket->recv(buffer, sizeof(buffer));
+    if (result <= 0) {
+      if (result == 0) {
+        response.finish();
+      }
+      break;
+    }
+    if (received == 0) {
+      _stats.last_ttfb_ms =
+          duration_cast<milliseconds>(timer.elapsed_time()).count();
+    }
+    received += result;
+
+    if (!response.wanted()) {
+      // Reading a short rest of the body keeps the connection usable,
+      // a long one costs more than a new handshake
+      discarded += result;
+      if (discarded > HTTP_DRAIN_LIMIT) {
+        break;
+      }
+    }
+    response.parse(buffer, result, &decoded);
+  }
+
+  conn->last_used = Kernel::Clock::now();
+  _stats.last_received = received;
+  _stats.last_decoded =
+      decoder.started ? _inflater.total_out() : response.body_length();
+  if (!response.done() || !response.keep_alive()) {
+    close(conn);
+  }
+
+  int status = response.status();
+  if (validators && response.headers_done() &&
+      (status == 200 || status == 206)) {
+    strcpy(validators->etag, response.etag());
+    strcpy(validators->last_modified, response.last_modified());
+  }
+  if (range && response.headers_done()) {
+    range->total = status == 206 ? response.range_total() : 0;
+  }
+
+  if (received == 0) {
+    *retry = true;
+    return result < 0 ? result : NSAPI_ERROR_NO_CONNECTION;
+  }
+  if (decoder.refused) {
+    return NSAPI_ERROR_DEVICE_ERROR;
+  }
+  if (decoder.started &&
+      (_inflater.failed() || (response.done() && response.wanted()))) {
+    // Corrupt, cut short, or reaching back past the inflate window
+    return NSAPI_ERROR_DEVICE_ERROR;
+  }
+  if (response.done() || !response.wanted()) {
+    return status;
+  }
+  if (result < 0) {
+    return result;
+  }
+  // Closed before the end, or a response this parser cannot frame
+  return result == 0 ? NSAPI_ERROR_CONNECTION_LOST : NSAPI_ERROR_DEVICE_ERROR;
+}
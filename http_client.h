@@ -0,0 +1,144 @@
+/**
+ * @file http_client.h
+ * @brief Small HTTPS GET client that keeps one TLS connection per host open
+ * between requests, so repeated fetches skip the TCP and TLS handshakes.
+ */
+#ifndef __HTTP_CLIENT_H__
+#define __HTTP_CLIENT_H__
+
+#include "TLSSocket.h"
+#include "dns_cache.h"
+#include "http_response.h"
+#include "inflate.h"
+#include "mbed.h"
+
+#define HTTP_HOST_SIZE 64
+#define HTTP_CHUNK_SIZE 512
+#define HTTP_TIMEOUT_MS 5000
+
+/*
+When the body callback stops early, up to this many more bytes are read
+and dropped to reach the end of the response and keep the connection.
+*/
+#define HTTP_DRAIN_LIMIT 4096
+
+/*
+Ask for gzip or deflate bodies, which the BBC feed and the JSON APIs shrink
+to a fourth. Requests with a Range always ask for the identity coding, the
+offsets of a compressed part would not line up with the document, and a
+206 that comes compressed anyway is an error.
+*/
+#ifdef MBED_CONF_APP_HTTP_COMPRESSION
+#define HTTP_COMPRESSION MBED_CONF_APP_HTTP_COMPRESSION
+#else
+#define HTTP_COMPRESSION 1
+#endif
+
+/*
+Every open TLS connection keeps its mbedtls context and record buffers, so
+only a couple are kept. Servers drop idle connections after a while anyway,
+and writing into one they already closed only costs a failed request, so
+connections idle for longer than HTTP_IDLE_TIMEOUT are closed first.
+*/
+#define HTTP_CLIENT_MAX_HOSTS 2
+#define HTTP_IDLE_TIMEOUT 30s
+
+/*
+TLSSocket runs mbedtls_ssl_setup() inside connect(), so there is no point
+where a saved session could be handed to the context before the handshake.
+A lost connection therefore costs a full handshake; the saving comes from
+not closing connections the server is willing to keep.
+*/
+
+struct HttpStats {
+  uint32_t requests;
+  uint32_t handshakes;
+  uint32_t reused;
+  uint32_t last_connect_ms; // DNS, TCP and TLS, 0 when the socket was reused
+  uint32_t last_ttfb_ms;    // request sent to first response byte
+  uint32_t last_received;   // response bytes read, headers included
+  uint32_t last_decoded;    // body bytes after undoing Content-Encoding
+};
+
+/**
+ * Validators of the last full response for one URL. Sent back as
+ * If-None-Match and If-Modified-Since, so an unchanged document comes back
+ * as a 304 without a body. Start zeroed.
+ */
+struct HttpValidators {
+  char etag[HTTP_VALIDATOR_SIZE];
+  char last_modified[HTTP_VALIDATOR_SIZE];
+};
+
+/**
+ * Part of a document to ask for with a Range header. A server that ignores
+ * it answers 200 with the whole document.
+ */
+struct HttpRange {
+  uint32_t first;
+  uint32_t last;  // inclusive
+  uint32_t total; // set from a 206, 0 when the server did not say
+};
+
+class HttpClient {
+public:
+  /**
+   * @param dns optional cache for the host lookups
+   */
+  explicit HttpClient(NetworkInterface *network, DnsCache *dns = nullptr);
+  ~HttpClient();
+
+  /**
+   * @brief GET https://host/path and hand the body to a callback
+   * @param ca_cert PEM root certificate for the host
+   * @param validators makes the request conditional when set, and is
+   * updated from a 200 or 206 response
+   * @param range asks for part of the document. When first is not 0 the
+   * validators are sent as If-Range, and the body is only handed on if the
+   * answer is that part (206), not the whole changed document (200).
+   * @return HTTP status code, or a negative nsapi error:
+   * NSAPI_ERROR_DEVICE_ERROR when the body cannot be decoded, e.g. a 206
+   * that came compressed
+   */
+  int get(const char *host, const char *path, const char *ca_cert,
+          HttpBodyCallback body, HttpValidators *validators = nullptr,
+          HttpRange *range = nullptr);
+
+  /**
+   * @brief close connections idle for longer than HTTP_IDLE_TIMEOUT
+   */
+  void close_idle();
+
+  /**
+   * @brief close every kept connection
+   */
+  void close_all();
+
+  const HttpStats &stats() const { return _stats; }
+
+private:
+  struct Connection {
+    char host[HTTP_HOST_SIZE];
+    TLSSocket *socket;
+    Kernel::Clock::time_point last_used;
+  };
+
+  Connection *slot(const char *host);
+  nsapi_error_t connect(Connection *conn, const char *host,
+                        const char *ca_cert);
+  void close(Connection *conn);
+  nsapi_error_t send_all(TLSSocket *socket, const char *data, size_t size);
+  int request(Connection *conn, const char *host, const char *path,
+              HttpBodyCallback &body, HttpValidators *validators,
+              HttpRange *range, bool *retry);
+
+  NetworkInterface *_network;
+  DnsCache *_dns;
+  Connection _connections[HTTP_CLIENT_MAX_HOSTS];
+  int _next_victim;
+  HttpStats _stats;
+  // Here rather than on the stack of the calling thread, with its window
+  Inflater _inflater;
+};
+
+#endif
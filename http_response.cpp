@@ -0,0 +1,316 @@
+/**
+ * @file http_response.cpp
+ * @brief Streaming HTTP/1.1 response parser, see http_response.h
+ */
+#include "http_response.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+// Case-insensitive search for a token in a comma separated header value
+static bool has_token(const char *value, const char *token) {
+  size_t length = strlen(token);
+  while (*value) {
+    while (*value == ' ' || *value == '\t' || *value == ',') {
+      value++;
+    }
+    const char *end = value;
+    while (*end && *end != ',' && *end != ' ' && *end != '\t') {
+      end++;
+    }
+    if ((size_t)(end - value) == length &&
+        strncasecmp(value, token, length) == 0) {
+      return true;
+    }
+    value = end;
+  }
+  return false;
+}
+
+HttpResponseParser::HttpResponseParser() { reset(); }
+
+void HttpResponseParser::reset() {
+  _state = STATUS_LINE;
+  _status = 0;
+  _keep_alive = true;
+  _chunked = false;
+  _has_length = false;
+  _wanted = true;
+  _remaining = 0;
+  _body_length = 0;
+  _line_length = 0;
+  _line_overflow = false;
+  _etag[0] = '\0';
+  _last_modified[0] = '\0';
+  _range_total = 0;
+  _encoding = IDENTITY;
+}
+
+size_t HttpResponseParser::parse(const char *data, size_t size,
+                                 HttpBodyCallback *body) {
+  size_t i = 0;
+
+  while (i < size && _state != DONE && _state != FAILED) {
+    switch (_state) {
+    case BODY: {
+      size_t n = size - i;
+      if ((_has_length || _chunked) && n > _remaining) {
+        n = _remaining;
+      }
+      body_data(data + i, n, body);
+      i += n;
+      if (_has_length || _chunked) {
+        _remaining -= n;
+        if (_remaining == 0) {
+          _state = _chunked ? CHUNK_END : DONE;
+        }
+      }
+      break;
+    }
+
+    case CHUNK_END: {
+      // CRLF after the chunk data
+      char c = data[i++];
+      if (c == '\n') {
+        _state = CHUNK_SIZE;
+      } else if (c != '\r') {
+        _state = FAILED;
+      }
+      break;
+    }
+
+    default: {
+      char c = data[i++];
+      if (c == '\n') {
+        _line[_line_length] = '\0';
+        line_done();
+        _line_length = 0;
+        _line_overflow = false;
+      } else if (c != '\r') {
+        if (_line_length < HTTP_LINE_SIZE - 1) {
+          _line[_line_length++] = c;
+        } else {
+          _line_overflow = true;
+        }
+      }
+      break;
+    }
+    }
+  }
+  return i;
+}
+
+void HttpResponseParser::finish() {
+  if (_state == BODY && !_chunked && !_has_length) {
+    _state = DONE;
+  } else if (_state != DONE) {
+    _state = FAILED;
+  }
+}
+
+void HttpResponseParser::line_done() {
+  bool ok = true;
+
+  switch (_state) {
+  case STATUS_LINE:
+    // Tolerate blank lines left over before the status line
+    ok = _line_length == 0 || status_line();
+    break;
+  case HEADERS:
+    ok = _line_length ? header_line() : headers_end();
+    break;
+  case CHUNK_SIZE:
+    ok = chunk_size_line();
+    break;
+  case TRAILER:
+    // Trailer fields are not used, an empty line ends the response
+    if (_line_length == 0) {
+      _state = DONE;
+    }
+    break;
+  default:
+    break;
+  }
+
+  if (!ok) {
+    _state = FAILED;
+  }
+}
+
+bool HttpResponseParser::status_line() {
+  // HTTP/1.x SP 3DIGIT [SP reason]
+  const char *line = _line;
+  if (strncmp(line, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)line[7]) ||
+      line[8] != ' ') {
+    return false;
+  }
+  for (int i = 9; i < 12; i++) {
+    if (!isdigit((unsigned char)line[i])) {
+      return false;
+    }
+  }
+  if (line[12] != '\0' && line[12] != ' ') {
+    return false;
+  }
+
+  _status = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+  // HTTP/1.0 closes unless the server says otherwise
+  _keep_alive = line[7] != '0';
+  _state = HEADERS;
+  return true;
+}
+
+bool HttpResponseParser::header_line() {
+  // Continuation lines are obsolete and never carry the headers used here
+  if (_line[0] == ' ' || _line[0] == '\t') {
+    return true;
+  }
+
+  char *value = strchr(_line, ':');
+  if (!value) {
+    return false;
+  }
+  *value++ = '\0';
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  char *end = value + strlen(value);
+  while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+    *--end = '\0';
+  }
+
+  if (strcasecmp(_line, "Content-Length") == 0) {
+    if (_line_overflow || *value == '\0') {
+      return false;
+    }
+    uint32_t length = 0;
+    for (const char *p = value; *p; p++) {
+      if (!isdigit((unsigned char)*p) || length > (UINT32_MAX - 9) / 10) {
+        return false;
+      }
+      length = length * 10 + (*p - '0');
+    }
+    if (_has_length && length != _remaining) {
+      return false;
+    }
+    _has_length = true;
+    _remaining = length;
+  } else if (strcasecmp(_line, "Transfer-Encoding") == 0) {
+    if (_line_overflow) {
+      return false;
+    }
+    // chunked is always the last coding applied
+    size_t length = strlen(value);
+    _chunked = length >= 7 && strcasecmp(value + length - 7, "chunked") == 0;
+  } else if (strcasecmp(_line, "Content-Encoding") == 0) {
+    // Only a single coding can be undone
+    if (_line_overflow) {
+      return false;
+    }
+    if (strcasecmp(value, "gzip") == 0 || strcasecmp(value, "x-gzip") == 0) {
+      _encoding = GZIP;
+    } else if (strcasecmp(value, "deflate") == 0) {
+      _encoding = DEFLATE;
+    } else if (strcasecmp(value, "identity") == 0 || *value == '\0') {
+      _encoding = IDENTITY;
+    } else {
+      return false;
+    }
+  } else if (strcasecmp(_line, "ETag") == 0) {
+    copy_validator(_etag, value);
+  } else if (strcasecmp(_line, "Last-Modified") == 0) {
+    copy_validator(_last_modified, value);
+  } else if (strcasecmp(_line, "Content-Range") == 0) {
+    // bytes first-last/total, the total may be '*'
+    const char *total = strchr(value, '/');
+    _range_total = 0;
+    if (total && !_line_overflow) {
+      for (const char *p = total + 1; isdigit((unsigned char)*p); p++) {
+        if (_range_total > (UINT32_MAX - 9) / 10) {
+          _range_total = 0;
+          break;
+        }
+        _range_total = _range_total * 10 + (*p - '0');
+      }
+    }
+  } else if (strcasecmp(_line, "Connection") == 0) {
+    if (has_token(value, "close")) {
+      _keep_alive = false;
+    } else if (has_token(value, "keep-alive")) {
+      _keep_alive = true;
+    }
+  }
+  return true;
+}
+
+void HttpResponseParser::copy_validator(char *dest, const char *value) {
+  // A cut off value would never match, sending none is better
+  if (_line_overflow || strlen(value) >= HTTP_VALIDATOR_SIZE) {
+    dest[0] = '\0';
+  } else {
+    strcpy(dest, value);
+  }
+}
+
+bool HttpResponseParser::headers_end() {
+  if (_status < 200) {
+    // Interim response, the final status line follows
+    bool keep_alive = _keep_alive;
+    reset();
+    _keep_alive = keep_alive;
+    return true;
+  }
+
+  if (_status == 204 || _status == 304) {
+    _state = DONE;
+  } else if (_chunked) {
+    // Transfer-Encoding overrides Content-Length
+    _has_length = false;
+    _state = CHUNK_SIZE;
+  } else if (_has_length) {
+    _state = _remaining ? BODY : DONE;
+  } else {
+    // The body ends when the server closes the connection
+    _keep_alive = false;
+    _state = BODY;
+  }
+  return true;
+}
+
+bool HttpResponseParser::chunk_size_line() {
+  const char *p = _line;
+  uint32_t size = 0;
+
+  if (!isxdigit((unsigned char)*p)) {
+    return false;
+  }
+  for (; isxdigit((unsigned char)*p); p++) {
+    if (size > (UINT32_MAX >> 4)) {
+      return false;
+    }
+    int digit = isdigit((unsigned char)*p)
+                    ? *p - '0'
+                    : tolower((unsigned char)*p) - 'a' + 10;
+    size = (size << 4) | digit;
+  }
+  // Chunk extensions are ignored
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+  if (*p != '\0' && *p != ';') {
+    return false;
+  }
+
+  _remaining = size;
+  _state = size ? BODY : TRAILER;
+  return true;
+}
+
+void HttpResponseParser::body_data(const char *data, size_t size,
+                                   HttpBodyCallback *body) {
+  _body_length += size;
+  if (_wanted && body && !(*body)(data, size)) {
+    _wanted = false;
+  }
+}
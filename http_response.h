@@ -0,0 +1,135 @@
+/**
+ * @file http_response.h
+ * @brief Streaming HTTP/1.1 response parser. Takes the response in arbitrary
+ * recv() chunks and hands the decoded body to a callback, so no part of the
+ * response has to be buffered by the caller.
+ */
+#ifndef __HTTP_RESPONSE_H__
+#define __HTTP_RESPONSE_H__
+
+#include "mbed.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Longest header line that is looked at. Longer lines are skipped, the
+headers the parser acts on (Content-Length, Transfer-Encoding,
+Content-Encoding, Connection) are always short.
+*/
+#define HTTP_LINE_SIZE 128
+
+// ETag and Last-Modified values that do not fit are not kept
+#define HTTP_VALIDATOR_SIZE 80
+
+/**
+ * Called with each piece of the decoded response body.
+ * @return false when no more of the body is wanted
+ */
+typedef Callback<bool(const char *, size_t)> HttpBodyCallback;
+
+class HttpResponseParser {
+public:
+  // Content-Encoding of the body, which the parser hands on as it is
+  enum Encoding { IDENTITY, GZIP, DEFLATE };
+
+  HttpResponseParser();
+
+  /**
+   * @brief forget the previous response and wait for a new status line
+   */
+  void reset();
+
+  /**
+   * @brief push the next chunk of the response through the parser
+   * @param body called with the decoded body, may be null to discard it.
+   * Once it returns false it is not called again, but the rest of the
+   * response is still framed so done() can be reached.
+   * @return number of bytes consumed, less than size once done() or
+   * failed() is true
+   */
+  size_t parse(const char *data, size_t size, HttpBodyCallback *body);
+
+  /**
+   * @brief the connection was closed, which ends a body that has neither a
+   * length nor chunked framing. Anything else still open is an error.
+   */
+  void finish();
+
+  bool done() const { return _state == DONE; }
+  bool failed() const { return _state == FAILED; }
+  bool headers_done() const { return _state > HEADERS; }
+
+  /**
+   * @return false once the body callback has asked to stop
+   */
+  bool wanted() const { return _wanted; }
+
+  int status() const { return _status; }
+
+  /**
+   * @return true if the connection can carry another request after done()
+   */
+  bool keep_alive() const { return _keep_alive; }
+
+  size_t body_length() const { return _body_length; }
+
+  /**
+   * @return ETag header of the response, empty when there was none
+   */
+  const char *etag() const { return _etag; }
+
+  /**
+   * @return Last-Modified header of the response, empty when there was none
+   */
+  const char *last_modified() const { return _last_modified; }
+
+  /**
+   * @return full document length from the Content-Range of a 206, 0 when
+   * unknown
+   */
+  uint32_t range_total() const { return _range_total; }
+
+  /**
+   * @return coding of the body. Any other than these fails the response.
+   */
+  Encoding encoding() const { return _encoding; }
+
+private:
+  enum State {
+    STATUS_LINE,
+    HEADERS,
+    BODY,
+    CHUNK_SIZE,
+    CHUNK_END,
+    TRAILER,
+    DONE,
+    FAILED
+  };
+
+  void line_done();
+  bool status_line();
+  bool header_line();
+  void copy_validator(char *dest, const char *value);
+  bool headers_end();
+  bool chunk_size_line();
+  void body_data(const char *data, size_t size, HttpBodyCallback *body);
+
+  State _state;
+  int _status;
+  bool _keep_alive;
+  bool _chunked;
+  bool _has_length;
+  bool _wanted;
+  uint32_t _remaining; // body, or current chunk when chunked
+  size_t _body_length;
+  char _line[HTTP_LINE_SIZE];
+  size_t _line_length;
+  bool _line_overflow;
+  char _etag[HTTP_VALIDATOR_SIZE];
+  char _last_modified[HTTP_VALIDATOR_SIZE];
+  uint32_t _range_total;
+  Encoding _encoding;
+};
+
+#endif
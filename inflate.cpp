@@ -0,0 +1,553 @@
+/**
+ * @file inflate.cpp
+ * @brief Resumable deflate decoder, see inflate.h
+ *
+ * Decoding follows zlib's puff.c. Every step first checks that all the bits
+ * it needs are in the bit buffer, and only then consumes them, so a chunk
+ * may end anywhere and the step is simply tried again with the next one.
+ * The bit buffer is refilled to at least 57 bits while input is left, which
+ * covers the longest step: a length code with its extra bits followed by a
+ * distance code with its extra bits, 48 bits.
+ */
+#include "inflate.h"
+
+#include <string.h>
+
+#define WINDOW_MASK (INFLATE_WINDOW_SIZE - 1)
+
+static_assert((INFLATE_WINDOW_SIZE & WINDOW_MASK) == 0,
+              "INFLATE_WINDOW_SIZE must be a power of two");
+
+// peek_symbol() results besides a symbol
+#define SYMBOL_NEED_INPUT -1
+#define SYMBOL_INVALID -2
+
+// gzip FLG bits
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+static const uint16_t length_base[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {
+    1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,
+    97,  129, 193, 257, 385, 513,  769,  1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0,  0,  1,  1,  2,  2,  3,  3,
+                                       4, 4, 5,  5,  6,  6,  7,  7,  8,  8,
+                                       9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+Inflater::Inflater() { reset(GZIP); }
+
+void Inflater::reset(Format format) {
+  _format = format;
+  _state = format == GZIP ? GZIP_HEADER : ZLIB_HEADER;
+  _out = nullptr;
+  _in = nullptr;
+  _in_end = nullptr;
+  _bit_buffer = 0;
+  _bit_count = 0;
+  _final = false;
+  _length = 0;
+  _flags = 0;
+  _header_bytes = 0;
+  _trailer_bytes = format == GZIP ? 8 : 0;
+  _total = 0;
+  _flushed = 0;
+}
+
+bool Inflater::feed(const char *data, size_t size, InflateOutput *out) {
+  _out = out;
+  _in = (const uint8_t *)data;
+  _in_end = _in + size;
+
+  while (_state != DONE && _state != FAILED && _state != STOPPED) {
+    refill();
+    if (!step()) {
+      // Needs more input than this chunk had
+      break;
+    }
+  }
+  flush();
+  _out = nullptr;
+  return _state != DONE && _state != FAILED && _state != STOPPED;
+}
+
+// Returns false when it cannot go on before the next chunk
+bool Inflater::step() {
+  switch (_state) {
+  case GZIP_HEADER:
+    if (!need(8)) {
+      return false;
+    }
+    if (!gzip_header_byte(bits(8))) {
+      _state = FAILED;
+    }
+    return true;
+
+  case GZIP_EXTRA_LENGTH:
+    if (!need(16)) {
+      return false;
+    }
+    _length = bits(16);
+    _state = GZIP_EXTRA;
+    return true;
+
+  case GZIP_EXTRA:
+    if (_length == 0) {
+      _flags &= ~GZIP_FEXTRA;
+      gzip_next_field();
+      return true;
+    }
+    if (!need(8)) {
+      return false;
+    }
+    bits(8);
+    _length--;
+    return true;
+
+  case GZIP_NAME:
+  case GZIP_COMMENT:
+    // Zero terminated
+    if (!need(8)) {
+      return false;
+    }
+    if (bits(8) == 0) {
+      _flags &= _state == GZIP_NAME ? ~GZIP_FNAME : ~GZIP_FCOMMENT;
+      gzip_next_field();
+    }
+    return true;
+
+  case GZIP_HEADER_CRC:
+    if (!need(16)) {
+      return false;
+    }
+    bits(16);
+    _flags &= ~GZIP_FHCRC;
+    gzip_next_field();
+    return true;
+
+  case ZLIB_HEADER: {
+    if (!need(16)) {
+      return false;
+    }
+    // "deflate" is meant to be a zlib stream, but some servers send raw
+    // deflate. A zlib header is CM 8 and a multiple of 31.
+    uint32_t cmf = _bit_buffer & 0xFF;
+    uint32_t flg = (_bit_buffer >> 8) & 0xFF;
+    if ((cmf & 0x0F) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0) {
+      if (flg & 0x20) {
+        // Preset dictionary
+        _state = FAILED;
+        return true;
+      }
+      bits(16);
+      _trailer_bytes = 4;
+    }
+    _state = BLOCK_HEADER;
+    return true;
+  }
+
+  case BLOCK_HEADER: {
+    if (!need(3)) {
+      return false;
+    }
+    _final = bits(1);
+    uint32_t type = bits(2);
+    if (type == 0) {
+      drop(_bit_count % 8);
+      _state = STORED_LENGTH;
+    } else if (type == 1) {
+      fixed_tables();
+      _state = CODES;
+    } else if (type == 2) {
+      _state = TABLE_SIZES;
+    } else {
+      _state = FAILED;
+    }
+    return true;
+  }
+
+  case STORED_LENGTH: {
+    if (!need(32)) {
+      return false;
+    }
+    uint32_t length = bits(16);
+    if (bits(16) != (~length & 0xFFFF)) {
+      _state = FAILED;
+      return true;
+    }
+    _length = length;
+    _state = STORED;
+    return true;
+  }
+
+  case STORED:
+    if (_length == 0) {
+      block_done();
+      return true;
+    }
+    if (!need(8)) {
+      return false;
+    }
+    emit(bits(8));
+    _length--;
+    return true;
+
+  case TABLE_SIZES:
+    if (!need(14)) {
+      return false;
+    }
+    _lit_count = bits(5) + 257;
+    _dist_count = bits(5) + 1;
+    _code_count = bits(4) + 4;
+    if (_lit_count > 286 || _dist_count > 30) {
+      _state = FAILED;
+      return true;
+    }
+    memset(_lengths, 0, 19);
+    _index = 0;
+    _state = CODE_LENGTH_LENGTHS;
+    return true;
+
+  case CODE_LENGTH_LENGTHS:
+    while (_index < _code_count) {
+      if (!need(3)) {
+        return false;
+      }
+      _lengths[code_length_order[_index++]] = bits(3);
+    }
+    // The code length code goes into _dist until the real one is read
+    if (!build(&_dist, _lengths, 19)) {
+      _state = FAILED;
+      return true;
+    }
+    _index = 0;
+    _state = CODE_LENGTHS;
+    return true;
+
+  case CODE_LENGTHS:
+    return code_lengths();
+
+  case CODES:
+    return codes();
+
+  case TRAILER:
+    // CRC-32/Adler-32 and size, TLS already protects the data
+    if (_trailer_bytes == 0) {
+      _state = DONE;
+      return true;
+    }
+    if (!need(8)) {
+      return false;
+    }
+    bits(8);
+    _trailer_bytes--;
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool Inflater::gzip_header_byte(uint8_t c) {
+  // ID1 ID2 CM FLG MTIME(4) XFL OS
+  switch (_header_bytes++) {
+  case 0:
+    return c == 0x1F;
+  case 1:
+    return c == 0x8B;
+  case 2:
+    return c == 8;
+  case 3:
+    _flags = c;
+    return (c & 0xE0) == 0;
+  case 9:
+    gzip_next_field();
+    return true;
+  default:
+    return true;
+  }
+}
+
+// Optional header fields come in this order
+void Inflater::gzip_next_field() {
+  if (_flags & GZIP_FEXTRA) {
+    _state = GZIP_EXTRA_LENGTH;
+  } else if (_flags & GZIP_FNAME) {
+    _state = GZIP_NAME;
+  } else if (_flags & GZIP_FCOMMENT) {
+    _state = GZIP_COMMENT;
+  } else if (_flags & GZIP_FHCRC) {
+    _state = GZIP_HEADER_CRC;
+  } else {
+    _state = BLOCK_HEADER;
+  }
+}
+
+bool Inflater::code_lengths() {
+  unsigned total = _lit_count + _dist_count;
+
+  while (_index < total) {
+    refill();
+    unsigned offset = 0;
+    int symbol = peek_symbol(&_dist, &offset);
+    if (symbol == SYMBOL_NEED_INPUT) {
+      return false;
+    }
+    if (symbol < 0) {
+      _state = FAILED;
+      return true;
+    }
+    if (symbol < 16) {
+      drop(offset);
+      _lengths[_index++] = symbol;
+      continue;
+    }
+
+    // 16 repeats the previous length 3-6 times, 17 and 18 repeat zero
+    // 3-10 and 11-138 times
+    unsigned extra = symbol == 16 ? 2 : symbol == 17 ? 3 : 7;
+    if (offset + extra > _bit_count) {
+      return false;
+    }
+    drop(offset);
+    unsigned repeat = bits(extra) + (symbol == 18 ? 11 : 3);
+    uint8_t length = 0;
+    if (symbol == 16) {
+      if (_index == 0) {
+        _state = FAILED;
+        return true;
+      }
+      length = _lengths[_index - 1];
+    }
+    if (_index + repeat > total) {
+      _state = FAILED;
+      return true;
+    }
+    while (repeat--) {
+      _lengths[_index++] = length;
+    }
+  }
+
+  // Without an end-of-block code the block could never end
+  if (_lengths[256] == 0 || !build(&_lit, _lengths, _lit_count) ||
+      !build(&_dist, _lengths + _lit_count, _dist_count)) {
+    _state = FAILED;
+    return true;
+  }
+  _state = CODES;
+  return true;
+}
+
+bool Inflater::codes() {
+  while (true) {
+    refill();
+    unsigned offset = 0;
+    int symbol = peek_symbol(&_lit, &offset);
+    if (symbol == SYMBOL_NEED_INPUT) {
+      return false;
+    }
+    if (symbol < 0) {
+      _state = FAILED;
+      return true;
+    }
+
+    if (symbol < 256) {
+      drop(offset);
+      emit(symbol);
+      if (_state == STOPPED) {
+        return true;
+      }
+      continue;
+    }
+    if (symbol == 256) {
+      drop(offset);
+      block_done();
+      return true;
+    }
+
+    // Length and distance pair, only consumed once all of it is there
+    symbol -= 257;
+    if (symbol >= 29) {
+      _state = FAILED;
+      return true;
+    }
+    unsigned extra = length_extra[symbol];
+    if (offset + extra > _bit_count) {
+      return false;
+    }
+    uint32_t length = length_base[symbol] +
+                      ((_bit_buffer >> offset) & ((1u << extra) - 1));
+    offset += extra;
+
+    symbol = peek_symbol(&_dist, &offset);
+    if (symbol == SYMBOL_NEED_INPUT) {
+      return false;
+    }
+    if (symbol < 0 || symbol >= 30) {
+      _state = FAILED;
+      return true;
+    }
+    extra = dist_extra[symbol];
+    if (offset + extra > _bit_count) {
+      return false;
+    }
+    uint32_t distance = dist_base[symbol] +
+                        ((_bit_buffer >> offset) & ((1u << extra) - 1));
+    offset += extra;
+    drop(offset);
+
+    if (distance > _total || distance > INFLATE_WINDOW_SIZE) {
+      // Before the start, or further back than the window keeps
+      _state = FAILED;
+      return true;
+    }
+    while (length--) {
+      emit(_window[(_total - distance) & WINDOW_MASK]);
+      if (_state == STOPPED) {
+        return true;
+      }
+    }
+  }
+}
+
+void Inflater::block_done() {
+  if (_final) {
+    // The trailer starts at the next byte
+    drop(_bit_count % 8);
+    _state = TRAILER;
+  } else {
+    _state = BLOCK_HEADER;
+  }
+}
+
+void Inflater::refill() {
+  while (_bit_count <= 56 && _in < _in_end) {
+    _bit_buffer |= (uint64_t)*_in++ << _bit_count;
+    _bit_count += 8;
+  }
+}
+
+bool Inflater::need(unsigned n) {
+  refill();
+  return _bit_count >= n;
+}
+
+uint32_t Inflater::bits(unsigned n) {
+  uint32_t value = _bit_buffer & ((1ull << n) - 1);
+  drop(n);
+  return value;
+}
+
+void Inflater::drop(unsigned n) {
+  _bit_buffer >>= n;
+  _bit_count -= n;
+}
+
+// Canonical decoding one bit at a time, as in puff.c. offset is the number
+// of bits of the buffer already used by this step.
+int Inflater::peek_symbol(const Huffman *h, unsigned *offset) const {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int length = 1; length < 16; length++) {
+    if (*offset >= _bit_count) {
+      return SYMBOL_NEED_INPUT;
+    }
+    code |= (_bit_buffer >> (*offset)++) & 1;
+    int count = h->count[length];
+    if (code - count < first) {
+      return h->symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return SYMBOL_INVALID;
+}
+
+bool Inflater::build(Huffman *h, const uint8_t *lengths, unsigned n) {
+  uint16_t offsets[16];
+
+  memset(h->count, 0, sizeof(h->count));
+  for (unsigned symbol = 0; symbol < n; symbol++) {
+    h->count[lengths[symbol]]++;
+  }
+  if (h->count[0] == n) {
+    // No codes, any use of the table fails
+    return true;
+  }
+
+  // Over-subscribed lengths are invalid, incomplete ones are accepted
+  int left = 1;
+  for (int length = 1; length < 16; length++) {
+    left <<= 1;
+    left -= h->count[length];
+    if (left < 0) {
+      return false;
+    }
+  }
+
+  offsets[1] = 0;
+  for (int length = 1; length < 15; length++) {
+    offsets[length + 1] = offsets[length] + h->count[length];
+  }
+  for (unsigned symbol = 0; symbol < n; symbol++) {
+    if (lengths[symbol] != 0) {
+      h->symbol[offsets[lengths[symbol]]++] = symbol;
+    }
+  }
+  return true;
+}
+
+void Inflater::fixed_tables() {
+  unsigned symbol = 0;
+  for (; symbol < 144; symbol++) {
+    _lengths[symbol] = 8;
+  }
+  for (; symbol < 256; symbol++) {
+    _lengths[symbol] = 9;
+  }
+  for (; symbol < 280; symbol++) {
+    _lengths[symbol] = 7;
+  }
+  for (; symbol < 288; symbol++) {
+    _lengths[symbol] = 8;
+  }
+  build(&_lit, _lengths, 288);
+
+  for (symbol = 0; symbol < 30; symbol++) {
+    _lengths[symbol] = 5;
+  }
+  build(&_dist, _lengths, 30);
+}
+
+void Inflater::emit(uint8_t c) {
+  _window[_total & WINDOW_MASK] = c;
+  _total++;
+  if ((_total & WINDOW_MASK) == 0) {
+    // The window wraps, hand on everything before it is overwritten
+    flush();
+  }
+}
+
+void Inflater::flush() {
+  if (_flushed == _total || _state == STOPPED) {
+    return;
+  }
+  uint32_t start = _flushed & WINDOW_MASK;
+  uint32_t length = _total - _flushed;
+  _flushed = _total;
+  if (_out && !(*_out)((const char *)&_window[start], length)) {
+    _state = STOPPED;
+  }
+}
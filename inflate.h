@@ -0,0 +1,131 @@
+/**
+ * @file inflate.h
+ * @brief Streaming gzip/zlib/raw deflate decoder. Takes the compressed body
+ * in arbitrary recv() chunks and hands the decoded bytes to a callback, with
+ * a fixed history window instead of the 32 KB deflate allows.
+ */
+#ifndef __INFLATE_H__
+#define __INFLATE_H__
+
+#include "mbed.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+A back-reference can only reach as far back as the data decoded so far, so
+a window of this size decodes the first INFLATE_WINDOW_SIZE bytes of any
+stream. Further on, a match reaching beyond the window fails the stream.
+The parsers stop after a few KB, which is why a small window is enough.
+Must be a power of two.
+*/
+#define INFLATE_WINDOW_SIZE 8192
+
+/**
+ * Called with each piece of decoded data.
+ * @return false when no more is wanted
+ */
+typedef Callback<bool(const char *, size_t)> InflateOutput;
+
+class Inflater {
+public:
+  enum Format {
+    GZIP,   // RFC 1952
+    DEFLATE // zlib stream (RFC 1950), or raw deflate as some servers send
+  };
+
+  Inflater();
+
+  /**
+   * @brief start a new stream
+   */
+  void reset(Format format);
+
+  /**
+   * @brief push the next chunk of compressed data
+   * @return false once done(), failed() or the output asked to stop
+   */
+  bool feed(const char *data, size_t size, InflateOutput *out);
+
+  bool done() const { return _state == DONE; }
+  bool failed() const { return _state == FAILED; }
+
+  /**
+   * @return decoded bytes so far
+   */
+  uint32_t total_out() const { return _total; }
+
+private:
+  enum State {
+    GZIP_HEADER,
+    GZIP_EXTRA_LENGTH,
+    GZIP_EXTRA,
+    GZIP_NAME,
+    GZIP_COMMENT,
+    GZIP_HEADER_CRC,
+    ZLIB_HEADER,
+    BLOCK_HEADER,
+    STORED_LENGTH,
+    STORED,
+    TABLE_SIZES,
+    CODE_LENGTH_LENGTHS,
+    CODE_LENGTHS,
+    CODES,
+    TRAILER,
+    DONE,
+    STOPPED, // the output wants no more
+    FAILED
+  };
+
+  // Canonical Huffman code, count of codes per length and symbols in order
+  struct Huffman {
+    uint16_t count[16];
+    uint16_t symbol[288];
+  };
+
+  bool step();
+  bool gzip_header_byte(uint8_t c);
+  void gzip_next_field();
+  bool code_lengths();
+  bool codes();
+  void block_done();
+
+  void refill();
+  bool need(unsigned n);
+  uint32_t bits(unsigned n);
+  void drop(unsigned n);
+  int peek_symbol(const Huffman *h, unsigned *offset) const;
+  static bool build(Huffman *h, const uint8_t *lengths, unsigned n);
+  void fixed_tables();
+  void emit(uint8_t c);
+  void flush();
+
+  State _state;
+  Format _format;
+  InflateOutput *_out;
+  const uint8_t *_in;
+  const uint8_t *_in_end;
+  uint64_t _bit_buffer;
+  unsigned _bit_count;
+
+  bool _final;      // last block
+  uint32_t _length; // bytes left in a stored block or header field
+  uint8_t _flags;   // gzip FLG
+  unsigned _header_bytes;
+  unsigned _trailer_bytes; // CRC and size after the last block
+
+  unsigned _lit_count; // HLIT + 257
+  unsigned _dist_count;
+  unsigned _code_count; // HCLEN + 4
+  unsigned _index;      // code lengths read so far
+  uint8_t _lengths[288 + 32];
+
+  Huffman _lit;
+  Huffman _dist;
+
+  uint8_t _window[INFLATE_WINDOW_SIZE];
+  uint32_t _total;   // decoded bytes
+  uint32_t _flushed; // decoded bytes handed to the output
+};
+
+#endif
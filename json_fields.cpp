@@ -0,0 +1,161 @@
+/**
+ * @file json_fields.cpp
+ * @brief Field sink, see json_fields.h
+ */
+#include "json_fields.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+Each open container remembers the length of its own path, so a key or
+array index only rewrites the last segment.
+*/
+JsonFieldSink::JsonFieldSink(const JsonField *fields, size_t count, void *out)
+    : _fields(fields), _count(count), _out((char *)out) {
+  reset();
+}
+
+void JsonFieldSink::reset() {
+  _found = 0;
+  _depth = 0;
+  _skip = 0;
+  _path_length = 0;
+  _path[0] = '\0';
+  _is_array[0] = false;
+  _index[0] = 0;
+  _base[0] = 0;
+}
+
+bool JsonFieldSink::start_container(bool is_array) {
+  if (_skip || _depth == JSON_MAX_DEPTH - 1) {
+    // Too deep to track, ignore the whole subtree
+    _skip++;
+    return true;
+  }
+  element_path();
+  _depth++;
+  _is_array[_depth] = is_array;
+  _index[_depth] = 0;
+  _base[_depth] = _path_length;
+  return true;
+}
+
+bool JsonFieldSink::end_container() {
+  if (_skip) {
+    _skip--;
+  } else if (_depth > 0) {
+    _depth--;
+  }
+  return true;
+}
+
+bool JsonFieldSink::key(const char *name, size_t length) {
+  if (_skip) {
+    return true;
+  }
+  _path_length = _base[_depth];
+  append("/", 1);
+  // JSON pointer escapes for '~' and '/'
+  for (size_t i = 0; i < length; i++) {
+    if (name[i] == '~') {
+      append("~0", 2);
+    } else if (name[i] == '/') {
+      append("~1", 2);
+    } else {
+      append(&name[i], 1);
+    }
+  }
+  return true;
+}
+
+bool JsonFieldSink::string(const char *value, size_t length) {
+  const JsonField *field = match();
+  if (field && field->type == JSON_FIELD_STRING && field->size > 0) {
+    if (length > field->size - 1) {
+      length = field->size - 1;
+    }
+    char *dest = _out + field->offset;
+    memcpy(dest, value, length);
+    dest[length] = '\0';
+    mark(field);
+  }
+  return !all_found();
+}
+
+bool JsonFieldSink::number(double value, int64_t integer) {
+  const JsonField *field = match();
+  if (field) {
+    void *dest = _out + field->offset;
+    switch (field->type) {
+    case JSON_FIELD_INT:
+      *(int *)dest = (int)integer;
+      mark(field);
+      break;
+    case JSON_FIELD_FLOAT:
+      *(float *)dest = (float)value;
+      mark(field);
+      break;
+    case JSON_FIELD_DOUBLE:
+      *(double *)dest = value;
+      mark(field);
+      break;
+    default:
+      break;
+    }
+  }
+  return !all_found();
+}
+
+bool JsonFieldSink::boolean(bool value) {
+  const JsonField *field = match();
+  if (field && field->type == JSON_FIELD_BOOL) {
+    *(bool *)(_out + field->offset) = value;
+    mark(field);
+  }
+  return !all_found();
+}
+
+bool JsonFieldSink::null() {
+  match();
+  return !all_found();
+}
+
+// Path of the value about to be reported, array elements get their index
+void JsonFieldSink::element_path() {
+  if (_is_array[_depth]) {
+    char index[12];
+    int length =
+        snprintf(index, sizeof(index), "/%u", (unsigned)_index[_depth]++);
+    _path_length = _base[_depth];
+    append(index, length);
+  }
+}
+
+const JsonField *JsonFieldSink::match() {
+  if (_skip) {
+    return nullptr;
+  }
+  element_path();
+  if (_path_length >= JSON_PATH_SIZE - 1) {
+    // Truncated path, cannot be compared
+    return nullptr;
+  }
+  _path[_path_length] = '\0';
+  for (size_t i = 0; i < _count; i++) {
+    if (!(_found & (1u << i)) && strcmp(_fields[i].path, _path) == 0) {
+      return &_fields[i];
+    }
+  }
+  return nullptr;
+}
+
+void JsonFieldSink::append(const char *text, size_t length) {
+  if (_path_length + length > JSON_PATH_SIZE - 1) {
+    // Remember that the path overflowed without writing past the buffer
+    _path_length = JSON_PATH_SIZE - 1;
+    return;
+  }
+  memcpy(_path + _path_length, text, length);
+  _path_length += length;
+}
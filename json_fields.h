@@ -0,0 +1,121 @@
+/**
+ * @file json_fields.h
+ * @brief A fixed list of fields to pull out of a JSON document, and the sink
+ * that stores them straight into a struct as parse events arrive.
+ */
+#ifndef __JSON_FIELDS_H__
+#define __JSON_FIELDS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_PATH_SIZE 96
+#define JSON_MAX_DEPTH 8
+#define JSON_MAX_FIELDS 32
+
+enum JsonFieldType {
+  JSON_FIELD_STRING, // char[N], truncated and always NUL terminated
+  JSON_FIELD_INT,
+  JSON_FIELD_FLOAT,
+  JSON_FIELD_DOUBLE,
+  JSON_FIELD_BOOL
+};
+
+/**
+ * One field to extract. path is a JSON pointer such as "/current/temp_c",
+ * array elements are addressed by index ("/list/0/name").
+ */
+struct JsonField {
+  const char *path;
+  JsonFieldType type;
+  size_t offset;
+  size_t size;
+};
+
+template <typename M> struct JsonFieldTraits;
+template <size_t N> struct JsonFieldTraits<char[N]> {
+  static constexpr JsonFieldType type = JSON_FIELD_STRING;
+};
+template <> struct JsonFieldTraits<int> {
+  static constexpr JsonFieldType type = JSON_FIELD_INT;
+};
+template <> struct JsonFieldTraits<float> {
+  static constexpr JsonFieldType type = JSON_FIELD_FLOAT;
+};
+template <> struct JsonFieldTraits<double> {
+  static constexpr JsonFieldType type = JSON_FIELD_DOUBLE;
+};
+template <> struct JsonFieldTraits<bool> {
+  static constexpr JsonFieldType type = JSON_FIELD_BOOL;
+};
+
+/*
+Describe a member of a struct as a field, the type is taken from the
+member's declaration:
+
+  static const JsonField fields[] = {
+      JSON_FIELD(Weather, temp_c, "/current/temp_c"),
+  };
+*/
+#define JSON_FIELD(record, member, path)                                      \
+  {                                                                            \
+    path, JsonFieldTraits<decltype(record::member)>::type,                     \
+        offsetof(record, member), sizeof(record::member)                       \
+  }
+
+/**
+ * @return true when every one of count fields is set in found
+ */
+inline bool json_all_found(uint32_t found, size_t count) {
+  return count >= 32 ? found == 0xFFFFFFFFu : found == (1u << count) - 1;
+}
+
+template <size_t N>
+bool json_all_found(uint32_t found, const JsonField (&)[N]) {
+  return json_all_found(found, N);
+}
+
+/**
+ * Receives parse events, keeps the JSON pointer of the current value in a
+ * fixed buffer and stores the values whose path is in the field list. Every
+ * event returns false once all fields have been found, so a parser feeding
+ * it can stop.
+ */
+class JsonFieldSink {
+public:
+  JsonFieldSink(const JsonField *fields, size_t count, void *out);
+
+  void reset();
+
+  bool start_container(bool is_array);
+  bool end_container();
+  bool key(const char *name, size_t length);
+  bool string(const char *value, size_t length);
+  bool number(double value, int64_t integer);
+  bool boolean(bool value);
+  bool null();
+
+  uint32_t found() const { return _found; }
+  bool all_found() const { return json_all_found(_found, _count); }
+
+private:
+  void element_path();
+  const JsonField *match();
+  void mark(const JsonField *field) { _found |= 1u << (field - _fields); }
+  void append(const char *text, size_t length);
+
+  const JsonField *_fields;
+  size_t _count;
+  char *_out;
+  uint32_t _found;
+
+  size_t _depth;
+  size_t _skip;
+  bool _is_array[JSON_MAX_DEPTH];
+  uint32_t _index[JSON_MAX_DEPTH];
+  size_t _base[JSON_MAX_DEPTH];
+  char _path[JSON_PATH_SIZE];
+  size_t _path_length;
+};
+
+#endif
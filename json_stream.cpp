@@ -0,0 +1,338 @@
+/**
+ * @file json_stream.cpp
+ * @brief Push-style JSON tokenizer, see json_stream.h
+ */
+#include "json_stream.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+JsonStreamParser::JsonStreamParser(const JsonField *fields, size_t count,
+                                   void *out)
+    : _sink(fields, count > JSON_MAX_FIELDS ? 0 : count, out) {
+  reset();
+}
+
+void JsonStreamParser::reset() {
+  _state = VALUE;
+  _stack = 0;
+  _depth = 0;
+  _is_key = false;
+  _token_length = 0;
+  _high_surrogate = 0;
+  _literal = nullptr;
+  _sink.reset();
+}
+
+bool JsonStreamParser::feed(const char *data, size_t size) {
+  size_t i = 0;
+  while (i < size && _state != DONE && _state != FAILED) {
+    // A number only ends at the next character, which is then read again
+    if (step(data[i])) {
+      i++;
+    }
+  }
+  return _state != DONE && _state != FAILED;
+}
+
+void JsonStreamParser::finish() {
+  if (_state == NUMBER && _depth == 0) {
+    number_done();
+  }
+  if (_state != DONE) {
+    _state = FAILED;
+  }
+}
+
+bool JsonStreamParser::step(char c) {
+  switch (_state) {
+  case ARRAY_FIRST:
+    if (c == ']') {
+      return close();
+    }
+    if (is_space(c)) {
+      return true;
+    }
+    _state = VALUE;
+    return false;
+
+  case VALUE:
+    if (is_space(c)) {
+      return true;
+    }
+    if (c == '{') {
+      return open(false);
+    }
+    if (c == '[') {
+      return open(true);
+    }
+    if (c == '"') {
+      _is_key = false;
+      _token_length = 0;
+      _state = STRING;
+      return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      _token_length = 0;
+      token_append(c);
+      _state = NUMBER;
+      return true;
+    }
+    if (c == 't' || c == 'f' || c == 'n') {
+      _literal_kind = c;
+      _literal = c == 't' ? "rue" : c == 'f' ? "alse" : "ull";
+      _state = LITERAL;
+      return true;
+    }
+    break;
+
+  case OBJECT_FIRST:
+  case KEY:
+    if (is_space(c)) {
+      return true;
+    }
+    if (c == '}' && _state == OBJECT_FIRST) {
+      return close();
+    }
+    if (c == '"') {
+      _is_key = true;
+      _token_length = 0;
+      _state = STRING;
+      return true;
+    }
+    break;
+
+  case COLON:
+    if (is_space(c)) {
+      return true;
+    }
+    if (c == ':') {
+      _state = VALUE;
+      return true;
+    }
+    break;
+
+  case AFTER_VALUE:
+    if (is_space(c)) {
+      return true;
+    }
+    if (c == ',') {
+      _state = in_array() ? VALUE : KEY;
+      return true;
+    }
+    if (c == ']' && in_array()) {
+      return close();
+    }
+    if (c == '}' && !in_array()) {
+      return close();
+    }
+    break;
+
+  case STRING:
+    if (_high_surrogate && c != '\\') {
+      // Lone high surrogate
+      token_append_utf8(0xFFFD);
+      _high_surrogate = 0;
+    }
+    if (c == '"') {
+      return string_done();
+    }
+    if (c == '\\') {
+      _state = STRING_ESCAPE;
+      return true;
+    }
+    if ((unsigned char)c < 0x20) {
+      break;
+    }
+    token_append(c);
+    return true;
+
+  case STRING_ESCAPE: {
+    if (_high_surrogate && c != 'u') {
+      token_append_utf8(0xFFFD);
+      _high_surrogate = 0;
+    }
+    static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+    if (c == 'u') {
+      _unicode = 0;
+      _unicode_digits = 0;
+      _state = STRING_UNICODE;
+      return true;
+    }
+    for (const char *e = escapes; *e; e += 2) {
+      if (*e == c) {
+        token_append(e[1]);
+        _state = STRING;
+        return true;
+      }
+    }
+    break;
+  }
+
+  case STRING_UNICODE: {
+    int digit = hex_value(c);
+    if (digit < 0) {
+      break;
+    }
+    _unicode = (_unicode << 4) | digit;
+    if (++_unicode_digits < 4) {
+      return true;
+    }
+    _state = STRING;
+    if (_unicode >= 0xD800 && _unicode <= 0xDBFF) {
+      if (_high_surrogate) {
+        token_append_utf8(0xFFFD);
+      }
+      _high_surrogate = _unicode;
+    } else if (_unicode >= 0xDC00 && _unicode <= 0xDFFF) {
+      if (_high_surrogate) {
+        token_append_utf8(0x10000 + ((_high_surrogate - 0xD800) << 10) +
+                          (_unicode - 0xDC00));
+      } else {
+        token_append_utf8(0xFFFD);
+      }
+      _high_surrogate = 0;
+    } else {
+      token_append_utf8(_unicode);
+    }
+    return true;
+  }
+
+  case NUMBER:
+    if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' ||
+        c == '+' || c == '-') {
+      if (_token_length == JSON_NUMBER_SIZE - 1) {
+        break;
+      }
+      token_append(c);
+      return true;
+    }
+    number_done();
+    return false;
+
+  case LITERAL:
+    if (c != *_literal) {
+      break;
+    }
+    if (*++_literal) {
+      return true;
+    }
+    if (_literal_kind == 'n') {
+      return value_done(_sink.null());
+    }
+    return value_done(_sink.boolean(_literal_kind == 't'));
+
+  default:
+    return true;
+  }
+
+  _state = FAILED;
+  return true;
+}
+
+bool JsonStreamParser::open(bool is_array) {
+  if (_depth == JSON_STREAM_DEPTH) {
+    _state = FAILED;
+    return true;
+  }
+  _sink.start_container(is_array);
+  if (is_array) {
+    _stack |= 1u << _depth;
+  } else {
+    _stack &= ~(1u << _depth);
+  }
+  _depth++;
+  _state = is_array ? ARRAY_FIRST : OBJECT_FIRST;
+  return true;
+}
+
+bool JsonStreamParser::close() {
+  _depth--;
+  return value_done(_sink.end_container());
+}
+
+bool JsonStreamParser::value_done(bool more) {
+  if (!more || _depth == 0) {
+    // Every field found, or the top-level value is complete
+    _state = DONE;
+  } else {
+    _state = AFTER_VALUE;
+  }
+  return true;
+}
+
+bool JsonStreamParser::string_done() {
+  if (_is_key) {
+    // A key longer than the token buffer also overflows the sink's path,
+    // so its truncated form never matches a field
+    _sink.key(_token, _token_length);
+    _state = COLON;
+    return true;
+  }
+  return value_done(_sink.string(_token, _token_length));
+}
+
+bool JsonStreamParser::number_done() {
+  char *end;
+  _token[_token_length] = '\0';
+
+  double value = strtod(_token, &end);
+  if (end != _token + _token_length || _token[_token_length - 1] == '.') {
+    _state = FAILED;
+    return true;
+  }
+
+  int64_t integer = value > -9.2e18 && value < 9.2e18 ? (int64_t)value : 0;
+  if (!strpbrk(_token, ".eE")) {
+    // Exact for integers beyond the 53 bits of a double
+    errno = 0;
+    long long exact = strtoll(_token, NULL, 10);
+    if (errno == 0) {
+      integer = exact;
+    }
+  }
+  return value_done(_sink.number(value, integer));
+}
+
+void JsonStreamParser::token_append(char c) {
+  // Longer strings are truncated, the sink truncates to the field anyway
+  if (_token_length < JSON_TOKEN_SIZE - 1) {
+    _token[_token_length++] = c;
+  }
+}
+
+void JsonStreamParser::token_append_utf8(uint32_t code) {
+  if (code < 0x80) {
+    token_append((char)code);
+  } else if (code < 0x800) {
+    token_append((char)(0xC0 | (code >> 6)));
+    token_append((char)(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    token_append((char)(0xE0 | (code >> 12)));
+    token_append((char)(0x80 | ((code >> 6) & 0x3F)));
+    token_append((char)(0x80 | (code & 0x3F)));
+  } else {
+    token_append((char)(0xF0 | (code >> 18)));
+    token_append((char)(0x80 | ((code >> 12) & 0x3F)));
+    token_append((char)(0x80 | ((code >> 6) & 0x3F)));
+    token_append((char)(0x80 | (code & 0x3F)));
+  }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file json_stream.h
+ * @brief Push-style JSON tokenizer. Takes a document in arbitrary chunks,
+ * e.g. straight from TLSSocket::recv(), and feeds a JsonFieldSink, so fields
+ * are extracted while the response is still arriving.
+ */
+#ifndef __JSON_STREAM_H__
+#define __JSON_STREAM_H__
+
+#include "json_fields.h"
+
+/*
+Longest string or key kept while it is split across chunks. Longer strings
+are truncated, which only matters for string fields of that size. Keys
+longer than this can never match a field path.
+*/
+#define JSON_TOKEN_SIZE 96
+#define JSON_NUMBER_SIZE 32
+
+// Nesting the tokenizer can follow, one bit per level
+#define JSON_STREAM_DEPTH 32
+
+class JsonStreamParser {
+public:
+  /**
+   * @param fields at most JSON_MAX_FIELDS fields
+   * @param out struct the fields are stored into
+   */
+  JsonStreamParser(const JsonField *fields, size_t count, void *out);
+
+  template <size_t N, typename T>
+  JsonStreamParser(const JsonField (&fields)[N], T *out)
+      : JsonStreamParser(fields, N, out) {
+    static_assert(N <= JSON_MAX_FIELDS, "too many fields");
+  }
+
+  /**
+   * @brief forget the previous document, fields already stored are kept
+   */
+  void reset();
+
+  /**
+   * @brief push the next chunk of the document
+   * @return false once done() or failed(), nothing more is needed
+   */
+  bool feed(const char *data, size_t size);
+
+  /**
+   * @brief the document ended, completes a number at the top level
+   */
+  void finish();
+
+  /**
+   * @return true when every field has been found or the document is complete
+   */
+  bool done() const { return _state == DONE; }
+
+  /**
+   * @return true on a syntax error, fields found before it are kept
+   */
+  bool failed() const { return _state == FAILED; }
+
+  uint32_t found() const { return _sink.found(); }
+  bool all_found() const { return _sink.all_found(); }
+
+private:
+  enum State {
+    VALUE,        // expecting a value
+    ARRAY_FIRST,  // after '[', a value or ']'
+    OBJECT_FIRST, // after '{', a key or '}'
+    KEY,          // after ',' in an object, a key
+    COLON,
+    AFTER_VALUE, // ',' or the end of the container
+    STRING,
+    STRING_ESCAPE,
+    STRING_UNICODE,
+    NUMBER,
+    LITERAL,
+    DONE,
+    FAILED
+  };
+
+  bool step(char c);
+  bool open(bool is_array);
+  bool close();
+  bool value_done(bool more);
+  bool string_done();
+  bool number_done();
+  void token_append(char c);
+  void token_append_utf8(uint32_t code);
+  bool in_array() const { return _stack & (1u << (_depth - 1)); }
+
+  JsonFieldSink _sink;
+  State _state;
+  uint32_t _stack; // bit set for arrays
+  size_t _depth;
+  bool _is_key;
+
+  char _token[JSON_TOKEN_SIZE];
+  size_t _token_length;
+  uint32_t _unicode; // \uXXXX being read
+  uint32_t _high_surrogate;
+  uint8_t _unicode_digits;
+  const char *_literal; // rest of true/false/null still expected
+  char _literal_kind;
+};
+
+#endif
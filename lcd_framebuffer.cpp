@@ -0,0 +1,113 @@
+/**
+ * @file lcd_framebuffer.cpp
+ * @brief Shadow-DDRAM frame buffer, see lcd_framebuffer.h
+ */
+#include "lcd_framebuffer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+LcdFrameBuffer::LcdFrameBuffer(DFRobot_RGBLCD1602 *lcd)
+    : _lcd(lcd), _suspended(false) {
+  clear();
+  invalidate();
+}
+
+void LcdFrameBuffer::clear() {
+  memset(_frame, ' ', sizeof(_frame));
+  _col = 0;
+  _row = 0;
+}
+
+void LcdFrameBuffer::setCursor(uint8_t col, uint8_t row) {
+  _col = col;
+  _row = row;
+}
+
+void LcdFrameBuffer::write(char c) {
+  if (_row < LCD_FB_ROWS && _col < LCD_FB_COLS) {
+    _frame[_row][_col] = c;
+  }
+  if (_col < LCD_FB_COLS) {
+    _col++;
+  }
+}
+
+void LcdFrameBuffer::printf(const char *fmt_p, ...) {
+  char buffer[LCD_FB_COLS + 1];
+
+  va_list argptr;
+  va_start(argptr, fmt_p);
+  int length = vsnprintf(buffer, sizeof(buffer), fmt_p, argptr);
+  va_end(argptr);
+
+  if (length > LCD_FB_COLS) {
+    length = LCD_FB_COLS;
+  }
+  for (int i = 0; i < length; i++) {
+    write(buffer[i]);
+  }
+}
+
+void LcdFrameBuffer::invalidate() {
+  _shadowValid = false;
+  _hwCol = -1;
+  _hwRow = -1;
+}
+
+void LcdFrameBuffer::resume() {
+  _suspended = false;
+  invalidate();
+}
+
+int LcdFrameBuffer::flush() {
+  int written = 0;
+
+  if (_suspended) {
+    return 0;
+  }
+
+  for (int row = 0; row < LCD_FB_ROWS; row++) {
+    const char *frame = _frame[row];
+    char *shadow = _shadow[row];
+
+    int col = 0;
+    while (col < LCD_FB_COLS) {
+      if (_shadowValid && frame[col] == shadow[col]) {
+        col++;
+        continue;
+      }
+
+      // Extend the run over short gaps of unchanged cells, rewriting them is
+      // cheaper than starting another transaction with a cursor move.
+      int start = col;
+      int last = col;
+      for (int k = col + 1; k < LCD_FB_COLS; k++) {
+        if (_shadowValid && frame[k] == shadow[k]) {
+          continue;
+        }
+        if (k - last - 1 > LCD_FB_MAX_GAP) {
+          break;
+        }
+        last = k;
+      }
+
+      int length = last - start + 1;
+      if (_hwRow != row || _hwCol != start) {
+        _lcd->writeRunAt(start, row, frame + start, length);
+      } else {
+        _lcd->writeRun(frame + start, length);
+      }
+      memcpy(shadow + start, frame + start, length);
+
+      _hwRow = row;
+      _hwCol = last + 1;
+      written += length;
+      col = last + 1;
+    }
+  }
+
+  _shadowValid = true;
+  return written;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file lcd_framebuffer.h
+ * @brief In-memory 16x2 frame with a shadow copy of the LCD's DDRAM, so a
+ * screen can be redrawn every tick while only changed cells go on the bus.
+ */
+#ifndef __LCD_FRAMEBUFFER_H__
+#define __LCD_FRAMEBUFFER_H__
+
+#include "DFRobot_RGBLCD1602.h"
+
+#define LCD_FB_COLS 16
+#define LCD_FB_ROWS 2
+
+/*
+Unchanged cells between two changed ones are rewritten rather than skipped
+with a cursor move when the gap is at most this many cells. Each run is one
+I2C transaction, and starting a new one costs the address byte, the cursor
+command and the data control byte.
+*/
+#define LCD_FB_MAX_GAP 3
+
+class LcdFrameBuffer {
+public:
+  explicit LcdFrameBuffer(DFRobot_RGBLCD1602 *lcd);
+
+  /**
+   * @brief fill the frame with spaces and put the cursor at (0,0). Nothing is
+   * sent to the display until flush().
+   */
+  void clear();
+
+  /**
+   * @brief set the position of the next character written to the frame
+   * @param col columns optional range 0-15
+   * @param row rows optional range 0-1
+   */
+  void setCursor(uint8_t col, uint8_t row);
+
+  /**
+   * @brief write a character at the cursor, characters past the last column
+   * are dropped
+   */
+  void write(char c);
+
+  void printf(const char *fmt_p, ...);
+
+  /**
+   * @brief forget what is on the display, the next flush() redraws every cell
+   */
+  void invalidate();
+
+  /**
+   * @brief send the cells that differ from the shadow copy to the display
+   * @return number of characters written to the display
+   */
+  int flush();
+
+  /**
+   * @brief hand the display to someone else, e.g. while it is shifted.
+   * flush() sends nothing until resume().
+   */
+  void suspend() { _suspended = true; }
+
+  /**
+   * @brief take the display back, the next flush() redraws every cell
+   */
+  void resume();
+
+  /**
+   * @return the LCD_FB_COLS characters of a row in the frame
+   */
+  const char *row(uint8_t row) const { return _frame[row]; }
+
+private:
+  DFRobot_RGBLCD1602 *_lcd;
+  char _frame[LCD_FB_ROWS][LCD_FB_COLS];
+  char _shadow[LCD_FB_ROWS][LCD_FB_COLS];
+  bool _shadowValid;
+  bool _suspended;
+  uint8_t _col, _row;
+  int _hwCol, _hwRow;
+};
+
+#endif
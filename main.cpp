@@ -2,14 +2,27 @@
  * @file main.cpp
  * @author Krister Srstrand
  */
-#define BLINKING_RATE 500ms
-
 #include "DFRobot_RGBLCD1602.h"
 #include "HTS221Sensor.h"
+#include "alarm_engine.h"
+#include "double_buffer.h"
+#include "drift_estimator.h"
+#include "env_sampler.h"
+#include "headline_ticker.h"
+#include "http_client.h"
 #include "ipgeolocation_ca_cert.h"
-#include "json.hpp"
+#include "json_stream.h"
+#include "lcd_framebuffer.h"
+#include "refresh_scheduler.h"
 #include "mbed.h"
+#include "rss_parser.h"
+#include "sample_history.h"
+#include "snapshot.h"
+#include "sntp_client.h"
+#include "time_zone.h"
+#include "tone_patterns.h"
 #include "weather_ca_cert.h"
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <stdio.h>
@@ -21,7 +34,71 @@
 
 #define BUFFER_SIZE 512
 #define SCROLL_SPEED 200ms
-#define CHUNK_SIZE 500
+
+// Bytes asked for per Range request, the channel header and the BBC items
+// take about 1.5 KB and 700 bytes
+#define RSS_RANGE_SIZE (1536 + RSS_MAX_HEADLINES * 768)
+
+// The whole feed compressed is read to its end, or HTTP_DRAIN_LIMIT past the
+// last headline, and decodes only as far as the inflate window reaches. In
+// between it costs fewer bytes than the plain parts.
+#define RSS_COMPRESSED                                                         \
+  (HTTP_COMPRESSION && RSS_RANGE_SIZE > HTTP_DRAIN_LIMIT &&                    \
+   RSS_RANGE_SIZE <= INFLATE_WINDOW_SIZE)
+
+// TLS handshakes need as much stack as the main thread gets
+#define NET_THREAD_STACK_SIZE 8192
+
+#define NTP_SERVER "pool.ntp.org"
+
+// Time between refreshes, data is shown as old after twice as long. Failed
+// fetches are retried after NET_RETRY, backing off up to the interval. The
+// clock comes from SNTP, the location only for the time zone, whose DST
+// switches are compiled in.
+#define CLOCK_REFRESH 1h
+#define GEO_REFRESH 24h
+#define WEATHER_REFRESH 30min
+#define NEWS_REFRESH 15min
+
+// Shown until the location says where the clock is
+#ifdef MBED_CONF_APP_TIME_ZONE
+#define DEFAULT_TIME_ZONE MBED_CONF_APP_TIME_ZONE
+#else
+#define DEFAULT_TIME_ZONE "UTC"
+#endif
+#define NET_RETRY 30s
+
+#define INTRO_SCREEN_TIME 2s
+#define BUTTON_DEBOUNCE 50ms
+// The buzzer stops by itself after ringing this long
+#define ALARM_RING_TIME 10min
+#define ALARM_SNOOZE_TIME 5min
+// Samples wake the UI in batches, one by one while they are on screen
+#define ENV_UI_BATCH 4
+#define UI_STATS_MINUTES 10
+// Minute ticks that run later than this are counted as late
+#define UI_LATE_LIMIT 50ms
+
+// The snapshot is written this long after what it holds changed, so the
+// results that come in together are one flash write, and headlines that
+// change on every refresh wear the flash slowly. Alarm settings go sooner.
+#define SNAPSHOT_KEY "/kv/snapshot"
+#define SNAPSHOT_DATA_DELAY 30min
+#define SNAPSHOT_SETTINGS_DELAY 5s
+// No snapshot was saved before this (1 January 2026), an older time is an
+// RTC that was never set
+#define SNAPSHOT_EARLIEST_SAVE 1767225600
+// Location, weather and alarm take up to 256 bytes, each headline and the
+// feed's name one full field
+#define SNAPSHOT_SIZE                                                          \
+  (SNAPSHOT_HEADER_SIZE + 256 +                                                \
+   (RSS_MAX_HEADLINES + 1) * (2 + SNAPSHOT_FIELD_MAX))
+
+#ifdef TARGET_DISCO_L475VG_IOT01A
+#define HTS221_DRDY_PIN PD_15
+#else
+#define HTS221_DRDY_PIN NC
+#endif
 
 #ifdef LED1
 DigitalOut led(LED1);
@@ -29,246 +106,401 @@ DigitalOut led(LED1);
 bool led;
 #endif
 
-std::string json_var(nlohmann::json document, std::string path) {
-  std::string location;
-  if (document["geo"][path].is_string()) {
-    location = document["geo"][path].get<std::string>();
-  }
-  return location;
-}
-
-std::string json_var2(nlohmann::json document, std::string path) {
-  std::string location;
-  if (document["location"][path].is_string()) {
-    location = document["location"][path].get<std::string>();
-  }
-  return location;
-}
-
-volatile int state = 0;
-volatile int b2_pressed = 0;
-bool alarm_set = false;
-bool alarm_active = false;
-volatile int a_minutes = 0;
-volatile int a_hours = 0;
-bool muted = false;
+struct GeoInfo {
+  char city[64];
+  char latitude[16];
+  char longitude[16];
+  double unix_time;
+  int dst; // hours east of UTC now, for zones without known rules
+  char zone[TZ_NAME_SIZE];
+};
+
+static const JsonField geo_fields[] = {
+    JSON_FIELD(GeoInfo, city, "/geo/city"),
+    JSON_FIELD(GeoInfo, latitude, "/geo/latitude"),
+    JSON_FIELD(GeoInfo, longitude, "/geo/longitude"),
+    JSON_FIELD(GeoInfo, unix_time, "/date_time_unix"),
+    JSON_FIELD(GeoInfo, dst, "/timezone_offset_with_dst"),
+    JSON_FIELD(GeoInfo, zone, "/timezone"),
+};
+
+// Snapshot fields, the numbers have to stay the same from build to build
+enum SnapshotTag : uint8_t {
+  SNAP_SAVED = 1,      // int64_t, RTC when it was taken, if it was set
+  SNAP_CITY = 2,
+  SNAP_LATITUDE = 3,
+  SNAP_LONGITUDE = 4,
+  SNAP_ZONE = 5,
+  SNAP_UTC_OFFSET = 6, // int, GeoInfo::dst
+  SNAP_WEATHER_CONDITION = 7,
+  SNAP_WEATHER_TEMP = 8, // float
+  SNAP_NEWS_SOURCE = 9,
+  SNAP_HEADLINE = 10, // once per headline
+  SNAP_ALARM = 11,    // hour, minute, weekdays, enabled
+};
+
+struct SnapshotBlob {
+  uint8_t data[SNAPSHOT_SIZE];
+  size_t size;
+};
+
+struct WeatherInfo {
+  char condition[64];
+  float temp_c;
+};
+
+static const JsonField weather_fields[] = {
+    JSON_FIELD(WeatherInfo, condition, "/current/condition/text"),
+    JSON_FIELD(WeatherInfo, temp_c, "/current/temp_c"),
+};
+
+int state = 0; // screen shown, 0-3
+bool setting_alarm = false;
+int a_hours = 0;
+int a_minutes = 0;
+bool alarm_active = false; // ringing
 bool snooze = false;
-bool auto_snooze = false;
 
 InterruptIn button1(A0, PullUp);
 InterruptIn button2(A1, PullUp);
 InterruptIn button3(A2, PullUp);
 InterruptIn button4(A3, PullUp);
-DigitalIn button5(D0, PullUp);
-
-std::chrono::microseconds auto_mute_counter = 600s;//ten minutes
-std::chrono::microseconds snooze_counter = 300s;//5 minutes
+InterruptIn button5(D0, PullUp);
 
 PwmOut Buzzer(D5);
-
-Timeout timer;
-Timeout snooze_timer;
+ToneSequencer tones(&Buzzer); // Plays the buzzer from interrupts
 
 I2C lcdI2C(D14, D15);
 DFRobot_RGBLCD1602 lcd(&lcdI2C, RGB_ADDRESS_V20_7BIT);
+LcdFrameBuffer screen(&lcd);
+EventQueue uiQueue; // Dispatched by the main thread, everything on screen
+HeadlineTicker ticker(&screen, &lcd, &uiQueue); // Scrolls headlines on row 1
 DevI2C i2c(PB_11, PB_10);
-HTS221Sensor sensor(&i2c);
+HTS221Sensor sensor(&i2c, HTS221_I2C_ADDRESS, HTS221_DRDY_PIN);
 
 NetworkInterface *network = nullptr;
+HttpClient *http = nullptr;
+DnsCache *dns = nullptr;
+SntpClient *sntp = nullptr;
 EventQueue mainQueue; // Create EventQueue for main tasks
 Thread mainThread;    // Create Thread for main tasks
-EventQueue rssQueue;  // Create EventQueue for RSS updates
-Thread rssThread;     // Create Thread for RSS updates
-
-void call_back1(void) {
-  state++;
-  if (state == 4) {
-    state = 0;
+EventQueue rssQueue;  // Create EventQueue for network fetches
+Thread rssThread(osPriorityNormal, NET_THREAD_STACK_SIZE); // Network thread
+RefreshScheduler refresher(&rssQueue); // Runs the fetches on rssQueue
+int clock_source;
+int geo_source;
+int weather_source;
+int news_source;
+
+EnvSampler sampler(&sensor, &mainQueue); // Sensor reads run on mainQueue
+SampleHistory history; // Minute, hour and day statistics of the samples
+
+// The RTC keeps UTC. Its own rate error is fitted to the SNTP syncs, and the
+// zone's offset is added, clock screen, minute ticks and alarms all read the
+// time through both.
+DriftEstimator drift;
+TimeZone zone;
+int32_t zone_offset = 0; // the alarms were computed with
+time_t clock_now() { return zone.local(drift.now()); }
+
+void alarm_fired(int id);
+AlarmEngine alarms(&uiQueue, callback(alarm_fired), callback(clock_now));
+int user_alarm; // the one set with the buttons
+int ring_event = 0;   // stops the buzzer
+int minute_event = 0; // next minute_tick
+Kernel::Clock::time_point minute_due;
+int intro_screen = -1;
+
+// Button interrupts only post to uiQueue, the UI thread does the rest
+void on_button(int button);
+
+void call_back1(void) { uiQueue.call(on_button, 1); }
+void call_back2(void) { uiQueue.call(on_button, 2); }
+void call_back3(void) { uiQueue.call(on_button, 3); }
+void call_back4(void) { uiQueue.call(on_button, 4); }
+void call_back5(void) { uiQueue.call(on_button, 5); }
+
+// Results of the network thread, the UI copies them when told they changed
+DoubleBuffer<GeoInfo> geo_result;
+DoubleBuffer<WeatherInfo> weather_result;
+DoubleBuffer<RssFeed> news_result;
+DoubleBuffer<SntpResult> clock_result;
+void network_updated();
+
+// Taken on the UI thread, written to flash on mainQueue. rssThread can sit
+// in connect() for as long as there is no WLAN.
+DoubleBuffer<SnapshotBlob> snapshot_out;
+SnapshotStore snapshot_store(SNAPSHOT_KEY);
+
+// Network thread's own copy, the weather request needs the city
+GeoInfo net_geo;
+bool net_clock_set = false;
+
+GeoInfo geo;
+WeatherInfo weather;
+RssFeed news;
+SntpResult clock_sync;
+uint32_t clock_seen = 0;
+uint32_t geo_seen = 0;
+uint32_t weather_seen = 0;
+uint32_t news_seen = 0;
+uint32_t news_scrolling = 0; // news_seen of the headlines in the ticker
+bool clock_valid = false;    // from SNTP, the location, or the RTC kept it
+bool geo_known = false;      // from the network or the snapshot
+int snapshot_event = 0;      // next save_snapshot
+Kernel::Clock::time_point snapshot_due;
+void snapshot_changed(std::chrono::milliseconds delay);
+int64_t first_clock_ms = -1; // after boot, when the clock was first shown
+
+// Work on the UI thread, which sleeps in between
+struct UiStats {
+  uint32_t events;
+  uint32_t active_us;
+  uint32_t minutes;
+  uint32_t late; // minute ticks later than UI_LATE_LIMIT, since boot
+  uint32_t max_late_ms;
+};
+
+UiStats ui_stats;
+
+// Counts one UI event and the time until it goes out of scope
+class UiActivity {
+public:
+  UiActivity() { _timer.start(); }
+  ~UiActivity() {
+    ui_stats.events++;
+    ui_stats.active_us +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            _timer.elapsed_time())
+            .count();
   }
-}
 
-void call_back2(void) { b2_pressed = !b2_pressed; }
-
-void call_back3(void) {
-  a_hours++;
-  if (a_hours == 24) {
-    a_hours = 0;
-  }
+private:
+  Timer _timer;
+};
+
+// Every host the fetches talk to, looked up together once WLAN is up
+static const char *const net_hosts[] = {
+    NTP_SERVER,
+    "api.ipgeolocation.io",
+    "api.weatherapi.com",
+    "feeds.bbci.co.uk",
+};
+
+void print_http_stats(const char *host, int status) {
+  const HttpStats &stats = http->stats();
+  DnsCacheStats dns_stats = dns->stats();
+  printf("HTTP %s: status %d, %lu bytes read, %lu decoded, connect %lu ms, "
+         "first byte %lu ms, %lu handshakes for %lu requests, "
+         "DNS %lu hits %lu misses\n",
+         host, status, (unsigned long)stats.last_received,
+         (unsigned long)stats.last_decoded,
+         (unsigned long)stats.last_connect_ms,
+         (unsigned long)stats.last_ttfb_ms, (unsigned long)stats.handshakes,
+         (unsigned long)stats.requests,
+         (unsigned long)(dns_stats.hits + dns_stats.negative_hits),
+         (unsigned long)dns_stats.misses);
 }
 
-void call_back4(void) {
-  a_minutes++;
-  if (a_minutes == 60) {
-    a_minutes = 0;
+void start_news_ticker() {
+  // Headlines that do not fit are left out, with rss-headlines set high
+  static char scrolling_headlines[TICKER_TEXT_SIZE];
+  scrolling_headlines[0] = '\0';
+  for (int i = 0; i < news.headline_count; ++i) {
+    if (i > 0) {
+      strncat(scrolling_headlines, " --- ",
+              sizeof(scrolling_headlines) - strlen(scrolling_headlines) - 1);
+    }
+    strncat(scrolling_headlines, news.headlines[i],
+            sizeof(scrolling_headlines) - strlen(scrolling_headlines) - 1);
   }
+  ticker.start(scrolling_headlines, 1, SCROLL_SPEED / 2);
 }
 
-void mute_buzzer(void) { muted = true; }
-
-void snooze_over() {
-  snooze = false;
-  alarm_active = true;
-  Buzzer.write(0.5);
-  auto_mute_counter = 10s;
-  timer.attach(&mute_buzzer, auto_mute_counter);
+static bool feed_json(JsonStreamParser *parser, const char *data,
+                      size_t size) {
+  return parser->feed(data, size);
 }
 
-void snooze_buzzer(void) {
-  if (!muted) {
-    snooze = true;
-    alarm_active = false;
-    snooze_timer.attach(&snooze_over, snooze_counter);
-    Buzzer.write(0);
-    timer.detach();
-  }
+static bool feed_rss(RssParser *parser, const char *data, size_t size) {
+  parser->parse(data, size);
+  return !parser->done();
 }
 
-void confirm_alarm(void) {
-  b2_pressed = 0;
-  alarm_set = true;
-  muted = false;
-  button2.fall(&call_back2);
-  button3.fall(&mute_buzzer);
-  button4.fall(&snooze_buzzer);
-}
-
-void deactivate(void) { alarm_set = !alarm_set; }
-
-
-char source[256] = {0};
-char headlines[3][256] = {{0}};
-int headline_count = 0;
+int hentefeed(HttpClient *http, const char *url, RssFeed *feed,
+              HttpValidators *validators) {
+  const char *host_start = strstr(url, "://") ? strstr(url, "://") + 3 : url;
+  const char *path_start = strchr(host_start, '/');
 
-void showonLCD(volatile int &state) {
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.printf("%s", source);
+  char host[256];
+  strncpy(host, host_start, path_start - host_start);
+  host[path_start - host_start] = '\0';
 
-  char scrolling_headlines[1024] = {0};
-  for (int i = 0; i < headline_count; ++i) {
-    if (i > 0) {
-      strcat(scrolling_headlines, " --- ");
+  Timer timer;
+  timer.start();
+
+  // The parser keeps partial tags between chunks, so the body is only read
+  // until the last wanted headline is complete. A server that honours Range
+  // sends it in parts, the parser carries on from one part to the next.
+  // One that does not sends the whole feed, and the connection is dropped
+  // once the headlines are in.
+  RssParser parser(feed);
+  HttpRange range = {0, RSS_RANGE_SIZE - 1, 0};
+  unsigned long received = 0;
+  int requests = 0;
+  int status = 0;
+  bool parts = !RSS_COMPRESSED;
+  bool restarted = false;
+  if (RSS_COMPRESSED) {
+    status = http->get(host, path_start, CERTIFICATE1,
+                       callback(feed_rss, &parser), validators);
+    received += http->stats().last_received;
+    requests++;
+    if (status == NSAPI_ERROR_DEVICE_ERROR) {
+      // Reaches back further than the inflate window, ask for plain parts
+      parser.reset();
+      memset(validators, 0, sizeof(*validators));
+      parts = true;
     }
-    strcat(scrolling_headlines, headlines[i]);
   }
-
-  while (true) {
-    int keep_going = 0;
-    for (size_t i = 0; i < strlen(scrolling_headlines) - 15; ++i) {
-      if (button5 == 0) {
-        keep_going = 1;
-        break;
-      }
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.printf("%s", source);
-      lcd.setCursor(0, 1);
-      char display[17] = {0};
-      strncpy(display, scrolling_headlines + i, 16);
-      lcd.printf("%s", display);
-      ThisThread::sleep_for(SCROLL_SPEED / 2);
+  while (parts) {
+    status = http->get(host, path_start, CERTIFICATE1,
+                       callback(feed_rss, &parser), validators, &range);
+    received += http->stats().last_received;
+    requests++;
+
+    if (status == 200 && range.first > 0 && !restarted) {
+      // Changed since the first part, start again from the first part
+      parser.reset();
+      memset(validators, 0, sizeof(*validators));
+      range.first = 0;
+      range.last = RSS_RANGE_SIZE - 1;
+      restarted = true;
+      continue;
     }
-    if (keep_going == 1) {
+    if (status == 416 && range.first > 0) {
+      // Past the end of a document whose length the server did not give
+      status = 206;
       break;
     }
-  }
-}
-
-void parseBBC(char *data, size_t length) {
-  data[length] = '\0';
-
-  if (strlen(source) == 0) {
-    char *source_start = strstr(data, "<channel>");
-    if (source_start) {
-      source_start = strstr(source_start, "<title><![CDATA[");
-      if (source_start) {
-        source_start += strlen("<title><![CDATA[");
-        char *source_end = strstr(source_start, "]]></title>");
-        if (source_end) {
-          strncpy(source, source_start, source_end - source_start);
-          source[source_end - source_start] = '\0';
-        }
-      }
+    // A total of 0 is unknown ('*'), then a short part is the last one
+    if (status != 206 || parser.done() ||
+        (range.total != 0 && range.last + 1 >= range.total) ||
+        http->stats().last_decoded < range.last - range.first + 1) {
+      break;
     }
+    range.first = range.last + 1;
+    range.last = range.first + RSS_RANGE_SIZE - 1;
   }
 
-  while ((headline_count < 3) && (data = strstr(data, "<item>"))) {
-    data = strstr(data, "<title><![CDATA[");
-    if (data) {
-      data += strlen("<title><![CDATA[");
-      char *title_end = strstr(data, "]]></title>");
-      if (title_end) {
-        *title_end = '\0';
-        strncpy(headlines[headline_count], data, title_end - data);
-        headlines[headline_count][title_end - data] = '\0';
-        headline_count++;
-        data = title_end + strlen("]]></title>");
-      }
-    }
-  }
+  printf("RSS: %d of %d headlines, %lu bytes in %d requests, %lu ms\n",
+         feed->headline_count, RSS_MAX_HEADLINES, received, requests,
+         (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+             timer.elapsed_time())
+             .count());
+  print_http_stats(host, status);
+  return status;
 }
 
-void hentefeed(NetworkInterface *network, const char *url,
-               volatile int &state) {
-  TLSSocket socket;
-  socket.set_root_ca_cert(CERTIFICATE1);
-  socket.set_timeout(5000);
-  socket.open(network);
+////////////////Network thread/////////////////////
+// Everything below runs on rssThread, one request at a time
 
-  const char *host_start = strstr(url, "://") ? strstr(url, "://") + 3 : url;
-  const char *path_start = strchr(host_start, '/');
+bool fetch_news() {
+  static RssFeed feed;
+  // Only kept while the published headlines came from that response
+  static HttpValidators validators;
 
-  char host[256];
-  char path[256];
-  strncpy(host, host_start, path_start - host_start);
-  host[path_start - host_start] = '\0';
-  strcpy(path, path_start);
-
-  SocketAddress address;
-  network->gethostbyname(host, &address);
-  address.set_port(443);
-  socket.connect(address);
-
-  char http_request[512];
-  snprintf(http_request, sizeof(http_request),
-           "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", path,
-           host);
-  socket.send(http_request, strlen(http_request));
-
-  char buffer[CHUNK_SIZE];
-  size_t total_received = 0;
-  while (total_received < CHUNK_SIZE * 7 && headline_count < 3) {
-    memset(buffer, 0, sizeof(buffer));
-    nsapi_size_or_error_t result = socket.recv(buffer, sizeof(buffer) - 1);
-    if (result <= 0) {
-      break;
-    }
-    total_received += result;
-    parseBBC(buffer, result);
+  int status = hentefeed(http, "https://feeds.bbci.co.uk/news/world/rss.xml",
+                         &feed, &validators);
+  if (status == 304) {
+    // Not modified, the headlines already published stay on screen
+    return true;
   }
-
-  socket.close();
-  showonLCD(state);
+  if ((status != 200 && status != 206) || feed.headline_count == 0) {
+    memset(&validators, 0, sizeof(validators));
+    return false;
+  }
+  news_result.publish(feed);
+  uiQueue.call(network_updated);
+  return true;
 }
 
-using json = nlohmann::json;
+bool fetch_weather() {
+  if (net_geo.city[0] == '\0') {
+    // Runs right after fetch_geo, which has not succeeded yet
+    return false;
+  }
 
-int main() {
+  static char weather_path[300];
+  snprintf(weather_path, sizeof(weather_path),
+           "/v1/current.json?key=a36088dcd4984a17a66183727241405&q=%s&aqi=no",
+           net_geo.city);
+
+  WeatherInfo weather = {};
+  JsonStreamParser weather_parser(weather_fields, &weather);
+  int result =
+      http->get("api.weatherapi.com", weather_path, WEATHER_CERTIFICATE,
+                callback(feed_json, &weather_parser));
+  print_http_stats("api.weatherapi.com", result);
+  if (result != 200 || !weather_parser.all_found()) {
+    printf("weatherapi failed: %d, fields %lx\n", result,
+           (unsigned long)weather_parser.found());
+    return false;
+  }
+  weather_result.publish(weather);
+  uiQueue.call(network_updated);
+  return true;
+}
 
-  Buzzer.period(1.0 / 2000);
+bool fetch_time() {
+  SntpResult result;
+  nsapi_error_t status = sntp->sync(NTP_SERVER, &result);
+  if (status != NSAPI_ERROR_OK) {
+    printf("SNTP failed: %d\n", status);
+    return false;
+  }
+  printf("SNTP: offset %ld ms, delay %lu ms, stratum %u, drift %.1f ppm%s\n",
+         (long)result.offset_ms, (unsigned long)result.delay_ms,
+         result.stratum, result.drift_ppm, result.stepped ? ", set" : "");
+  net_clock_set = true;
+  clock_result.publish(result);
+  uiQueue.call(network_updated);
+  return true;
+}
 
-  lcd.init();
-  lcd.setRGB(255, 255, 255);
-  lcd.display();
-  lcd.printf("Connecting...");
+// Location and time zone, the weather needs the city first
+bool fetch_geo() {
+  // Fields are picked out while the body arrives, and the rest of the
+  // response is not waited for once all of them have been seen
+  GeoInfo geo = {};
+  JsonStreamParser geo_parser(geo_fields, &geo);
+  int result = http->get("api.ipgeolocation.io",
+                         "/timezone?apiKey=780ed75a587b4381930f08b992d77d50",
+                         CERTIFICATE, callback(feed_json, &geo_parser));
+  print_http_stats("api.ipgeolocation.io", result);
+  if (result != 200 || !geo_parser.all_found()) {
+    printf("ipgeolocation failed: %d, fields %lx\n", result,
+           (unsigned long)geo_parser.found());
+    return false;
+  }
 
-  button1.fall(&call_back1);
-  button2.fall(&call_back2);
-  button3.fall(nullptr);
-  button4.fall(nullptr);
+  if (!net_clock_set) {
+    // SNTP has not answered yet, this time is a second or two old by now
+    // but better than none. Stratum 0 says where it came from.
+    set_time(geo.unix_time);
+    SntpResult result = {};
+    result.stepped = true;
+    result.time = time(NULL);
+    clock_result.publish(result);
+  }
 
-  NetworkInterface *network = nullptr;
+  net_geo = geo;
+  geo_result.publish(geo);
+  uiQueue.call(network_updated);
+  return true;
+}
 
+void connect_network() {
   do {
     network = NetworkInterface::get_default_instance();
     ThisThread::sleep_for(1000ms);
@@ -294,348 +526,657 @@ int main() {
 
   printf("Connected to WLAN and got IP address %s\n", address.get_ip_address());
 
-  TLSSocket *socket = new TLSSocket;
-  socket->set_timeout(500);
-  result = socket->open(network);
+  // The queries for all hosts go out at once instead of one before each
+  // first request
+  dns = new DnsCache(network);
+  dns->prewarm(net_hosts, sizeof(net_hosts) / sizeof(net_hosts[0]));
 
-  ////////////////Get ipgeolocation/////////////////////
-  const char host[] = "api.ipgeolocation.io";
-  result = network->gethostbyname(host, &address);
-  printf("IP address of server %s is %s\n", host, address.get_ip_address());
+  sntp = new SntpClient(network, dns);
 
-  // Set server TCP port number
-  address.set_port(443);
+  // Connections are kept open per host, so later requests to the same
+  // server skip the TCP and TLS handshakes
+  http = new HttpClient(network, dns);
 
-  result = socket->set_root_ca_cert(CERTIFICATE);
-
-  socket->set_hostname(host);
-  // Connect to server at the given address
-  result = socket->connect(address);
-
-  const char http_request[] =
-      "GET /timezone?apiKey=780ed75a587b4381930f08b992d77d50 HTTP/1.1\r\n"
-      "Host: api.ipgeolocation.io\r\n"
-      "Connection: close\r\n"
-      "\r\n";
+  refresher.start();
+}
+////////////////Network thread/////////////////////
+
+// Runs on mainQueue, a sensor read waits out the flash write
+void write_snapshot() {
+  static SnapshotBlob blob;
+  static uint32_t seen = 0;
+  if (!snapshot_out.read(&blob, &seen)) {
+    return;
+  }
+  int status = snapshot_store.save(blob.data, blob.size);
+  const SnapshotStats &stats = snapshot_store.stats();
+  printf("Snapshot: %u bytes, status %d, %lu ms, %lu saves, %lu unchanged\n",
+         (unsigned)blob.size, status, (unsigned long)stats.last_save_ms,
+         (unsigned long)stats.saves, (unsigned long)stats.unchanged);
+}
 
-  nsapi_size_t bytes_to_send = strlen(http_request);
-  nsapi_size_or_error_t bytes_sent = 0;
+////////////////UI thread/////////////////////
+// Everything below runs from uiQueue on the main thread, which sleeps until
+// a button, a sample batch, a network result, an alarm or the minute changes
 
-  while (bytes_to_send) {
-    bytes_sent = socket->send(http_request + bytes_sent, bytes_to_send);
+void redraw() {
+  bool clock_drawn = false;
+  if (setting_alarm || intro_screen >= 0 || state != 3) {
+    ticker.stop();
+  }
 
-    if (bytes_sent < 0) {
-      break;
+  Alarm alarm;
+  alarms.get(user_alarm, &alarm);
+
+  // Set alarm
+  if (setting_alarm) {
+    screen.clear();
+    screen.setCursor(0, 0);
+    screen.printf("Setting Alarm");
+    screen.setCursor(0, 1);
+    screen.printf("%02d:%02d", a_hours, a_minutes);
+
+  } else if (intro_screen >= 0) {
+    // 2 seconds screens
+    screen.clear();
+    screen.setCursor(0, 0);
+    if (intro_screen == 0) {
+      // Unix time
+      screen.printf("Unix Eepoch time:\n");
+      screen.setCursor(0, 1);
+      screen.printf("%f", geo.unix_time);
+    } else if (intro_screen == 1) {
+      // Coordinates
+      screen.printf("Lat: %s", geo.latitude);
+      screen.setCursor(0, 1);
+      screen.printf("Long: %s", geo.longitude);
     } else {
-      printf("Sent %d bytes\n", bytes_sent);
+      // Current City
+      screen.printf("City:");
+      screen.setCursor(0, 1);
+      screen.printf("%s", geo.city);
     }
-    bytes_to_send -= bytes_sent;
-  }
-  printf("Messege sent\n");
-
-  // Getting the response
-  char chunk[100] = {0};
-  static char buffer[2000 + 1]; // Makes room for \0;
-  nsapi_size_t remaining_bytes = 2000;
-  nsapi_size_or_error_t recieved_bytes = 0;
 
-  memset(buffer, 0, sizeof(buffer));
+  } else {
+    // Week screen
+    if (state == 0) {
+      screen.clear();
+      screen.setCursor(0, 0);
+      if (!clock_valid) {
+        screen.printf("Connecting...");
+      } else {
+        clock_drawn = true;
+        CivilTime now;
+        civil_time(clock_now(), &now);
+        screen.printf("%s %02d %s %02d:%02d", civil_weekdays[now.weekday],
+                      now.day, civil_months[now.month - 1], now.hour,
+                      now.minute);
+      }
 
-  while (remaining_bytes > 0) {
-    nsapi_size_or_error_t result =
-        socket->recv(buffer + recieved_bytes, remaining_bytes);
+      // alarm screen
+      if (alarm.enabled) {
+        screen.setCursor(0, 1);
+        screen.printf("Alarm: %02d:%02d", alarm.hour, alarm.minute);
+        if (alarm_active) {
+          screen.printf(" (A)");
+        } else if (snooze) {
+          screen.printf(" (S)");
+        }
+      }
+    }
 
-    // for (int i = 0; i<100; i++) {
-    // printf("%c", buffer[i]);
-    // chunk[i]=0;
-    //}
+    // Temp screen
+    if (state == 1) {
+      // Samples arrive from DRDY on mainQueue, the UI never waits for I2C
+      EnvSample env;
+      while (sampler.pop(&env)) {
+        history.add(env);
+      }
+      screen.clear();
+      screen.setCursor(0, 0);
+      if (history.latest(&env)) {
+        int tenths = env.temperature / 10;
+        screen.printf("Temp: %s%d.%dC", tenths < 0 ? "-" : "",
+                      abs(tenths) / 10, abs(tenths) % 10);
+        screen.setCursor(0, 1);
+        screen.printf("Humidity: %d.%d%%", env.humidity / 10,
+                      env.humidity % 10);
+      } else {
+        screen.printf("Temp: --");
+      }
+    }
 
-    if (result < 0) {
-      break;
+    // Weather forecast
+    if (state == 2) {
+      screen.clear();
+      screen.setCursor(0, 0);
+      if (weather.condition[0] != '\0') {
+        screen.printf("%s", weather.condition);
+        screen.setCursor(0, 1);
+        screen.printf("%.1fC", weather.temp_c);
+        if (refresher.stale(weather_source)) {
+          screen.printf(" (old)");
+        }
+      } else {
+        screen.printf("Weather: --");
+      }
     }
 
-    if (result == 0) {
-      break;
+    // News
+    if (state == 3) {
+      if (refresher.stale(news_source)) {
+        // Old headlines are shown while newer ones are fetched
+        refresher.refresh(news_source);
+      }
+      if (news.headline_count > 0) {
+        // Row 1 belongs to the ticker, which moves it between events. The
+        // title has to be in the frame before it starts, with hardware
+        // shift it goes into DDRAM along with the headlines.
+        screen.clear();
+        screen.setCursor(0, 0);
+        screen.printf("%s", news.source);
+        if (!ticker.running() || news_scrolling != news_seen) {
+          start_news_ticker();
+          news_scrolling = news_seen;
+        }
+        ticker.render();
+      } else {
+        // The fetch runs on rssThread, the clock and alarm keep going
+        screen.clear();
+        screen.setCursor(0, 0);
+        screen.printf("Fetching News");
+        screen.setCursor(0, 1);
+        screen.printf("One Moment...");
+      }
     }
-    recieved_bytes += result;
-    remaining_bytes -= result;
   }
+  // Only the cells that changed since the last redraw are sent
+  screen.flush();
+
+  if (clock_drawn && first_clock_ms < 0) {
+    // Kernel::Clock starts at reset
+    first_clock_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Kernel::Clock::now().time_since_epoch())
+                         .count();
+    printf("First clock frame %lld ms after boot, clock from %s\n",
+           (long long)first_clock_ms,
+           clock_seen ? "the network" : "the RTC and snapshot");
+  }
+}
 
-  char headers[200] = {0};
-  nsapi_size_or_error_t headers_received =
-      socket->recv(headers, sizeof(headers));
-  socket->close();
-  delete socket;
-
-  // Find the start and end of the JSON data.
-  // If the JSON response is an array you need to replace this with [ and ]
-  char *json_begin = strchr(buffer, '{');
-  char *json_end = strrchr(buffer, '}');
-
-  json_end[1] = 0;
-
-  printf("\nJSON response:\n%s\n", json_begin);
+void stop_ringing() {
+  tones.stop();
+  alarm_active = false;
+  uiQueue.cancel(ring_event);
+  ring_event = 0;
+  if (snooze) {
+    // Back to its own time instead of the end of the snooze
+    Alarm alarm;
+    alarms.get(user_alarm, &alarm);
+    alarms.set(user_alarm, alarm.hour, alarm.minute, alarm.weekdays);
+    snooze = false;
+  }
+}
 
-  json document = json::parse(json_begin);
+void ring_over() {
+  UiActivity activity;
+  stop_ringing();
+  redraw();
+}
 
-  double unix_time;
-  std::string latitude = json_var(document, "latitude");
-  std::string longitude = json_var(document, "longitude");
-  std::string city = json_var(document, "city");
-  int dst;
+void alarm_fired(int id) {
+  UiActivity activity;
+  if (id != user_alarm) {
+    return;
+  }
+  tones.play(&ALARM_PATTERN);
+  alarm_active = true;
+  snooze = false;
+  uiQueue.cancel(ring_event);
+  ring_event = uiQueue.call_in(ALARM_RING_TIME, ring_over);
+  redraw();
+}
 
-  document["timezone_offset_with_dst"].get_to(dst);
+void snooze_alarm() {
+  tones.stop();
+  alarm_active = false;
+  snooze = true;
+  uiQueue.cancel(ring_event);
+  ring_event = 0;
+  alarms.snooze(user_alarm, ALARM_SNOOZE_TIME);
+}
 
-  document["date_time_unix"].get_to(unix_time);
+void on_button(int button) {
+  UiActivity activity;
 
-  int time_offset = 3600 * dst;
+  // Contacts bounce for a few ms after the edge
+  static Kernel::Clock::time_point last_press[6];
+  Kernel::Clock::time_point now = Kernel::Clock::now();
+  if (now - last_press[button] < BUTTON_DEBOUNCE) {
+    return;
+  }
+  last_press[button] = now;
 
-  set_time(unix_time + time_offset);
-  ////////////////Get ipgeolocation/////////////////////
-  ////////////////Weather/////////////////////
+  Alarm alarm;
+  alarms.get(user_alarm, &alarm);
 
-  SocketAddress address2;
+  switch (button) {
+  case 1:
+    state++;
+    if (state == 4) {
+      state = 0;
+    }
+    break;
+
+  case 2:
+    if (setting_alarm) {
+      // Confirm, goes off every day until switched off with button 5
+      stop_ringing();
+      alarms.set(user_alarm, a_hours, a_minutes, ALARM_EVERY_DAY);
+      tones.play(&CONFIRM_PATTERN);
+      snapshot_changed(SNAPSHOT_SETTINGS_DELAY);
+    } else {
+      a_hours = alarm.hour;
+      a_minutes = alarm.minute;
+    }
+    setting_alarm = !setting_alarm;
+    break;
 
-  const char weather_host[] = "api.weatherapi.com";
-  result = network->gethostbyname(weather_host, &address2);
+  case 3:
+    if (setting_alarm) {
+      a_hours = (a_hours + 1) % 24;
+    } else {
+      // Mute
+      stop_ringing();
+    }
+    break;
 
-  printf("IP address of server %s is %s\n", weather_host,
-         address2.get_ip_address());
+  case 4:
+    if (setting_alarm) {
+      a_minutes = (a_minutes + 1) % 60;
+    } else if (alarm_active) {
+      snooze_alarm();
+    }
+    break;
 
-  address2.set_port(443);
-  // result = socket2.set_root_ca_cert(WEATHER_CERTIFICATE);
-  // socket2.set_hostname(weather_host);
+  case 5:
+    if (alarm.enabled) {
+      stop_ringing();
+    }
+    alarms.enable(user_alarm, !alarm.enabled);
+    snapshot_changed(SNAPSHOT_SETTINGS_DELAY);
+    if (state == 3) {
+      // Leaves the news, as it always has
+      state = 0;
+    }
+    break;
+  }
 
-  TLSSocket *sock = new TLSSocket;
-  result = sock->open(network);
-  sock->set_timeout(3000);
-  result = sock->set_root_ca_cert(WEATHER_CERTIFICATE);
+  sampler.set_batch(state == 1 ? 1 : ENV_UI_BATCH);
+  redraw();
+}
 
-  sock->set_hostname(weather_host);
+// min/mean/max of one channel over the last minute, hour and day
+void print_trend(const char *name, bool humidity, float scale) {
+  static const char *const windows[] = {"minute", "hour", "day"};
+  printf("%s:", name);
+  for (int w = SampleHistory::MINUTE; w <= SampleHistory::DAY; w++) {
+    StatSummary s;
+    if (humidity) {
+      history.humidity((SampleHistory::Window)w, &s);
+    } else {
+      history.temperature((SampleHistory::Window)w, &s);
+    }
+    if (s.count) {
+      printf(" %s %.1f/%.1f/%.1f", windows[w], s.min * scale,
+             s.mean() * scale, s.max * scale);
+    }
+  }
+  printf(" (min/mean/max)\n");
+}
 
-  result = sock->connect(address2);// Connect to server at the given address
+void print_ui_stats() {
+  const TickerStats &scroll = ticker.stats();
+  const AlarmStats &alarm = alarms.stats();
+  printf("UI: %lu events, %lu us active per minute, "
+         "minute ticks %lu late, max %lu ms late, "
+         "scroll %lu steps, %lu us average, %lu us max, %lu chars, "
+         "alarm %lu wakeups, %lu fired, %lu late, max %lu ms late\n",
+         (unsigned long)(ui_stats.events / UI_STATS_MINUTES),
+         (unsigned long)(ui_stats.active_us / UI_STATS_MINUTES),
+         (unsigned long)ui_stats.late, (unsigned long)ui_stats.max_late_ms,
+         (unsigned long)scroll.steps,
+         (unsigned long)(scroll.steps ? scroll.total_us / scroll.steps : 0),
+         (unsigned long)scroll.max_us, (unsigned long)scroll.chars,
+         (unsigned long)alarm.wakeups, (unsigned long)alarm.fired,
+         (unsigned long)alarm.late, (unsigned long)alarm.max_late_ms);
+  print_trend("Temperature C", false, 0.01f);
+  print_trend("Humidity %", true, 0.1f);
+#if MBED_CPU_STATS_ENABLED
+  mbed_stats_cpu_t cpu;
+  mbed_stats_cpu_get(&cpu);
+  printf("CPU: %lu%% asleep, %lu%% in deep sleep\n",
+         (unsigned long)((cpu.sleep_time + cpu.deep_sleep_time) * 100 /
+                         cpu.uptime),
+         (unsigned long)(cpu.deep_sleep_time * 100 / cpu.uptime));
+#endif
+  ui_stats.events = 0;
+  ui_stats.active_us = 0;
+}
 
-  static char weather_request[300];
+void print_drift() {
+  DriftRecord last;
+  if (drift.history(&last, 1) == 0) {
+    return;
+  }
+  printf("Drift: %.2f ppm over %lld s, %lld ms in total, "
+         "%ld ms off the fit before\n",
+         drift.ppm(), (long long)(last.elapsed_ms / 1000),
+         (long long)last.drift_ms, (long)last.error_ms);
+}
 
-  snprintf(
-      weather_request, 300,
-      "GET /v1/current.json?key=a36088dcd4984a17a66183727241405&q=%s&aqi=no "
-      "HTTP/1.1\r\n"
-      "Host: api.weatherapi.com\r\n"
-      "Connection: close\r\n"
-      "\r\n",
-      city.c_str());
+void save_snapshot() {
+  UiActivity activity;
+  snapshot_event = 0;
+  static SnapshotBlob blob;
+  SnapshotWriter writer(blob.data, sizeof(blob.data));
+  // Without it the next boot does not take the RTC for set, e.g. when the
+  // alarm was changed with no network and the RTC still counts from 1970
+  if (clock_valid) {
+    writer.put_value(SNAP_SAVED, (int64_t)time(NULL));
+  }
+  if (geo_known) {
+    writer.put_string(SNAP_CITY, geo.city);
+    writer.put_string(SNAP_LATITUDE, geo.latitude);
+    writer.put_string(SNAP_LONGITUDE, geo.longitude);
+    writer.put_string(SNAP_ZONE, geo.zone);
+    writer.put_value(SNAP_UTC_OFFSET, geo.dst);
+  }
+  if (weather.condition[0] != '\0') {
+    writer.put_string(SNAP_WEATHER_CONDITION, weather.condition);
+    writer.put_value(SNAP_WEATHER_TEMP, weather.temp_c);
+  }
+  if (news.headline_count > 0) {
+    writer.put_string(SNAP_NEWS_SOURCE, news.source);
+    for (int i = 0; i < news.headline_count; i++) {
+      writer.put_string(SNAP_HEADLINE, news.headlines[i]);
+    }
+  }
+  Alarm alarm;
+  alarms.get(user_alarm, &alarm);
+  uint8_t alarm_fields[] = {alarm.hour, alarm.minute, alarm.weekdays,
+                            alarm.enabled};
+  writer.put(SNAP_ALARM, alarm_fields, sizeof(alarm_fields));
+
+  blob.size = writer.finish();
+  if (blob.size == 0) {
+    printf("Snapshot does not fit in %u bytes\n", (unsigned)sizeof(blob.data));
+    return;
+  }
+  snapshot_out.publish(blob);
+  mainQueue.call(write_snapshot);
+}
 
-  nsapi_size_t bytes_to_send2 = strlen(weather_request);
-  nsapi_size_or_error_t bytes_sent2 = 0;
+// One save at the earliest time asked for
+void snapshot_changed(std::chrono::milliseconds delay) {
+  Kernel::Clock::time_point due = Kernel::Clock::now() + delay;
+  if (snapshot_event != 0) {
+    if (due >= snapshot_due) {
+      return;
+    }
+    uiQueue.cancel(snapshot_event);
+  }
+  snapshot_due = due;
+  snapshot_event = uiQueue.call_in(delay, save_snapshot);
+}
 
-  while (bytes_to_send2) {
-    bytes_sent2 = sock->send(weather_request + bytes_sent2, bytes_to_send2);
+// At boot, before the first frame and before the network thread starts
+void restore_snapshot() {
+  static uint8_t data[SNAPSHOT_SIZE];
+  size_t size = snapshot_store.load(data, sizeof(data));
+  SnapshotReader reader(data, size);
+  if (!reader.valid()) {
+    printf("No snapshot, %lu ms\n",
+           (unsigned long)snapshot_store.stats().load_ms);
+    return;
+  }
 
-    if (bytes_sent2 < 0) {
+  int64_t saved = 0;
+  uint8_t tag;
+  const uint8_t *value;
+  size_t length;
+  while (reader.next(&tag, &value, &length)) {
+    switch (tag) {
+    case SNAP_SAVED:
+      SnapshotReader::get_value(value, length, &saved);
+      break;
+    case SNAP_CITY:
+      SnapshotReader::get_string(value, length, geo.city, sizeof(geo.city));
+      geo_known = true;
+      break;
+    case SNAP_LATITUDE:
+      SnapshotReader::get_string(value, length, geo.latitude,
+                                 sizeof(geo.latitude));
+      break;
+    case SNAP_LONGITUDE:
+      SnapshotReader::get_string(value, length, geo.longitude,
+                                 sizeof(geo.longitude));
+      break;
+    case SNAP_ZONE:
+      SnapshotReader::get_string(value, length, geo.zone, sizeof(geo.zone));
+      break;
+    case SNAP_UTC_OFFSET:
+      SnapshotReader::get_value(value, length, &geo.dst);
+      break;
+    case SNAP_WEATHER_CONDITION:
+      SnapshotReader::get_string(value, length, weather.condition,
+                                 sizeof(weather.condition));
+      break;
+    case SNAP_WEATHER_TEMP:
+      SnapshotReader::get_value(value, length, &weather.temp_c);
+      break;
+    case SNAP_NEWS_SOURCE:
+      SnapshotReader::get_string(value, length, news.source,
+                                 sizeof(news.source));
+      break;
+    case SNAP_HEADLINE:
+      if (news.headline_count < RSS_MAX_HEADLINES) {
+        SnapshotReader::get_string(value, length,
+                                   news.headlines[news.headline_count++],
+                                   RSS_TEXT_SIZE);
+      }
+      break;
+    case SNAP_ALARM:
+      if (length == 4 && alarms.set(user_alarm, value[0], value[1], value[2])) {
+        alarms.enable(user_alarm, value[3] != 0);
+      }
       break;
-    } else {
-      printf("Sent %d bytes\n", bytes_sent2);
     }
-    bytes_to_send2 -= bytes_sent2;
   }
-  printf("Messege sent\n");
 
-  // Getting the response
-  char chunk2[100] = {0};
-  static char buffer2[2000 + 1]; // Makes room for \0;
-  nsapi_size_t remaining_bytes2 = 2000;
-  nsapi_size_or_error_t recieved_bytes2 = 0;
+  if (geo_known) {
+    zone.set(geo.zone, 3600 * geo.dst);
+    // The weather request goes out without waiting for the location
+    net_geo = geo;
+  }
+  // The RTC runs on through a reset, but starts over when the power was off
+  time_t now = time(NULL);
+  if (saved >= SNAPSHOT_EARLIEST_SAVE && now >= saved) {
+    clock_valid = true;
+    zone_offset = zone.offset(drift.now());
+    alarms.clock_set();
+  }
+  printf("Snapshot: %u bytes, %lld s old, loaded in %lu ms, clock %s\n",
+         (unsigned)size, (long long)(now - saved),
+         (unsigned long)snapshot_store.stats().load_ms,
+         clock_valid ? "kept" : "lost");
+}
 
-  memset(buffer2, 0, sizeof(buffer2));
+// The alarms are wall clock times. When the offset moves on, e.g. as DST
+// begins, they are worked out again and the skipped ones do not go off. When
+// it moves back, an hour repeats, and the alarms keep the times they already
+// passed it with, so none goes off twice.
+void follow_zone() {
+  int32_t offset = zone.offset(drift.now());
+  if (offset > zone_offset) {
+    alarms.clock_set();
+  }
+  zone_offset = offset;
+}
 
-  while (remaining_bytes2 > 0) {
-    nsapi_size_or_error_t result =
-        sock->recv(buffer2 + recieved_bytes2, remaining_bytes2);
-    if (result < 0) {
-      break;
-    }
+void minute_tick();
 
-    if (result == 0) {
-      break;
+// time() counts whole seconds, so this lands just after the minute changes
+void next_minute_tick() {
+  time_t seconds = clock_now();
+  std::chrono::seconds wait(60 - seconds % 60);
+  minute_due = Kernel::Clock::now() + wait;
+  minute_event = uiQueue.call_in(wait, minute_tick);
+}
+
+// How long the tick waited behind other events, e.g. a redraw during a fetch
+void record_late(Kernel::Clock::duration late) {
+  if (late > UI_LATE_LIMIT) {
+    ui_stats.late++;
+  }
+  // Kernel::Clock counts milliseconds
+  if (late.count() > (int64_t)ui_stats.max_late_ms) {
+    ui_stats.max_late_ms = late.count();
+  }
+}
+
+void minute_tick() {
+  UiActivity activity;
+  record_late(Kernel::Clock::now() - minute_due);
+  next_minute_tick();
+  // DST begins and ends on the hour
+  follow_zone();
+
+  led = !led;
+  ui_stats.minutes++;
+  if (ui_stats.minutes % UI_STATS_MINUTES == 0) {
+    print_ui_stats();
+  }
+  redraw();
+}
+
+void next_intro() {
+  UiActivity activity;
+  intro_screen = intro_screen < 2 ? intro_screen + 1 : -1;
+  if (intro_screen >= 0) {
+    uiQueue.call_in(INTRO_SCREEN_TIME, next_intro);
+  }
+  redraw();
+}
+
+void network_updated() {
+  UiActivity activity;
+  if (clock_result.read(&clock_sync, &clock_seen)) {
+    clock_valid = true;
+    if (clock_sync.stratum != 0) {
+      // Unless the RTC was set it is still off by what the sync measured
+      drift.add(clock_sync.time, clock_sync.elapsed_ms,
+                clock_sync.drift_total_ms,
+                clock_sync.stepped ? 0 : clock_sync.offset_ms);
+      print_drift();
     }
-    recieved_bytes2 += result;
-    remaining_bytes2 -= result;
-  }
-
-  char headers2[200] = {0};
-  nsapi_size_or_error_t headers_received2 =
-      sock->recv(headers2, sizeof(headers2));
-
-  char *json_begin2 = strchr(buffer2, '{');
-  char *json_end2 = strrchr(buffer2, '}');
-
-  json_end2[1] = 0;
-
-  printf("\nJSON response:\n%s\n", json_begin2);
-
-  json document2 = json::parse(json_begin2);
-
-  std::string weather_forecast;
-
-  if (document2["current"]["condition"]["text"].is_string()) {
-    weather_forecast =
-        document2["current"]["condition"]["text"].get<std::string>();
-  }
-
-  float temperature;
-  document2["current"]["temp_c"].get_to(temperature);
-
-  sock->close();
-  delete sock;
-  ////////////////Weather/////////////////////
-
-  // 2 seconds screens
-  ThisThread::sleep_for(2s);
-  // Unix time
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.printf("Unix Eepoch time:\n");
-  lcd.setCursor(0, 1);
-  lcd.printf("%f", unix_time);
-  ThisThread::sleep_for(2s);
-  // Coordinates
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.printf("Lat: %s", latitude.c_str());
-  lcd.setCursor(0, 1);
-  lcd.printf("Long: %s", longitude.c_str());
-  ThisThread::sleep_for(2s);
-  // Current City
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.printf("City:");
-  lcd.setCursor(0, 1);
-  lcd.printf("%s", city.c_str());
-  ThisThread::sleep_for(2s);
-
-  while (true) {
-
-    time_t seconds = time(NULL);
-
-    char buffer[32];
-    strftime(buffer, 32, "%a %d %b %H:%M", localtime(&seconds));
-
-    struct tm *local_time = localtime(&seconds);
-
-    // Extract day, month, and year
-    int day = local_time->tm_mday;
-    int month = local_time->tm_mon + 1;    // Month is zero-based, so add 1
-    int year = local_time->tm_year + 1900; // Year starts from 1900
-    int current_hour = local_time->tm_hour;
-    int current_min = local_time->tm_min;
-
-    // Get the day of the week in text form
-    char day_of_week[20];
-    strftime(day_of_week, sizeof(day_of_week), "%A", local_time);
-
-    if (current_hour == a_hours && current_min == a_minutes && alarm_set) {
-      if (!muted && !snooze) {
-        Buzzer.write(0.5);
-        alarm_active = true;
-        if (alarm_active && !auto_snooze) {
-          timer.attach(&mute_buzzer, auto_mute_counter);
-          auto_snooze = true;
-        }
-      }
+    // The clock was set or its correction changed, alarms and minutes
+    // follow the new time
+    zone_offset = zone.offset(drift.now());
+    alarms.clock_set();
+    uiQueue.cancel(minute_event);
+    next_minute_tick();
+  }
+  bool changed = false;
+  if (geo_result.read(&geo, &geo_seen)) {
+    if (!zone.set(geo.zone, 3600 * geo.dst)) {
+      // Right until its next DST switch, the location is fetched again
+      // before long
+      printf("No rules for time zone %s, UTC%+d\n", geo.zone, geo.dst);
     }
-    if (alarm_active && muted) {
-      Buzzer.write(0);
-      alarm_active = false;
+    follow_zone();
+    if (!geo_known) {
+      // Location screens are shown once, when it is first known, and not
+      // when it was in the snapshot
+      geo_known = true;
+      intro_screen = 0;
+      uiQueue.call_in(INTRO_SCREEN_TIME, next_intro);
     }
+    changed = true;
+  }
+  changed |= weather_result.read(&weather, &weather_seen);
+  changed |= news_result.read(&news, &news_seen);
+  if (changed) {
+    snapshot_changed(SNAPSHOT_DATA_DELAY);
+  }
+  redraw();
+}
 
-    if (button5 == 0) {
-      alarm_set = !alarm_set;
-    }
+void show_samples() {
+  UiActivity activity;
+  if (state == 1 && !setting_alarm && intro_screen < 0) {
+    // Takes them from the ring itself
+    redraw();
+    return;
+  }
+  EnvSample env;
+  while (sampler.pop(&env)) {
+    history.add(env);
+  }
+}
 
-    // Set alarm
-    if (b2_pressed) {
-
-      button3.fall(&call_back3);
-      button4.fall(&call_back4);
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.printf("Setting Alarm");
-      lcd.setCursor(0, 1);
-      if (a_hours < 10 && a_minutes < 10) {
-        lcd.printf("0%i:0%i", a_hours, a_minutes);
-      } else if (a_hours >= 10 && a_minutes < 10) {
-        lcd.printf("%i:0%i", a_hours, a_minutes);
-      } else if (a_hours < 10 && a_minutes >= 10) {
-        lcd.printf("0%i:%i", a_hours, a_minutes);
-      } else if (a_hours >= 10 && a_minutes >= 10) {
-        lcd.printf("%i:%i", a_hours, a_minutes);
-      }
-      button2.fall(&confirm_alarm);
+void samples_ready() {
+  // On mainQueue, right after a sample went into the ring
+  uiQueue.call(show_samples);
+}
+////////////////UI thread/////////////////////
 
-    } else {
-      // Week screen
-      if (state == 0) {
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        // lcd.printf(day_of_week);
-        lcd.printf("%s", buffer);
-
-        // alarm screen
-        if (alarm_set) {
-          lcd.setCursor(0, 1);
-          if (a_hours < 10 && a_minutes < 10) {
-            lcd.printf("Alarm: 0%i:0%i", a_hours, a_minutes);
-          } else if (a_hours >= 10 && a_minutes < 10) {
-            lcd.printf("Alarm: %i:0%i", a_hours, a_minutes);
-          } else if (a_hours < 10 && a_minutes >= 10) {
-            lcd.printf("Alarm: 0%i:%i", a_hours, a_minutes);
-          } else if (a_hours >= 10 && a_minutes >= 10) {
-            lcd.printf("Alarm: %i:%i", a_hours, a_minutes);
-          }
-          if (alarm_active) {
-            lcd.printf(" (A)");
-          } else if (snooze) {
-            lcd.printf(" (S)");
-          }
-        }
-      }
+int main() {
+  // The first frame comes before anything waits on hardware or the network,
+  // from the snapshot when there is one
+  lcd.init();
+  lcd.setRGB(255, 255, 255);
+  lcd.display();
 
-      // Temp screen
-      if (state == 1) {
-        float temp = 0;
-        float hum = 0;
-        sensor.get_temperature(&temp);
-        sensor.get_humidity(&hum);
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.printf("Temp: %.1fC", temp);
-        lcd.setCursor(0, 1);
-        lcd.printf("Humidity: %.2f%", hum);
-      }
+  zone.set(DEFAULT_TIME_ZONE, 0);
 
-      // Weather forecast
-      if (state == 2) {
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.printf("%s", weather_forecast.c_str());
-        lcd.setCursor(0, 1);
-        lcd.printf("%.1fC", temperature);
-      }
+  // Off until set with button 2
+  user_alarm = alarms.add(0, 0, ALARM_EVERY_DAY);
+  alarms.enable(user_alarm, false);
 
-      // News
-      if (state == 3) {
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.printf("Fetching News");
-        lcd.setCursor(0, 1);
-        lcd.printf("One Moment...");
-        hentefeed(network, "https://feeds.bbci.co.uk/news/world/rss.xml",
-                  state);
-        state = 0;
-      }
-    }
-    led = !led;
-    ThisThread::sleep_for(BLINKING_RATE);
-  }
+  restore_snapshot();
+  redraw();
+
+  // Loads the calibration coefficients once, samples only read HR/TEMP_OUT
+  sensor.init(NULL);
+  sensor.enable();
+  mainThread.start(callback(&mainQueue, &EventQueue::dispatch_forever));
+  sampler.attach(callback(samples_ready), ENV_UI_BATCH);
+  sampler.start();
+
+  button1.fall(&call_back1);
+  button2.fall(&call_back2);
+  button3.fall(&call_back3);
+  button4.fall(&call_back4);
+  button5.fall(&call_back5);
+
+  // WLAN, TLS and parsing all happen on rssThread, the UI only picks up the
+  // published results. Sources run in this order, the weather request needs
+  // the city from ipgeolocation.
+  clock_source = refresher.add("time", callback(fetch_time), CLOCK_REFRESH,
+                               NET_RETRY, CLOCK_REFRESH * 2);
+  geo_source = refresher.add("location", callback(fetch_geo), GEO_REFRESH,
+                             NET_RETRY, GEO_REFRESH * 2);
+  weather_source = refresher.add("weather", callback(fetch_weather),
+                                 WEATHER_REFRESH, NET_RETRY,
+                                 WEATHER_REFRESH * 2);
+  news_source = refresher.add("news", callback(fetch_news), NEWS_REFRESH,
+                              NET_RETRY, NEWS_REFRESH * 2);
+  rssThread.start(callback(&rssQueue, &EventQueue::dispatch_forever));
+  rssQueue.call(connect_network);
+
+  next_minute_tick();
+
+  // Nothing polls, the thread sleeps between events
+  uiQueue.dispatch_forever();
 }
@@ -0,0 +1,156 @@
+/**
+ * @file refresh_scheduler.cpp
+ * @brief Per-source refresh timing, see refresh_scheduler.h
+ */
+#include "refresh_scheduler.h"
+
+using namespace std::chrono;
+
+RefreshScheduler::RefreshScheduler(EventQueue *queue)
+    : _queue(queue), _count(0), _event(0), _random(1) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+int RefreshScheduler::add(const char *name, Fetch fetch, seconds interval,
+                          seconds retry, seconds stale_after) {
+  if (_count == REFRESH_MAX_SOURCES) {
+    return -1;
+  }
+  Source *source = &_sources[_count];
+  source->name = name;
+  source->fetch = fetch;
+  source->interval = interval;
+  source->retry = retry < interval ? retry : interval;
+  source->stale_after_s = stale_after.count();
+  source->next_run = Kernel::Clock::now();
+  source->failures = 0;
+  source->requested = false;
+  source->has_data = false;
+  source->updated_s = 0;
+  return _count++;
+}
+
+void RefreshScheduler::start() {
+  // Only has to differ between sources, not between boots
+  _random ^= (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+  if (_random == 0) {
+    _random = 1;
+  }
+  _event = _queue->call(callback(this, &RefreshScheduler::run));
+}
+
+void RefreshScheduler::refresh(int id) {
+  if (id < 0 || id >= _count) {
+    return;
+  }
+  // One event per request, however often the screen asks
+  if (!_sources[id].requested.exchange(true)) {
+    _queue->call(this, &RefreshScheduler::run_requested, id);
+  }
+}
+
+bool RefreshScheduler::has_data(int id) const {
+  return id >= 0 && id < _count && _sources[id].has_data;
+}
+
+bool RefreshScheduler::stale(int id) const {
+  return !has_data(id) || age(id) > _sources[id].stale_after_s;
+}
+
+uint32_t RefreshScheduler::age(int id) const {
+  if (!has_data(id)) {
+    return 0;
+  }
+  return uptime_s() - _sources[id].updated_s;
+}
+
+void RefreshScheduler::run() {
+  _event = 0;
+  _stats.wakeups++;
+
+  Kernel::Clock::time_point horizon = Kernel::Clock::now() + REFRESH_COALESCE;
+  for (int i = 0; i < _count; i++) {
+    if (_sources[i].next_run <= horizon) {
+      run_source(&_sources[i]);
+    }
+  }
+  schedule();
+}
+
+void RefreshScheduler::run_requested(int id) {
+  Source *source = &_sources[id];
+  source->requested = false;
+  if (source->failures == 0) {
+    run_source(source);
+    schedule();
+  }
+}
+
+void RefreshScheduler::run_source(Source *source) {
+  _stats.runs++;
+  bool ok = source->fetch();
+  Kernel::Clock::duration delay;
+
+  if (ok) {
+    source->failures = 0;
+    source->updated_s = uptime_s();
+    source->has_data = true;
+    delay = source->interval;
+  } else {
+    _stats.failures++;
+    // retry, 2 * retry, 4 * retry ... up to the normal interval
+    delay = source->retry;
+    for (uint32_t i = 0; i < source->failures && delay < source->interval;
+         i++) {
+      delay *= 2;
+    }
+    if (delay > source->interval) {
+      delay = source->interval;
+    }
+    source->failures++;
+    printf("Refresh %s failed %lu times, next try in %lu s\n", source->name,
+           (unsigned long)source->failures,
+           (unsigned long)duration_cast<seconds>(delay).count());
+  }
+  source->next_run = Kernel::Clock::now() + jitter(delay);
+}
+
+void RefreshScheduler::schedule() {
+  if (_count == 0) {
+    return;
+  }
+  if (_event) {
+    _queue->cancel(_event);
+  }
+
+  Kernel::Clock::time_point next = _sources[0].next_run;
+  for (int i = 1; i < _count; i++) {
+    if (_sources[i].next_run < next) {
+      next = _sources[i].next_run;
+    }
+  }
+  Kernel::Clock::duration delay = next - Kernel::Clock::now();
+  if (delay < 0ms) {
+    delay = 0ms;
+  }
+  _event = _queue->call_in(delay, callback(this, &RefreshScheduler::run));
+}
+
+Kernel::Clock::duration
+RefreshScheduler::jitter(Kernel::Clock::duration delay) {
+  int64_t span = delay.count() * REFRESH_JITTER_PERCENT / 100;
+  if (span == 0) {
+    return delay;
+  }
+  // xorshift32
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  int64_t offset = (int64_t)(_random % (uint32_t)(2 * span + 1)) - span;
+  return delay + Kernel::Clock::duration(offset);
+}
+
+uint32_t RefreshScheduler::uptime_s() {
+  return duration_cast<seconds>(Kernel::Clock::now().time_since_epoch())
+      .count();
+}
@@ -0,0 +1,116 @@
+/**
+ * @file refresh_scheduler.h
+ * @brief Keeps a few network data sources fresh from one event queue, each
+ * with its own refresh interval, backoff after failures and a staleness
+ * flag for the screens.
+ */
+#ifndef __REFRESH_SCHEDULER_H__
+#define __REFRESH_SCHEDULER_H__
+
+#include "mbed.h"
+#include <atomic>
+#include <chrono>
+
+#define REFRESH_MAX_SOURCES 4
+
+/*
+Next runs are spread by up to this much of the interval, so sources with
+equal intervals drift apart instead of always waking up together.
+*/
+#define REFRESH_JITTER_PERCENT 10
+
+/*
+Sources due within this window of a wakeup are run with it, so they share
+the wakeup and the kept connections instead of each waking the radio.
+*/
+#define REFRESH_COALESCE 60s
+
+struct RefreshStats {
+  uint32_t wakeups;
+  uint32_t runs;
+  uint32_t failures;
+};
+
+/**
+ * Every fetch runs on the scheduler's queue, one at a time and in the order
+ * the sources were added, so a source may depend on data an earlier one
+ * stored. Only one event is pending on the queue, armed for the earliest
+ * next run.
+ */
+class RefreshScheduler {
+public:
+  typedef Callback<bool()> Fetch;
+
+  explicit RefreshScheduler(EventQueue *queue);
+
+  /**
+   * @brief register a source, before start()
+   * @param fetch runs on the queue, returns true when the data was updated
+   * @param interval time between successful refreshes
+   * @param retry delay after the first failure, doubled for every further
+   * failure up to interval
+   * @param stale_after data older than this is reported stale
+   * @return id of the source, or -1 when REFRESH_MAX_SOURCES are registered
+   */
+  int add(const char *name, Fetch fetch, std::chrono::seconds interval,
+          std::chrono::seconds retry, std::chrono::seconds stale_after);
+
+  /**
+   * @brief run every source now and keep them refreshed from then on
+   */
+  void start();
+
+  /**
+   * @brief run a source as soon as the queue is free, from any thread.
+   * Ignored while the source is backing off after a failure.
+   */
+  void refresh(int id);
+
+  /**
+   * @return true once the source has been fetched successfully, any thread
+   */
+  bool has_data(int id) const;
+
+  /**
+   * @return true when the last successful fetch is older than stale_after,
+   * or there has been none. Any thread.
+   */
+  bool stale(int id) const;
+
+  /**
+   * @return seconds since the last successful fetch
+   */
+  uint32_t age(int id) const;
+
+  const RefreshStats &stats() const { return _stats; }
+
+private:
+  struct Source {
+    const char *name;
+    Fetch fetch;
+    Kernel::Clock::duration interval;
+    Kernel::Clock::duration retry;
+    uint32_t stale_after_s;
+    Kernel::Clock::time_point next_run;
+    uint32_t failures;
+    std::atomic<bool> requested;
+    std::atomic<bool> has_data;
+    std::atomic<uint32_t> updated_s; // uptime of the last success
+  };
+
+  void run();
+  void run_requested(int id);
+  void run_source(Source *source);
+  void schedule();
+  Kernel::Clock::duration jitter(Kernel::Clock::duration delay);
+  static uint32_t uptime_s();
+
+  EventQueue *_queue;
+  Source _sources[REFRESH_MAX_SOURCES];
+  int _count;
+  int _event;
+  uint32_t _random;
+  RefreshStats _stats;
+};
+
+#endif
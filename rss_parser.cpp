@@ -0,0 +1,139 @@
+/**
+ * @file rss_parser.cpp
+ * @brief Resumable RSS tokenizer, see rss_parser.h
+ */
+#include "rss_parser.h"
+
+#include <string.h>
+
+RssMatcher::RssMatcher(const char *pattern)
+    : _pattern(pattern), _length(strlen(pattern)), _matched(0) {}
+
+bool RssMatcher::feed(char c) {
+  while (true) {
+    if (_pattern[_matched] == c) {
+      if (++_matched == _length) {
+        _matched = 0;
+        return true;
+      }
+      return false;
+    }
+    if (_matched == 0) {
+      return false;
+    }
+    // Fall back to the longest prefix of the pattern that is also a suffix
+    // of what has been matched so far, then retry the same character.
+    size_t border = _matched - 1;
+    while (border > 0 &&
+           memcmp(_pattern, _pattern + _matched - border, border) != 0) {
+      border--;
+    }
+    _matched = border;
+  }
+}
+
+RssParser::RssParser(RssFeed *feed, int max_items)
+    : _feed(feed), _channel("<channel>"), _item("<item>"),
+      _title_open("<title><![CDATA["), _title_close("]]></title>") {
+  if (max_items > RSS_MAX_HEADLINES) {
+    max_items = RSS_MAX_HEADLINES;
+  }
+  _max_items = max_items;
+  reset();
+}
+
+void RssParser::reset() {
+  memset(_feed, 0, sizeof(*_feed));
+  _state = _max_items > 0 ? SEEK_CHANNEL : DONE;
+  _consumed = 0;
+  _channel.reset();
+  _item.reset();
+  _title_open.reset();
+  _title_close.reset();
+  _text = nullptr;
+  _text_length = 0;
+}
+
+size_t RssParser::parse(const char *data, size_t length) {
+  size_t i = 0;
+
+  while (i < length && _state != DONE) {
+    char c = data[i++];
+
+    switch (_state) {
+    case SEEK_CHANNEL:
+      if (_channel.feed(c)) {
+        _state = SEEK_SOURCE;
+      }
+      break;
+
+    case SEEK_SOURCE:
+      if (_title_open.feed(c)) {
+        begin_text(_feed->source);
+        _state = READ_SOURCE;
+      }
+      break;
+
+    case READ_SOURCE:
+      if (_title_close.feed(c)) {
+        end_text();
+        _state = SEEK_ITEM;
+      } else {
+        append_text(c);
+      }
+      break;
+
+    case SEEK_ITEM:
+      if (_item.feed(c)) {
+        _state = SEEK_HEADLINE;
+      }
+      break;
+
+    case SEEK_HEADLINE:
+      if (_title_open.feed(c)) {
+        begin_text(_feed->headlines[_feed->headline_count]);
+        _state = READ_HEADLINE;
+      }
+      break;
+
+    case READ_HEADLINE:
+      if (_title_close.feed(c)) {
+        end_text();
+        _feed->headline_count++;
+        _state = _feed->headline_count < _max_items ? SEEK_ITEM : DONE;
+      } else {
+        append_text(c);
+      }
+      break;
+
+    case DONE:
+      break;
+    }
+  }
+
+  _consumed += i;
+  return i;
+}
+
+void RssParser::begin_text(char *dest) {
+  _text = dest;
+  _text_length = 0;
+}
+
+void RssParser::append_text(char c) {
+  if (_text_length < RSS_TEXT_SIZE - 1) {
+    _text[_text_length] = c;
+  }
+  _text_length++;
+}
+
+void RssParser::end_text() {
+  // The closing tag minus its last character was appended while it was
+  // still only a partial match.
+  size_t length = _text_length - (_title_close.length() - 1);
+  if (length > RSS_TEXT_SIZE - 1) {
+    length = RSS_TEXT_SIZE - 1;
+  }
+  _text[length] = '\0';
+  _text = nullptr;
+}
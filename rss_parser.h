@@ -0,0 +1,106 @@
+/**
+ * @file rss_parser.h
+ * @brief Resumable RSS tokenizer that extracts the channel title and the
+ * first item titles from a feed delivered in arbitrary recv() chunks.
+ */
+#ifndef __RSS_PARSER_H__
+#define __RSS_PARSER_H__
+
+#include <stddef.h>
+
+// Set with "rss-headlines" in mbed_app.json
+#ifdef MBED_CONF_APP_RSS_HEADLINES
+#define RSS_MAX_HEADLINES MBED_CONF_APP_RSS_HEADLINES
+#else
+#define RSS_MAX_HEADLINES 3
+#endif
+#define RSS_TEXT_SIZE 256
+
+struct RssFeed {
+  char source[RSS_TEXT_SIZE];
+  char headlines[RSS_MAX_HEADLINES][RSS_TEXT_SIZE];
+  int headline_count;
+};
+
+/**
+ * Incremental matcher for a fixed pattern. Keeps the number of pattern
+ * characters matched so far, so a pattern split across two chunks is still
+ * found without looking at earlier input again.
+ */
+class RssMatcher {
+public:
+  explicit RssMatcher(const char *pattern);
+
+  void reset() { _matched = 0; }
+  size_t length() const { return _length; }
+
+  /**
+   * Advance the matcher by one input character.
+   * @return true when the last character completed the pattern
+   */
+  bool feed(char c);
+
+private:
+  const char *_pattern;
+  size_t _length;
+  size_t _matched;
+};
+
+class RssParser {
+public:
+  /**
+   * @param feed destination for the channel title and headlines
+   * @param max_items number of item titles to collect before stopping
+   */
+  RssParser(RssFeed *feed, int max_items = RSS_MAX_HEADLINES);
+
+  /**
+   * Clear the destination feed and start again from the beginning of a
+   * document.
+   */
+  void reset();
+
+  /**
+   * Push the next chunk of the document through the tokenizer. Partial tags
+   * at the end of the chunk are remembered for the next call.
+   * @return number of bytes consumed, less than length once done() is true
+   */
+  size_t parse(const char *data, size_t length);
+
+  /**
+   * @return true once the channel title and max_items headlines are complete
+   */
+  bool done() const { return _state == DONE; }
+
+  size_t bytes_consumed() const { return _consumed; }
+
+private:
+  enum State {
+    SEEK_CHANNEL,
+    SEEK_SOURCE,
+    READ_SOURCE,
+    SEEK_ITEM,
+    SEEK_HEADLINE,
+    READ_HEADLINE,
+    DONE
+  };
+
+  void begin_text(char *dest);
+  void append_text(char c);
+  void end_text();
+
+  RssFeed *_feed;
+  int _max_items;
+  State _state;
+  size_t _consumed;
+
+  RssMatcher _channel;
+  RssMatcher _item;
+  RssMatcher _title_open;
+  RssMatcher _title_close;
+
+  char *_text;
+  size_t _text_length;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file sample_history.cpp
+ * @brief Windowed sensor statistics, see sample_history.h
+ */
+#include "sample_history.h"
+
+static const time_t SECONDS_PER_MINUTE = 60;
+static const time_t SECONDS_PER_HOUR = 3600;
+
+/*
+Close the open bucket of one level if t is past it. The closed bucket goes
+into the level's window and up into the parent's open bucket, and any
+buckets skipped by a gap in the samples are pushed empty.
+*/
+template <size_t N>
+static void roll_level(WindowStats<N> &window, StatBucket &open,
+                       time_t &start, time_t width, time_t t,
+                       StatBucket *parent) {
+  time_t new_start = t - t % width;
+  if (new_start <= start) {
+    return;
+  }
+
+  window.push(open);
+  if (parent) {
+    parent->merge(open);
+  }
+  open.reset();
+
+  time_t gaps = (new_start - start) / width - 1;
+  if (gaps > (time_t)N) {
+    gaps = N;
+  }
+  for (time_t i = 0; i < gaps; i++) {
+    window.push(open);
+  }
+  start = new_start;
+}
+
+void ChannelHistory::clear() {
+  _seconds.clear();
+  _minutes.clear();
+  _hours.clear();
+  _open_second.reset();
+  _open_minute.reset();
+  _open_hour.reset();
+  _started = false;
+}
+
+void ChannelHistory::roll(time_t t) {
+  if (!_started) {
+    _second_start = t;
+    _minute_start = t - t % SECONDS_PER_MINUTE;
+    _hour_start = t - t % SECONDS_PER_HOUR;
+    _started = true;
+    return;
+  }
+  // Lower levels first, so a closing second is merged into its own minute
+  // before that minute is closed
+  roll_level(_seconds, _open_second, _second_start, 1, t, &_open_minute);
+  roll_level(_minutes, _open_minute, _minute_start, SECONDS_PER_MINUTE, t,
+             &_open_hour);
+  roll_level(_hours, _open_hour, _hour_start, SECONDS_PER_HOUR, t, nullptr);
+}
+
+void ChannelHistory::add(time_t t, int16_t value) {
+  // A clock set backwards keeps adding to the current buckets
+  roll(t);
+  _open_second.add(value);
+}
+
+void ChannelHistory::last_minute(StatSummary *out) const {
+  _seconds.summary(out);
+  out->merge(_open_second);
+}
+
+void ChannelHistory::last_hour(StatSummary *out) const {
+  _minutes.summary(out);
+  out->merge(_open_minute);
+  out->merge(_open_second);
+}
+
+void ChannelHistory::last_day(StatSummary *out) const {
+  _hours.summary(out);
+  out->merge(_open_hour);
+  out->merge(_open_minute);
+  out->merge(_open_second);
+}
+
+void SampleHistory::add(const EnvSample &sample) {
+  _temperature.add(sample.time, sample.temperature);
+  _humidity.add(sample.time, (int16_t)sample.humidity);
+  _latest = sample;
+  _has_latest = true;
+}
+
+bool SampleHistory::latest(EnvSample *sample) const {
+  if (_has_latest) {
+    *sample = _latest;
+  }
+  return _has_latest;
+}
+
+void SampleHistory::window_summary(const ChannelHistory &channel,
+                                   Window window, StatSummary *out) {
+  out->reset();
+  switch (window) {
+  case MINUTE:
+    channel.last_minute(out);
+    break;
+  case HOUR:
+    channel.last_hour(out);
+    break;
+  case DAY:
+    channel.last_day(out);
+    break;
+  }
+}
+
+void SampleHistory::temperature(Window window, StatSummary *out) const {
+  window_summary(_temperature, window, out);
+}
+
+void SampleHistory::humidity(Window window, StatSummary *out) const {
+  window_summary(_humidity, window, out);
+}
@@ -0,0 +1,275 @@
+/**
+ * @file sample_history.h
+ * @brief Sensor history kept as min/max/mean/variance summaries over the
+ * last minute, hour and day, without storing every raw sample.
+ */
+#ifndef __SAMPLE_HISTORY_H__
+#define __SAMPLE_HISTORY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "env_sampler.h"
+
+/*
+Each level is a sliding window of buckets. A closed bucket is pushed into its
+own window and merged into the open bucket of the level above, so the hour
+and day windows are built from 60 minute and 24 hour buckets.
+
+A window counts the open bucket as its newest, so the last minute is the 59
+closed seconds before this one plus the one still filling, and so on up.
+*/
+#define HISTORY_SECONDS 60
+#define HISTORY_MINUTES 60
+#define HISTORY_HOURS 24
+
+/**
+ * Running totals for one channel over one bucket.
+ */
+struct StatBucket {
+  uint16_t count;
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+  int64_t sum_sq;
+
+  void reset() {
+    count = 0;
+    min = INT16_MAX;
+    max = INT16_MIN;
+    sum = 0;
+    sum_sq = 0;
+  }
+
+  void add(int16_t value) {
+    count++;
+    if (value < min) {
+      min = value;
+    }
+    if (value > max) {
+      max = value;
+    }
+    sum += value;
+    sum_sq += (int32_t)value * value;
+  }
+
+  void merge(const StatBucket &b) {
+    if (b.count == 0) {
+      return;
+    }
+    count += b.count;
+    if (b.min < min) {
+      min = b.min;
+    }
+    if (b.max > max) {
+      max = b.max;
+    }
+    sum += b.sum;
+    sum_sq += b.sum_sq;
+  }
+};
+
+/**
+ * Totals over a whole window, wide enough for a day of samples.
+ */
+struct StatSummary {
+  uint32_t count;
+  int16_t min;
+  int16_t max;
+  int64_t sum;
+  int64_t sum_sq;
+
+  void reset() {
+    count = 0;
+    min = INT16_MAX;
+    max = INT16_MIN;
+    sum = 0;
+    sum_sq = 0;
+  }
+
+  void merge(const StatBucket &b) {
+    if (b.count == 0) {
+      return;
+    }
+    count += b.count;
+    if (b.min < min) {
+      min = b.min;
+    }
+    if (b.max > max) {
+      max = b.max;
+    }
+    sum += b.sum;
+    sum_sq += b.sum_sq;
+  }
+
+  float mean() const { return count ? (float)((double)sum / count) : 0.0f; }
+
+  float variance() const {
+    if (count == 0) {
+      return 0.0f;
+    }
+    double m = (double)sum / count;
+    double v = (double)sum_sq / count - m * m;
+    return v > 0.0 ? (float)v : 0.0f;
+  }
+};
+
+/**
+ * Sliding window over the last N buckets. Sums are kept incrementally and
+ * min/max come from monotonic queues of slot indexes, so both push() and
+ * summary() are O(1).
+ */
+template <size_t N> class WindowStats {
+  static_assert(N > 0 && N < 0x10000, "N must fit the uint16_t slot index");
+
+public:
+  WindowStats() { clear(); }
+
+  void clear() {
+    _next = 0;
+    _size = 0;
+    _min_head = _min_len = 0;
+    _max_head = _max_len = 0;
+    _count = 0;
+    _sum = 0;
+    _sum_sq = 0;
+  }
+
+  void push(const StatBucket &b) {
+    if (_size == N) {
+      evict(_next);
+    } else {
+      _size++;
+    }
+
+    _buckets[_next] = b;
+    _count += b.count;
+    _sum += b.sum;
+    _sum_sq += b.sum_sq;
+
+    if (b.count) {
+      while (_min_len &&
+             _buckets[_min_q[back(_min_head, _min_len)]].min >= b.min) {
+        _min_len--;
+      }
+      _min_q[(_min_head + _min_len++) % N] = _next;
+
+      while (_max_len &&
+             _buckets[_max_q[back(_max_head, _max_len)]].max <= b.max) {
+        _max_len--;
+      }
+      _max_q[(_max_head + _max_len++) % N] = _next;
+    }
+
+    _next = (_next + 1) % N;
+  }
+
+  /**
+   * @brief add the totals of the window to a summary
+   */
+  void summary(StatSummary *out) const {
+    if (_count == 0) {
+      return;
+    }
+    out->count += _count;
+    out->sum += _sum;
+    out->sum_sq += _sum_sq;
+    if (_buckets[_min_q[_min_head]].min < out->min) {
+      out->min = _buckets[_min_q[_min_head]].min;
+    }
+    if (_buckets[_max_q[_max_head]].max > out->max) {
+      out->max = _buckets[_max_q[_max_head]].max;
+    }
+  }
+
+  size_t size() const { return _size; }
+
+private:
+  // Position of the last entry of a non-empty queue
+  uint16_t back(uint16_t head, uint16_t len) const {
+    return (head + len - 1) % N;
+  }
+
+  void evict(uint16_t slot) {
+    const StatBucket &old = _buckets[slot];
+    _count -= old.count;
+    _sum -= old.sum;
+    _sum_sq -= old.sum_sq;
+    if (_min_len && _min_q[_min_head] == slot) {
+      _min_head = (_min_head + 1) % N;
+      _min_len--;
+    }
+    if (_max_len && _max_q[_max_head] == slot) {
+      _max_head = (_max_head + 1) % N;
+      _max_len--;
+    }
+  }
+
+  StatBucket _buckets[N];
+  uint16_t _min_q[N];
+  uint16_t _max_q[N];
+  uint16_t _next, _size;
+  uint16_t _min_head, _min_len;
+  uint16_t _max_head, _max_len;
+  uint32_t _count;
+  int64_t _sum;
+  int64_t _sum_sq;
+};
+
+/**
+ * Second, minute and hour levels for one channel.
+ */
+class ChannelHistory {
+public:
+  ChannelHistory() { clear(); }
+
+  void clear();
+  void add(time_t t, int16_t value);
+
+  void last_minute(StatSummary *out) const;
+  void last_hour(StatSummary *out) const;
+  void last_day(StatSummary *out) const;
+
+private:
+  void roll(time_t t);
+
+  // Closed buckets only, the open one makes up the count
+  WindowStats<HISTORY_SECONDS - 1> _seconds;
+  WindowStats<HISTORY_MINUTES - 1> _minutes;
+  WindowStats<HISTORY_HOURS - 1> _hours;
+  StatBucket _open_second, _open_minute, _open_hour;
+  time_t _second_start, _minute_start, _hour_start;
+  bool _started;
+};
+
+class SampleHistory {
+public:
+  enum Window { MINUTE, HOUR, DAY };
+
+  SampleHistory() : _has_latest(false) {}
+
+  /**
+   * @brief add a sample, O(1) apart from filling empty buckets after a gap
+   */
+  void add(const EnvSample &sample);
+
+  /**
+   * @return false if no sample has been added yet
+   */
+  bool latest(EnvSample *sample) const;
+
+  void temperature(Window window, StatSummary *out) const;
+  void humidity(Window window, StatSummary *out) const;
+
+private:
+  static void window_summary(const ChannelHistory &channel, Window window,
+                             StatSummary *out);
+
+  ChannelHistory _temperature;
+  ChannelHistory _humidity;
+  EnvSample _latest;
+  bool _has_latest;
+};
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * @file snapshot.cpp
+ * @brief Snapshot record format and KVStore access, see snapshot.h
+ */
+#include "snapshot.h"
+
+#include "kvstore_global_api.h"
+#include "mbed.h"
+
+#include <string.h>
+
+SnapshotWriter::SnapshotWriter(uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(SNAPSHOT_HEADER_SIZE),
+      _overflow(size < SNAPSHOT_HEADER_SIZE) {}
+
+bool SnapshotWriter::put(uint8_t tag, const void *value, size_t size) {
+  if (_overflow || size > SNAPSHOT_FIELD_MAX || _length + 2 + size > _size) {
+    _overflow = true;
+    return false;
+  }
+  _buffer[_length] = tag;
+  _buffer[_length + 1] = (uint8_t)size;
+  memcpy(_buffer + _length + 2, value, size);
+  _length += 2 + size;
+  return true;
+}
+
+bool SnapshotWriter::put_string(uint8_t tag, const char *value) {
+  size_t size = strlen(value);
+  return put(tag, value, size < SNAPSHOT_FIELD_MAX ? size : SNAPSHOT_FIELD_MAX);
+}
+
+size_t SnapshotWriter::finish() {
+  if (_overflow || _length - SNAPSHOT_HEADER_SIZE > 0xFFFF) {
+    return 0;
+  }
+  size_t fields = _length - SNAPSHOT_HEADER_SIZE;
+  _buffer[0] = SNAPSHOT_MAGIC & 0xFF;
+  _buffer[1] = SNAPSHOT_MAGIC >> 8;
+  _buffer[2] = SNAPSHOT_VERSION;
+  _buffer[3] = 0;
+  _buffer[4] = fields & 0xFF;
+  _buffer[5] = fields >> 8;
+  return _length;
+}
+
+SnapshotReader::SnapshotReader(const uint8_t *data, size_t size)
+    : _data(data), _end(0), _pos(SNAPSHOT_HEADER_SIZE), _valid(false) {
+  if (size < SNAPSHOT_HEADER_SIZE ||
+      (data[0] | data[1] << 8) != SNAPSHOT_MAGIC ||
+      data[2] != SNAPSHOT_VERSION) {
+    return;
+  }
+  size_t fields = data[4] | data[5] << 8;
+  if (SNAPSHOT_HEADER_SIZE + fields > size) {
+    return;
+  }
+  _end = SNAPSHOT_HEADER_SIZE + fields;
+  _valid = true;
+}
+
+bool SnapshotReader::next(uint8_t *tag, const uint8_t **value, size_t *size) {
+  if (!_valid || _pos + 2 > _end || _pos + 2 + _data[_pos + 1] > _end) {
+    return false;
+  }
+  *tag = _data[_pos];
+  *size = _data[_pos + 1];
+  *value = _data + _pos + 2;
+  _pos += 2 + *size;
+  return true;
+}
+
+void SnapshotReader::get_string(const uint8_t *value, size_t size, char *out,
+                                size_t out_size) {
+  if (out_size == 0) {
+    return;
+  }
+  size_t length = size < out_size - 1 ? size : out_size - 1;
+  memcpy(out, value, length);
+  out[length] = '\0';
+}
+
+bool SnapshotReader::get(const uint8_t *value, size_t size, void *out,
+                         size_t out_size) {
+  if (size != out_size) {
+    return false;
+  }
+  memcpy(out, value, size);
+  return true;
+}
+
+SnapshotStore::SnapshotStore(const char *key) : _key(key), _stored_hash(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+size_t SnapshotStore::load(uint8_t *buffer, size_t size) {
+  Timer timer;
+  timer.start();
+  size_t actual = 0;
+  int status = kv_get(_key, buffer, size, &actual);
+  _stats.load_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          timer.elapsed_time())
+          .count();
+  if (status != MBED_SUCCESS) {
+    // Not found on a first boot, KVStore tells them apart
+    if (status != MBED_ERROR_ITEM_NOT_FOUND) {
+      _stats.errors++;
+    }
+    return 0;
+  }
+  if (actual > size) {
+    return 0;
+  }
+  _stored_hash = hash(buffer, actual);
+  return actual;
+}
+
+int SnapshotStore::save(const uint8_t *data, size_t size) {
+  uint32_t new_hash = hash(data, size);
+  if (new_hash == _stored_hash) {
+    _stats.unchanged++;
+    return MBED_SUCCESS;
+  }
+  Timer timer;
+  timer.start();
+  int status = kv_set(_key, data, size, 0);
+  _stats.last_save_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          timer.elapsed_time())
+          .count();
+  if (status != MBED_SUCCESS) {
+    _stats.errors++;
+    _stored_hash = 0;
+    return status;
+  }
+  _stats.saves++;
+  _stored_hash = new_hash;
+  return MBED_SUCCESS;
+}
+
+uint32_t SnapshotStore::hash(const uint8_t *data, size_t size) {
+  // FNV-1a, only has to tell snapshots apart, 0 stays free for "not known"
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return h ? h : 1;
+}
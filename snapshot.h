@@ -0,0 +1,143 @@
+/**
+ * @file snapshot.h
+ * @brief What the UI last knew, as one small KVStore record, so after a
+ * reset it starts from that instead of waiting for the network.
+ */
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC 0x534E // "SN"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 6
+
+// A field is its tag, its length and the value, at most this long
+#define SNAPSHOT_FIELD_MAX 255
+
+/*
+Layout, the header little-endian:
+
+  magic (2) | version (1) | reserved (1) | length of the fields (2)
+  tag (1) | length (1) | value ... repeated
+
+Numbers in values are stored as the CPU has them. A tag can repeat, e.g.
+once per headline. Readers skip tags they do not know, so fields can be
+added without a new version. KVStore keeps a CRC of the record, a damaged
+one is not returned.
+*/
+
+class SnapshotWriter {
+public:
+  SnapshotWriter(uint8_t *buffer, size_t size);
+
+  /**
+   * @return false when the field is too long or the buffer is full, the
+   * snapshot is then not finished
+   */
+  bool put(uint8_t tag, const void *value, size_t size);
+
+  /**
+   * @brief the string without its NUL, cut to SNAPSHOT_FIELD_MAX
+   */
+  bool put_string(uint8_t tag, const char *value);
+
+  template <typename T> bool put_value(uint8_t tag, const T &value) {
+    return put(tag, &value, sizeof(value));
+  }
+
+  /**
+   * @brief fill in the header
+   * @return bytes to store, 0 when a field did not fit
+   */
+  size_t finish();
+
+private:
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _length;
+  bool _overflow;
+};
+
+class SnapshotReader {
+public:
+  /**
+   * @param data record as stored, checked for magic, version and length
+   */
+  SnapshotReader(const uint8_t *data, size_t size);
+
+  bool valid() const { return _valid; }
+
+  /**
+   * @brief step to the next field
+   * @return false after the last one
+   */
+  bool next(uint8_t *tag, const uint8_t **value, size_t *size);
+
+  /**
+   * @brief copy a field into a char array, cut and always NUL terminated
+   */
+  static void get_string(const uint8_t *value, size_t size, char *out,
+                         size_t out_size);
+
+  /**
+   * @return false when the field is not sizeof(T) long, *out unchanged
+   */
+  template <typename T>
+  static bool get_value(const uint8_t *value, size_t size, T *out) {
+    return get(value, size, out, sizeof(T));
+  }
+
+private:
+  static bool get(const uint8_t *value, size_t size, void *out,
+                  size_t out_size);
+
+  const uint8_t *_data;
+  size_t _end;
+  size_t _pos;
+  bool _valid;
+};
+
+struct SnapshotStats {
+  uint32_t saves;
+  uint32_t unchanged; // saves skipped, the same bytes were stored
+  uint32_t errors;
+  uint32_t last_save_ms;
+  uint32_t load_ms;
+};
+
+/**
+ * One KVStore key. Writes go to flash and can take tens of ms when the
+ * store compacts, keep them off the UI thread.
+ */
+class SnapshotStore {
+public:
+  /**
+   * @param key full KVStore name, e.g. "/kv/snapshot"
+   */
+  explicit SnapshotStore(const char *key);
+
+  /**
+   * @return size of the snapshot read into buffer, 0 when there is none or
+   * it does not fit
+   */
+  size_t load(uint8_t *buffer, size_t size);
+
+  /**
+   * @brief store the snapshot, unless it is what was stored or loaded last
+   * @return 0 (MBED_SUCCESS) or the KVStore error
+   */
+  int save(const uint8_t *data, size_t size);
+
+  const SnapshotStats &stats() const { return _stats; }
+
+private:
+  static uint32_t hash(const uint8_t *data, size_t size);
+
+  const char *_key;
+  uint32_t _stored_hash; // of what is in flash, 0 when not known
+  SnapshotStats _stats;
+};
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * @file sntp_client.cpp
+ * @brief SNTP time sync, see sntp_client.h
+ */
+#include "sntp_client.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SNTP_PACKET_SIZE 48
+
+// Seconds from 1900, where NTP time starts, to 1970
+#define NTP_UNIX_OFFSET 2208988800ULL
+
+#define SNTP_MODE_CLIENT 3
+#define SNTP_MODE_SERVER 4
+#define SNTP_VERSION 4
+#define SNTP_LEAP_UNSYNCHRONIZED 3
+
+static uint32_t read_be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+// NTP timestamp to ms since 1970. Seconds with the top bit clear are taken
+// to be after 2036, when the 32 bit count wraps (RFC 4330 section 3).
+static int64_t ntp_to_unix_ms(const uint8_t *p) {
+  uint64_t seconds = read_be32(p);
+  uint64_t fraction = read_be32(p + 4);
+  if ((seconds & 0x80000000) == 0) {
+    seconds += 0x100000000ULL;
+  }
+  return (int64_t)(seconds - NTP_UNIX_OFFSET) * 1000 +
+         (int64_t)((fraction * 1000) >> 32);
+}
+
+SntpClient::SntpClient(NetworkInterface *network, DnsCache *dns)
+    : _network(network), _dns(dns), _edge_rtc(0), _edge_local_ms(0),
+      _synced_rtc_ms(0), _residual_ms(0), _elapsed_ms(0), _drift_total_ms(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+nsapi_error_t SntpClient::sync(const char *host, SntpResult *result) {
+  SocketAddress server;
+  nsapi_error_t status = _dns->gethostbyname(host, &server);
+  if (status != NSAPI_ERROR_OK) {
+    return status;
+  }
+  server.set_port(SNTP_PORT);
+
+  UDPSocket socket;
+  status = socket.open(_network);
+  if (status != NSAPI_ERROR_OK) {
+    return status;
+  }
+  socket.set_timeout(SNTP_TIMEOUT_MS);
+
+  find_rtc_edge();
+
+  Sample best = {};
+  bool have_sample = false;
+  for (int i = 0; i < SNTP_SAMPLES; i++) {
+    Sample sample;
+    nsapi_error_t query_status = query(&socket, server, &sample);
+    if (query_status != NSAPI_ERROR_OK) {
+      status = query_status;
+    } else if (!have_sample || sample.delay_ms < best.delay_ms) {
+      best = sample;
+      have_sample = true;
+    }
+  }
+  socket.close();
+  if (!have_sample) {
+    if (status == NSAPI_ERROR_OK) {
+      status = NSAPI_ERROR_DEVICE_ERROR;
+    }
+    // A pool name hands out another server on the next lookup
+    _dns->forget(host);
+    return status;
+  }
+
+  int64_t rtc_at_sample = rtc_ms(best.local_ms);
+  int64_t offset_ms = best.reference_ms - rtc_at_sample;
+
+  result->offset_ms = offset_ms;
+  result->delay_ms = best.delay_ms;
+  result->stratum = best.stratum;
+  result->stepped = false;
+  result->drift_ppm = 0;
+
+  if (_synced_rtc_ms != 0) {
+    // Only what the RTC gained or lost since it was last right
+    int64_t interval_ms = rtc_at_sample - _synced_rtc_ms;
+    int64_t drift_ms = offset_ms - _residual_ms;
+    _elapsed_ms += interval_ms;
+    _drift_total_ms += drift_ms;
+    if (interval_ms >= std::chrono::duration_cast<std::chrono::milliseconds>(
+                           SNTP_DRIFT_MIN_INTERVAL)
+                           .count()) {
+      result->drift_ppm = drift_ms * 1e6f / interval_ms;
+    }
+  }
+  result->elapsed_ms = _elapsed_ms;
+  result->drift_total_ms = _drift_total_ms;
+
+  _residual_ms = offset_ms;
+  if (llabs(offset_ms) > SNTP_STEP_LIMIT_MS) {
+    // The RTC starts its new second when it is set, so it is set as the
+    // reference second begins
+    int64_t reference = best.reference_ms + (local_ms() - best.local_ms);
+    ThisThread::sleep_for(std::chrono::milliseconds(1000 - reference % 1000));
+    reference = best.reference_ms + (local_ms() - best.local_ms);
+    set_time((reference + 500) / 1000);
+    result->stepped = true;
+    _residual_ms = 0;
+    _stats.steps++;
+  }
+  _synced_rtc_ms = rtc_at_sample + (offset_ms - _residual_ms);
+  result->time = time(NULL);
+  _stats.syncs++;
+  return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t SntpClient::query(UDPSocket *socket, const SocketAddress &server,
+                                Sample *sample) {
+  uint8_t packet[SNTP_PACKET_SIZE];
+  memset(packet, 0, sizeof(packet));
+  packet[0] = (SNTP_VERSION << 3) | SNTP_MODE_CLIENT;
+
+  // The server echoes the transmit timestamp back as the originate
+  // timestamp. It is a nonce here, so a late answer to an earlier query is
+  // not taken for this one.
+  _stats.queries++;
+  uint32_t nonce[2] = {(uint32_t)local_ms(), _stats.queries};
+  memcpy(packet + 40, nonce, sizeof(nonce));
+  uint8_t originate[8];
+  memcpy(originate, packet + 40, sizeof(originate));
+
+  int64_t sent = local_ms();
+  nsapi_size_or_error_t size = socket->sendto(server, packet, sizeof(packet));
+  if (size < 0) {
+    return size;
+  }
+
+  SocketAddress from;
+  int64_t received;
+  while (true) {
+    size = socket->recvfrom(&from, packet, sizeof(packet));
+    received = local_ms();
+    if (size < 0) {
+      if (size == NSAPI_ERROR_WOULD_BLOCK) {
+        _stats.timeouts++;
+      }
+      return size;
+    }
+    // A late answer to a query that timed out is ahead of this one's in
+    // the socket, skip it and keep waiting
+    if (size < SNTP_PACKET_SIZE ||
+        memcmp(packet + 24, originate, sizeof(originate)) == 0) {
+      break;
+    }
+    _stats.rejected++;
+  }
+
+  uint8_t mode = packet[0] & 0x07;
+  uint8_t leap = packet[0] >> 6;
+  uint8_t stratum = packet[1];
+  // Stratum 0 is a kiss-o'-death, the server asks to be left alone
+  if (size < SNTP_PACKET_SIZE || mode != SNTP_MODE_SERVER ||
+      leap == SNTP_LEAP_UNSYNCHRONIZED || stratum == 0 || stratum > 15 ||
+      read_be32(packet + 40) == 0) {
+    _stats.rejected++;
+    return NSAPI_ERROR_DEVICE_ERROR;
+  }
+
+  int64_t server_received = ntp_to_unix_ms(packet + 32);
+  int64_t server_sent = ntp_to_unix_ms(packet + 40);
+  int64_t delay = (received - sent) - (server_sent - server_received);
+  if (delay < 0) {
+    delay = 0;
+  }
+
+  // The answer took about half the round trip to get here
+  sample->reference_ms = server_sent + delay / 2;
+  sample->local_ms = received;
+  sample->delay_ms = delay;
+  sample->stratum = stratum;
+  return NSAPI_ERROR_OK;
+}
+
+void SntpClient::find_rtc_edge() {
+  time_t start = time(NULL);
+  time_t now;
+  while ((now = time(NULL)) == start) {
+    ThisThread::sleep_for(1ms);
+  }
+  _edge_rtc = now;
+  _edge_local_ms = local_ms();
+}
+
+int64_t SntpClient::rtc_ms(int64_t local) const {
+  // Kernel::Clock and the RTC drift apart by far less than a ms over the
+  // few seconds of a sync
+  return (int64_t)_edge_rtc * 1000 + (local - _edge_local_ms);
+}
+
+int64_t SntpClient::local_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             Kernel::Clock::now().time_since_epoch())
+      .count();
+}
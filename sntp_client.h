@@ -0,0 +1,97 @@
+/**
+ * @file sntp_client.h
+ * @brief SNTP (RFC 4330) over UDP. Measures how far the RTC is off from a
+ * time server with the round trip taken out, and sets it on a second
+ * boundary, so it is right to a few ms instead of to the second.
+ */
+#ifndef __SNTP_CLIENT_H__
+#define __SNTP_CLIENT_H__
+
+#include "UDPSocket.h"
+#include "dns_cache.h"
+#include "mbed.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#define SNTP_PORT 123
+#define SNTP_TIMEOUT_MS 1000
+
+// Queries per sync, the answer with the shortest round trip is used, as it
+// has the least room for an asymmetric delay
+#define SNTP_SAMPLES 4
+
+// The RTC is only set when it is further off than this
+#define SNTP_STEP_LIMIT_MS 20
+
+// Syncs closer together than this do not update the drift
+#define SNTP_DRIFT_MIN_INTERVAL 10min
+
+struct SntpResult {
+  int32_t offset_ms; // reference time minus RTC, before the RTC was set
+  uint32_t delay_ms; // round trip without the server's processing time
+  uint8_t stratum;
+  bool stepped;    // the RTC was set
+  float drift_ppm; // RTC rate error since the previous sync, + is slow
+  time_t time;     // RTC after the sync
+
+  // Since the first sync, as if the RTC had never been set. RTC time that
+  // went by, and how much it fell behind the reference (+) or ran ahead.
+  int64_t elapsed_ms;
+  int64_t drift_total_ms;
+};
+
+struct SntpStats {
+  uint32_t syncs;
+  uint32_t queries;
+  uint32_t timeouts;
+  uint32_t rejected; // answers that failed the checks
+  uint32_t steps;
+};
+
+/**
+ * The RTC only counts whole seconds, so each sync first waits for it to
+ * turn over and takes that moment on Kernel::Clock as its sub-second
+ * reference. Calls block, run them on the network thread.
+ */
+class SntpClient {
+public:
+  SntpClient(NetworkInterface *network, DnsCache *dns);
+
+  /**
+   * @brief query host and set the RTC to its UTC time. Blocks for up to a
+   * second plus SNTP_SAMPLES * SNTP_TIMEOUT_MS.
+   * @return NSAPI_ERROR_OK, or the error of the last query when no answer
+   * could be used
+   */
+  nsapi_error_t sync(const char *host, SntpResult *result);
+
+  const SntpStats &stats() const { return _stats; }
+
+private:
+  // Reference time at a moment on Kernel::Clock, both in ms
+  struct Sample {
+    int64_t reference_ms;
+    int64_t local_ms;
+    uint32_t delay_ms;
+    uint8_t stratum;
+  };
+
+  nsapi_error_t query(UDPSocket *socket, const SocketAddress &server,
+                      Sample *sample);
+  void find_rtc_edge();
+  int64_t rtc_ms(int64_t local_ms) const;
+  static int64_t local_ms();
+
+  NetworkInterface *_network;
+  DnsCache *_dns;
+  time_t _edge_rtc;       // the RTC turned to this second
+  int64_t _edge_local_ms; // at this Kernel::Clock time
+  int64_t _synced_rtc_ms; // RTC at the last sync, 0 before the first
+  int32_t _residual_ms;   // offset the RTC was left with then
+  int64_t _elapsed_ms;
+  int64_t _drift_total_ms;
+  SntpStats _stats;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file spsc_ring.h
+ * @brief Fixed-capacity, allocation-free ring buffer for handing items from
+ * one producer context to one consumer context without locks.
+ */
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Only the producer writes _head and only the consumer writes _tail, so the
+ * two sides never wait for each other. N must be a power of two.
+ */
+template <typename T, size_t N> class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  SpscRing() : _head(0), _tail(0), _dropped(0) {}
+
+  /**
+   * @brief producer side, store an item
+   * @return false and count a drop when the ring is full
+   */
+  bool push(const T &item) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == N) {
+      _dropped++;
+      return false;
+    }
+    _items[head & (N - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief consumer side, take the oldest item
+   * @return false when the ring is empty
+   */
+  bool pop(T *item) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (_head.load(std::memory_order_acquire) == tail) {
+      return false;
+    }
+    *item = _items[tail & (N - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return _head.load(std::memory_order_acquire) -
+           _tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  T _items[N];
+  std::atomic<uint32_t> _head;
+  std::atomic<uint32_t> _tail;
+  uint32_t _dropped;
+};
+
+#endif
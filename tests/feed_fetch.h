@@ -0,0 +1,121 @@
+/**
+ * @file feed_fetch.h
+ * @brief The feed fetch of the firmware for the host tests. Follows
+ * hentefeed() in main.cpp, which cannot be built here, and has to be kept
+ * the same as it.
+ */
+#ifndef __FEED_FETCH_H__
+#define __FEED_FETCH_H__
+
+#include "http_client.h"
+#include "rss_parser.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+// As in main.cpp
+#define RSS_RANGE_SIZE (1536 + RSS_MAX_HEADLINES * 768)
+#define RSS_COMPRESSED                                                         \
+  (HTTP_COMPRESSION && RSS_RANGE_SIZE > HTTP_DRAIN_LIMIT &&                    \
+   RSS_RANGE_SIZE <= INFLATE_WINDOW_SIZE)
+
+struct FeedFetch {
+  int status;
+  unsigned long received;
+  int requests;
+};
+
+static bool feed_rss(RssParser *parser, const char *data, size_t size) {
+  parser->parse(data, size);
+  return !parser->done();
+}
+
+/**
+ * @param compressed RSS_COMPRESSED in the firmware, a test can try both
+ */
+static inline FeedFetch fetch_feed(HttpClient *http, const char *host,
+                                   const char *path, RssFeed *feed,
+                                   HttpValidators *validators,
+                                   bool compressed = RSS_COMPRESSED) {
+  RssParser parser(feed);
+  HttpRange range = {0, RSS_RANGE_SIZE - 1, 0};
+  FeedFetch fetch = {0, 0, 0};
+  bool parts = !compressed;
+  bool restarted = false;
+  if (compressed) {
+    fetch.status = http->get(host, path, "cert", callback(feed_rss, &parser),
+                             validators);
+    fetch.received += http->stats().last_received;
+    fetch.requests++;
+    if (fetch.status == NSAPI_ERROR_DEVICE_ERROR) {
+      parser.reset();
+      memset(validators, 0, sizeof(*validators));
+      parts = true;
+    }
+  }
+  while (parts) {
+    fetch.status = http->get(host, path, "cert", callback(feed_rss, &parser),
+                             validators, &range);
+    fetch.received += http->stats().last_received;
+    fetch.requests++;
+
+    if (fetch.status == 200 && range.first > 0 && !restarted) {
+      parser.reset();
+      memset(validators, 0, sizeof(*validators));
+      range.first = 0;
+      range.last = RSS_RANGE_SIZE - 1;
+      restarted = true;
+      continue;
+    }
+    if (fetch.status == 416 && range.first > 0) {
+      // Past the end of a document whose length the server did not give
+      fetch.status = 206;
+      break;
+    }
+    // A total of 0 is unknown ('*'), then a short part is the last one
+    if (fetch.status != 206 || parser.done() ||
+        (range.total != 0 && range.last + 1 >= range.total) ||
+        http->stats().last_decoded < range.last - range.first + 1) {
+      break;
+    }
+    range.first = range.last + 1;
+    range.last = range.first + RSS_RANGE_SIZE - 1;
+  }
+  return fetch;
+}
+
+/**
+ * @return titles of the first count items of doc, by a plain search
+ */
+static inline std::vector<std::string> feed_titles(const std::string &doc,
+                                                   int count) {
+  const std::string open = "<title><![CDATA[", close = "]]></title>";
+  std::vector<std::string> found;
+  size_t pos = doc.find("<channel>");
+  while ((int)found.size() < count &&
+         (pos = doc.find("<item>", pos)) != std::string::npos) {
+    size_t start = doc.find(open, pos) + open.size();
+    pos = doc.find(close, start);
+    found.push_back(doc.substr(start, pos - start));
+  }
+  return found;
+}
+
+/**
+ * @return whether feed holds the BBC channel and exactly the titles in want
+ */
+static inline bool feed_matches(const RssFeed &feed,
+                                const std::vector<std::string> &want) {
+  if (feed.headline_count != (int)want.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < want.size(); i++) {
+    if (want[i] != feed.headlines[i]) {
+      return false;
+    }
+  }
+  return strcmp(feed.source, "BBC News") == 0;
+}
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file feed_server.h
+ * @brief Stand-in for feeds.bbci.co.uk in the host tests. Serves one
+ * document the way the real server does: with an ETag and Last-Modified,
+ * a 304 to a request whose validators still match, a 206 to a Range
+ * request unless If-Range names an older version, and a compressed body to
+ * a request that accepts one.
+ */
+#ifndef __FEED_SERVER_H__
+#define __FEED_SERVER_H__
+
+#include "host_server.h"
+
+#include <string>
+#include <zlib.h>
+
+class FeedServer : public host::Server {
+public:
+  /**
+   * @brief deflate data with zlib
+   * @param window_bits 9..15 for a zlib stream, +16 for gzip, negative for
+   * raw deflate
+   */
+  static std::string compress(const std::string &data, int window_bits) {
+    z_stream z = {};
+    deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, window_bits, 9,
+                 Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&z, data.size()), '\0');
+    z.next_in = (Bytef *)data.data();
+    z.avail_in = data.size();
+    z.next_out = (Bytef *)&out[0];
+    z.avail_out = out.size();
+    deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+  }
+
+  /**
+   * @brief replace the document, a new version gets new validators
+   */
+  void update(const std::string &body) {
+    _body = body;
+    _version++;
+    char etag[32], modified[40];
+    snprintf(etag, sizeof(etag), "\"feed-%d\"", _version);
+    snprintf(modified, sizeof(modified), "Sat, 17 Oct 2026 %02d:%02d:00 GMT",
+             _version / 60 % 24, _version % 60);
+    _etag = etag;
+    _last_modified = modified;
+  }
+
+  std::string respond(const std::string &request) override {
+    std::string etag = send_etag ? _etag + etag_padding : "";
+    std::string last_modified = send_last_modified ? _last_modified : "";
+    std::string validators;
+    if (!etag.empty()) {
+      validators += "ETag: " + etag + "\r\n";
+    }
+    if (!last_modified.empty()) {
+      validators += "Last-Modified: " + last_modified + "\r\n";
+    }
+
+    // If-None-Match wins over If-Modified-Since, as in RFC 9110
+    std::string none_match = header(request, "If-None-Match");
+    std::string modified_since = header(request, "If-Modified-Since");
+    bool unchanged = !none_match.empty()
+                         ? none_match == etag
+                         : !modified_since.empty() &&
+                               modified_since == last_modified;
+    if (unchanged) {
+      not_modified++;
+      return "HTTP/1.1 304 Not Modified\r\n" + validators + "\r\n";
+    }
+
+    unsigned long first, last;
+    std::string range = header(request, "Range");
+    std::string accept = header(request, "Accept-Encoding");
+    if (!range.empty()) {
+      range_accept = accept;
+    }
+    if (ranges && sscanf(range.c_str(), "bytes=%lu-%lu", &first, &last) == 2 &&
+        first < _body.size() && first <= last) {
+      std::string if_range = header(request, "If-Range");
+      if (if_range.empty() || if_range == etag || if_range == last_modified) {
+        last = last < _body.size() - 1 ? last : _body.size() - 1;
+        char content_range[64];
+        snprintf(content_range, sizeof(content_range),
+                 "Content-Range: bytes %lu-%lu/%zu\r\n", first, last,
+                 _body.size());
+        if (unknown_total) {
+          snprintf(content_range, sizeof(content_range),
+                   "Content-Range: bytes %lu-%lu/*\r\n", first, last);
+        }
+        partial++;
+        if (!encoding.empty() && compress_ranges) {
+          // The part of the compressed document, whatever was accepted
+          std::string body = compress(_body, window_bits + 16);
+          last = last < body.size() - 1 ? last : body.size() - 1;
+          snprintf(content_range, sizeof(content_range),
+                   "Content-Range: bytes %lu-%lu/%zu\r\n", first, last,
+                   body.size());
+          return response(206,
+                          "Content-Type: application/rss+xml\r\n"
+                          "Content-Encoding: gzip\r\n" +
+                              std::string(content_range) + validators,
+                          body.substr(first, last - first + 1));
+        }
+        return response(206,
+                        "Content-Type: application/rss+xml\r\n" +
+                            std::string(content_range) + validators,
+                        _body.substr(first, last - first + 1));
+      }
+    }
+    if (ranges && sscanf(range.c_str(), "bytes=%lu-", &first) == 1 &&
+        first >= _body.size()) {
+      unsatisfiable++;
+      return response(416, "Content-Range: bytes */" +
+                               std::to_string(_body.size()) + "\r\n",
+                      "");
+    }
+    full++;
+    if (!encoding.empty() && range.empty() &&
+        accept.find(encoding) != std::string::npos) {
+      int bits = encoding == "gzip" ? window_bits + 16
+                 : raw              ? -window_bits
+                                    : window_bits;
+      return response(200,
+                      "Content-Type: application/rss+xml\r\n"
+                      "Content-Encoding: " +
+                          encoding + "\r\n" + validators,
+                      compress(_body, bits));
+    }
+    return response(200, "Content-Type: application/rss+xml\r\n" + validators,
+                    _body);
+  }
+
+  bool send_etag = true;
+  bool send_last_modified = true;
+  std::string etag_padding; // makes the ETag longer
+  bool ranges = true;         // false answers a Range with the whole document
+  bool unknown_total = false; // Content-Range ends in '*'
+  std::string encoding;       // "gzip" or "deflate" when accepted, else none
+  int window_bits = 15;       // of the compressor
+  bool raw = false;           // "deflate" without the zlib wrapper
+
+  // With encoding set, a 206 is a part of the gzip document whatever the
+  // request accepted, as a server that ignores Accept-Encoding would send
+  bool compress_ranges = false;
+
+  std::string range_accept; // Accept-Encoding of the last Range request
+
+  uint32_t not_modified = 0;
+  uint32_t full = 0;
+  uint32_t partial = 0;
+  uint32_t unsatisfiable = 0; // 416 to a Range past the end
+
+private:
+  std::string _body;
+  std::string _etag;
+  std::string _last_modified;
+  int _version = 0;
+};
+
+#endif
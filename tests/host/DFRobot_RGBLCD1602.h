@@ -0,0 +1,66 @@
+/**
+ * @file DFRobot_RGBLCD1602.h
+ * @brief Host stand-in for the DFRobot driver with the calls LcdFrameBuffer
+ * makes. Keeps the characters on the display and records every I2C
+ * transaction, counting the bytes the driver would put on the bus.
+ */
+#ifndef __HOST_DFROBOT_RGBLCD1602_H__
+#define __HOST_DFROBOT_RGBLCD1602_H__
+
+#include "mbed.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+class DFRobot_RGBLCD1602 {
+public:
+  struct Transaction {
+    int col; // -1 for a run at the cursor
+    int row;
+    std::string data;
+  };
+
+  DFRobot_RGBLCD1602() : bytes(0), _col(0), _row(0) {
+    memset(ddram, ' ', sizeof(ddram));
+  }
+
+  // The address byte, the data control byte and the characters
+  size_t writeRun(const char *data_p, size_t len) {
+    transactions.push_back({-1, _row, std::string(data_p, len)});
+    bytes += 2 + len;
+    store(data_p, len);
+    return len;
+  }
+
+  // As writeRun, with the command control byte and the cursor command in
+  // front
+  size_t writeRunAt(uint8_t col, uint8_t row, const char *data_p,
+                    size_t len) {
+    transactions.push_back({col, row, std::string(data_p, len)});
+    bytes += 4 + len;
+    _col = col;
+    _row = row;
+    store(data_p, len);
+    return len;
+  }
+
+  std::string row(int row) const { return std::string(ddram[row], 16); }
+
+  char ddram[2][16];
+  std::vector<Transaction> transactions;
+  uint32_t bytes;
+
+private:
+  void store(const char *data_p, size_t len) {
+    for (size_t i = 0; i < len; i++, _col++) {
+      if (_row < 2 && _col < 16) {
+        ddram[_row][_col] = data_p[i];
+      }
+    }
+  }
+
+  int _col, _row;
+};
+
+#endif
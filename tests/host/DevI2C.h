@@ -0,0 +1,56 @@
+/**
+ * @file DevI2C.h
+ * @brief Host stand-in for the X_NUCLEO_COMMON I2C helper: one device with a
+ * register map the test fills in, counting the bus transactions.
+ */
+#ifndef __HOST_DEV_I2C_H__
+#define __HOST_DEV_I2C_H__
+
+#include "mbed.h"
+
+#include <string.h>
+
+/**
+ * Like the ST sensors, bit 7 of the register address asks for the address
+ * to be incremented after each byte, otherwise a burst repeats one register.
+ */
+class DevI2C {
+public:
+  DevI2C() : reads(0), writes(0), bytes(0) { memset(regs, 0, sizeof(regs)); }
+
+  int i2c_read(uint8_t *buffer, uint8_t address, uint8_t reg,
+               uint16_t count) {
+    (void)address;
+    reads++;
+    for (uint16_t i = 0; i < count; i++) {
+      buffer[i] = regs[next(reg, i)];
+    }
+    bytes += count;
+    return 0;
+  }
+
+  int i2c_write(uint8_t *buffer, uint8_t address, uint8_t reg,
+                uint16_t count) {
+    (void)address;
+    writes++;
+    for (uint16_t i = 0; i < count; i++) {
+      regs[next(reg, i)] = buffer[i];
+    }
+    bytes += count;
+    return 0;
+  }
+
+  uint32_t transactions() const { return reads + writes; }
+
+  uint8_t regs[128];
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t bytes;
+
+private:
+  static uint8_t next(uint8_t reg, uint16_t i) {
+    return (reg & 0x80) ? ((reg & 0x7F) + i) & 0x7F : reg;
+  }
+};
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file NetworkInterface.h
+ * @brief Host stand-in for the nsapi types and NetworkInterface. Names
+ * resolve to the in-process servers registered with host::serve(), see
+ * host_server.h.
+ */
+#ifndef __HOST_NETWORK_INTERFACE_H__
+#define __HOST_NETWORK_INTERFACE_H__
+
+#include "mbed.h"
+
+#include <string>
+
+typedef int nsapi_error_t;
+typedef int nsapi_size_or_error_t;
+typedef int nsapi_value_or_error_t;
+typedef unsigned int nsapi_size_t;
+
+enum nsapi_error {
+  NSAPI_ERROR_OK = 0,
+  NSAPI_ERROR_WOULD_BLOCK = -3001,
+  NSAPI_ERROR_UNSUPPORTED = -3002,
+  NSAPI_ERROR_PARAMETER = -3003,
+  NSAPI_ERROR_NO_CONNECTION = -3004,
+  NSAPI_ERROR_NO_SOCKET = -3005,
+  NSAPI_ERROR_NO_ADDRESS = -3006,
+  NSAPI_ERROR_NO_MEMORY = -3007,
+  NSAPI_ERROR_NO_SSID = -3008,
+  NSAPI_ERROR_DNS_FAILURE = -3009,
+  NSAPI_ERROR_DHCP_FAILURE = -3010,
+  NSAPI_ERROR_AUTH_FAILURE = -3011,
+  NSAPI_ERROR_DEVICE_ERROR = -3012,
+  NSAPI_ERROR_IN_PROGRESS = -3013,
+  NSAPI_ERROR_ALREADY = -3014,
+  NSAPI_ERROR_IS_CONNECTED = -3015,
+  NSAPI_ERROR_CONNECTION_LOST = -3016,
+  NSAPI_ERROR_CONNECTION_TIMEOUT = -3017,
+  NSAPI_ERROR_ADDRESS_IN_USE = -3018,
+  NSAPI_ERROR_TIMEOUT = -3019,
+  NSAPI_ERROR_BUSY = -3020,
+};
+
+enum nsapi_version_t { NSAPI_UNSPEC, NSAPI_IPv4, NSAPI_IPv6 };
+
+class SocketAddress {
+public:
+  SocketAddress(const char *ip = nullptr, uint16_t port = 0)
+      : _ip(ip ? ip : ""), _port(port) {}
+
+  bool set_ip_address(const char *ip) {
+    _ip = ip ? ip : "";
+    return true;
+  }
+  const char *get_ip_address() const {
+    return _ip.empty() ? nullptr : _ip.c_str();
+  }
+  void set_port(uint16_t port) { _port = port; }
+  uint16_t get_port() const { return _port; }
+
+  explicit operator bool() const { return !_ip.empty(); }
+
+private:
+  std::string _ip;
+  uint16_t _port;
+};
+
+/**
+ * Resolves the names of registered servers to a made-up address, after
+ * dns_delay on the simulated clock. Tests override the lookups to stand in
+ * for a slow or failing resolver.
+ */
+class NetworkInterface {
+public:
+  typedef Callback<void(nsapi_value_or_error_t, SocketAddress *)>
+      hostbyname_cb_t;
+
+  virtual ~NetworkInterface() {}
+
+  virtual nsapi_error_t gethostbyname(const char *host,
+                                      SocketAddress *address,
+                                      nsapi_version_t version = NSAPI_UNSPEC,
+                                      const char *interface_name = nullptr);
+
+  /**
+   * @brief answers on the calling thread before returning, which the real
+   * stack also does for names it has cached
+   */
+  virtual nsapi_value_or_error_t
+  gethostbyname_async(const char *host, hostbyname_cb_t callback,
+                      nsapi_version_t version = NSAPI_UNSPEC,
+                      const char *interface_name = nullptr);
+
+  std::chrono::microseconds dns_delay = 0us;
+  uint32_t lookups = 0;
+};
+
+#endif
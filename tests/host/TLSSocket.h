@@ -0,0 +1,50 @@
+/**
+ * @file TLSSocket.h
+ * @brief Host stand-in for TLSSocket, talking to the in-process server
+ * registered under the hostname, see host_server.h. No TLS happens, the
+ * handshake is the server's handshake_time on the simulated clock.
+ */
+#ifndef __HOST_TLS_SOCKET_H__
+#define __HOST_TLS_SOCKET_H__
+
+#include "NetworkInterface.h"
+#include "host_server.h"
+
+class TLSSocket {
+public:
+  TLSSocket() {}
+  ~TLSSocket() { close(); }
+
+  nsapi_error_t open(NetworkInterface *network) {
+    return network ? NSAPI_ERROR_OK : NSAPI_ERROR_PARAMETER;
+  }
+  nsapi_error_t set_root_ca_cert(const char *cert) {
+    return cert ? NSAPI_ERROR_OK : NSAPI_ERROR_PARAMETER;
+  }
+  void set_hostname(const char *host) { _host = host; }
+  void set_timeout(int timeout_ms) { _timeout_ms = timeout_ms; }
+
+  nsapi_error_t connect(const SocketAddress &address);
+  nsapi_size_or_error_t send(const void *data, size_t size);
+
+  /**
+   * @return bytes read, 0 once the server has closed the connection, or
+   * NSAPI_ERROR_WOULD_BLOCK after the timeout with nothing to read
+   */
+  nsapi_size_or_error_t recv(void *data, size_t size);
+
+  nsapi_error_t close();
+
+private:
+  host::Server *_server = nullptr;
+  std::string _host;
+  int _timeout_ms = -1;
+  std::string _in;  // request bytes not yet answered
+  std::string _out; // response bytes not yet read
+  bool _waiting = false;     // the round trip of a request is not yet paid
+  bool _closing = false;     // the server closes once _out is read
+  int _requests = 0;
+  int64_t _last_active = 0;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file UDPSocket.h
+ * @brief Host stand-in for UDPSocket, exchanging datagrams with the
+ * in-process UDP servers registered under a hostname. Each way costs its
+ * delay and jitter on the simulated clock.
+ */
+#ifndef __HOST_UDP_SOCKET_H__
+#define __HOST_UDP_SOCKET_H__
+
+#include "NetworkInterface.h"
+
+#include <deque>
+#include <random>
+#include <string>
+
+namespace host {
+
+class UdpServer {
+public:
+  virtual ~UdpServer() {}
+
+  /**
+   * @param packet one datagram as the client sent it
+   * @param arrival_us host::now_us() when it reached the server
+   * @return the answer, empty for none
+   */
+  virtual std::string answer(const std::string &packet,
+                             int64_t arrival_us) = 0;
+
+  std::chrono::microseconds to_server = 20ms; // one way
+  std::chrono::microseconds to_client = 20ms;
+  std::chrono::microseconds jitter = 0us; // most added to each way at random
+  std::chrono::microseconds processing = 0us; // arrival to answer
+  std::minstd_rand random;
+
+  uint32_t packets = 0; // received
+};
+
+/**
+ * @brief make host resolve to an address of its own, where server answers
+ * datagrams. nullptr takes it away.
+ */
+void serve_udp(const char *host, UdpServer *server);
+
+UdpServer *udp_server(const SocketAddress &address);
+
+} // namespace host
+
+class UDPSocket {
+public:
+  UDPSocket() {}
+  ~UDPSocket() { close(); }
+
+  nsapi_error_t open(NetworkInterface *network) {
+    return network ? NSAPI_ERROR_OK : NSAPI_ERROR_PARAMETER;
+  }
+  void set_timeout(int timeout_ms) { _timeout_ms = timeout_ms; }
+
+  nsapi_size_or_error_t sendto(const SocketAddress &address,
+                               const void *data, nsapi_size_t size);
+
+  /**
+   * @return size of the next datagram to arrive, or NSAPI_ERROR_WOULD_BLOCK
+   * when none arrives before the timeout
+   */
+  nsapi_size_or_error_t recvfrom(SocketAddress *address, void *data,
+                                 nsapi_size_t size);
+
+  nsapi_error_t close() {
+    _in.clear();
+    return NSAPI_ERROR_OK;
+  }
+
+private:
+  struct Datagram {
+    int64_t arrival_us;
+    SocketAddress from;
+    std::string data;
+  };
+
+  int _timeout_ms = -1;
+  std::deque<Datagram> _in; // on their way here, by arrival
+};
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file check.h
+ * @brief Minimal assertions for the host tests, a failed CHECK is reported
+ * and counted and the test carries on
+ */
+#ifndef __HOST_CHECK_H__
+#define __HOST_CHECK_H__
+
+#include <chrono>
+#include <stdio.h>
+
+static int check_failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);     \
+      check_failures++;                                                        \
+    }                                                                          \
+  } while (0)
+
+/**
+ * @return exit code for main()
+ */
+static inline int check_result() {
+  if (check_failures) {
+    printf("FAILED, %d checks\n", check_failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
+
+/**
+ * @return wall time of one run of f in nanoseconds, averaged over runs
+ */
+template <typename F> static double bench_ns(int runs, F f) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    f();
+  }
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         runs;
+}
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * @file fixture.h
+ * @brief Reads the recorded responses in tests/fixtures
+ */
+#ifndef __HOST_FIXTURE_H__
+#define __HOST_FIXTURE_H__
+
+#include <stdio.h>
+#include <string>
+
+/**
+ * @return the whole file, empty when it cannot be read
+ */
+static inline std::string read_fixture(const char *name) {
+  std::string path = std::string(FIXTURE_DIR) + "/" + name;
+  std::string data;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    printf("cannot open %s\n", path.c_str());
+    return data;
+  }
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.append(buffer, n);
+  }
+  fclose(file);
+  return data;
+}
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file host_server.cpp
+ * @brief In-process servers, and the NetworkInterface, TLSSocket and
+ * UDPSocket stand-ins that reach them, see host_server.h and UDPSocket.h
+ */
+#include "host_server.h"
+#include "NetworkInterface.h"
+#include "TLSSocket.h"
+#include "UDPSocket.h"
+
+#include <map>
+#include <strings.h>
+
+static std::map<std::string, host::Server *> &servers() {
+  static std::map<std::string, host::Server *> all;
+  return all;
+}
+
+struct UdpHost {
+  std::string address;
+  host::UdpServer *server;
+};
+
+static std::map<std::string, UdpHost> &udp_servers() {
+  static std::map<std::string, UdpHost> all;
+  return all;
+}
+
+namespace host {
+void serve(const char *host, Server *server) {
+  if (server) {
+    servers()[host] = server;
+  } else {
+    servers().erase(host);
+  }
+}
+
+Server *server(const char *host) {
+  std::map<std::string, Server *>::iterator it = servers().find(host);
+  return it == servers().end() ? nullptr : it->second;
+}
+
+void serve_udp(const char *host, UdpServer *server) {
+  if (server) {
+    char address[16];
+    snprintf(address, sizeof(address), "192.0.2.%zu",
+             10 + udp_servers().size());
+    udp_servers()[host] = {address, server};
+  } else {
+    udp_servers().erase(host);
+  }
+}
+
+UdpServer *udp_server(const SocketAddress &address) {
+  const char *ip = address.get_ip_address();
+  for (const auto &entry : udp_servers()) {
+    if (ip && entry.second.address == ip) {
+      return entry.second.server;
+    }
+  }
+  return nullptr;
+}
+
+std::string Server::response(int status, const std::string &headers,
+                             const std::string &body) {
+  char line[96];
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nContent-Length: %zu\r\n",
+           status, status < 300 ? "OK" : "Status", body.size());
+  return line + headers + "\r\n" + body;
+}
+
+std::string Server::header(const std::string &request, const char *name) {
+  size_t name_length = strlen(name);
+  size_t pos = request.find("\r\n");
+  while (pos != std::string::npos && pos + 2 < request.size()) {
+    size_t start = pos + 2;
+    pos = request.find("\r\n", start);
+    if (request.compare(start, name_length, name) == 0 &&
+        request.compare(start + name_length, 2, ": ") == 0) {
+      size_t value = start + name_length + 2;
+      return request.substr(value, pos - value);
+    }
+  }
+  return "";
+}
+} // namespace host
+
+nsapi_error_t NetworkInterface::gethostbyname(const char *host,
+                                              SocketAddress *address,
+                                              nsapi_version_t version,
+                                              const char *interface_name) {
+  (void)version;
+  (void)interface_name;
+  lookups++;
+  host::skip(dns_delay);
+  std::map<std::string, UdpHost>::iterator udp = udp_servers().find(host);
+  if (udp != udp_servers().end()) {
+    address->set_ip_address(udp->second.address.c_str());
+    return NSAPI_ERROR_OK;
+  }
+  if (!host::server(host)) {
+    return NSAPI_ERROR_DNS_FAILURE;
+  }
+  address->set_ip_address("192.0.2.1");
+  return NSAPI_ERROR_OK;
+}
+
+nsapi_value_or_error_t
+NetworkInterface::gethostbyname_async(const char *host,
+                                      hostbyname_cb_t callback,
+                                      nsapi_version_t version,
+                                      const char *interface_name) {
+  SocketAddress address;
+  nsapi_error_t result =
+      gethostbyname(host, &address, version, interface_name);
+  callback(result == NSAPI_ERROR_OK ? 1 : result,
+           result == NSAPI_ERROR_OK ? &address : nullptr);
+  return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t TLSSocket::connect(const SocketAddress &address) {
+  if (!address) {
+    return NSAPI_ERROR_NO_ADDRESS;
+  }
+  _server = host::server(_host.c_str());
+  if (!_server) {
+    return NSAPI_ERROR_NO_CONNECTION;
+  }
+  host::skip(_server->handshake_time);
+  _server->handshakes++;
+  _last_active = host::now_us();
+  return NSAPI_ERROR_OK;
+}
+
+nsapi_size_or_error_t TLSSocket::send(const void *data, size_t size) {
+  if (!_server) {
+    return NSAPI_ERROR_NO_SOCKET;
+  }
+  if (host::now_us() - _last_active > _server->idle_timeout.count()) {
+    // Closed on the server side, the write still goes out
+    _closing = true;
+  }
+  if (_closing) {
+    return size;
+  }
+
+  _in.append((const char *)data, size);
+  size_t end;
+  while ((end = _in.find("\r\n\r\n")) != std::string::npos) {
+    std::string request = _in.substr(0, end + 4);
+    _in.erase(0, end + 4);
+    _server->requests++;
+    _server->last_request = request;
+    std::string response = _server->respond(request);
+    _out += response;
+    _waiting = true;
+    if (++_requests >= _server->max_requests ||
+        strcasestr(response.substr(0, response.find("\r\n\r\n")).c_str(),
+                   "Connection: close")) {
+      _closing = true;
+      break;
+    }
+  }
+  return size;
+}
+
+nsapi_size_or_error_t TLSSocket::recv(void *data, size_t size) {
+  if (!_server) {
+    return NSAPI_ERROR_NO_SOCKET;
+  }
+  if (_waiting) {
+    host::skip(_server->round_trip);
+    _waiting = false;
+  }
+  if (_out.empty()) {
+    if (_closing) {
+      return 0;
+    }
+    if (_timeout_ms > 0) {
+      host::skip(std::chrono::milliseconds(_timeout_ms));
+    }
+    return NSAPI_ERROR_WOULD_BLOCK;
+  }
+
+  size_t n = size < _server->recv_chunk ? size : _server->recv_chunk;
+  n = n < _out.size() ? n : _out.size();
+  if (_server->bytes_per_second) {
+    host::skip(std::chrono::microseconds((int64_t)n * 1000000 /
+                                         _server->bytes_per_second));
+  }
+  memcpy(data, _out.data(), n);
+  _out.erase(0, n);
+  _server->bytes_sent += n;
+  _last_active = host::now_us();
+  return n;
+}
+
+nsapi_error_t TLSSocket::close() {
+  _server = nullptr;
+  _in.clear();
+  _out.clear();
+  _waiting = _closing = false;
+  _requests = 0;
+  return NSAPI_ERROR_OK;
+}
+
+// Picks how long a datagram takes one way
+static int64_t transit_us(host::UdpServer *server,
+                          std::chrono::microseconds delay) {
+  int64_t jitter = std::uniform_int_distribution<int64_t>(
+      0, server->jitter.count())(server->random);
+  return delay.count() + jitter;
+}
+
+nsapi_size_or_error_t UDPSocket::sendto(const SocketAddress &address,
+                                        const void *data, nsapi_size_t size) {
+  if (!address) {
+    return NSAPI_ERROR_NO_ADDRESS;
+  }
+  host::UdpServer *server = host::udp_server(address);
+  if (!server) {
+    // Nobody listens, the datagram is lost
+    return size;
+  }
+  int64_t arrival = host::now_us() + transit_us(server, server->to_server);
+  server->packets++;
+  std::string answer =
+      server->answer(std::string((const char *)data, size), arrival);
+  if (answer.empty()) {
+    return size;
+  }
+
+  Datagram datagram = {arrival + server->processing.count() +
+                           transit_us(server, server->to_client),
+                       address, answer};
+  std::deque<Datagram>::iterator it = _in.begin();
+  while (it != _in.end() && it->arrival_us <= datagram.arrival_us) {
+    ++it;
+  }
+  _in.insert(it, datagram);
+  return size;
+}
+
+nsapi_size_or_error_t UDPSocket::recvfrom(SocketAddress *address, void *data,
+                                          nsapi_size_t size) {
+  int64_t deadline = host::now_us() + (int64_t)_timeout_ms * 1000;
+  if (_in.empty() || (_timeout_ms >= 0 && _in.front().arrival_us > deadline)) {
+    if (_timeout_ms > 0) {
+      host::skip(std::chrono::milliseconds(_timeout_ms));
+    }
+    return NSAPI_ERROR_WOULD_BLOCK;
+  }
+
+  Datagram datagram = _in.front();
+  _in.pop_front();
+  host::run_until(datagram.arrival_us);
+  if (address) {
+    *address = datagram.from;
+  }
+  // The rest of a datagram that does not fit is lost, as with a real socket
+  size_t n = size < datagram.data.size() ? size : datagram.data.size();
+  memcpy(data, datagram.data.data(), n);
+  return n;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file host_server.h
+ * @brief In-process HTTP servers for the host tests. TLSSocket connects to
+ * the server registered under its hostname, and each exchange costs
+ * simulated time on host::now_us(), so the handshakes, round trips and
+ * bytes of a fetch show up in Timer readings the same way they do on the
+ * board.
+ */
+#ifndef __HOST_SERVER_H__
+#define __HOST_SERVER_H__
+
+#include "mbed.h"
+
+#include <string>
+
+namespace host {
+
+class Server {
+public:
+  virtual ~Server() {}
+
+  /**
+   * @param request one complete request, headers up to the empty line
+   * @return the whole response, as it goes on the wire
+   */
+  virtual std::string respond(const std::string &request) = 0;
+
+  /**
+   * @return a response with Content-Length set from the body
+   */
+  static std::string response(int status, const std::string &headers,
+                              const std::string &body);
+
+  /**
+   * @return value of a request header, empty when it is not there
+   */
+  static std::string header(const std::string &request, const char *name);
+
+  std::chrono::microseconds handshake_time = 300ms; // TCP and TLS
+  std::chrono::microseconds round_trip = 50ms;      // request to first byte
+  uint32_t bytes_per_second = 0;                    // 0 is no limit
+  size_t recv_chunk = 1460;     // most one recv() returns
+  int max_requests = 100;       // per connection, then the server closes it
+  std::chrono::microseconds idle_timeout = 60s; // closes a quiet connection
+
+  // Counted as the clients use the server
+  uint32_t handshakes = 0;
+  uint32_t requests = 0;
+  uint64_t bytes_sent = 0;
+  std::string last_request;
+};
+
+/**
+ * @brief make host resolve and connect to server, nullptr takes it away
+ */
+void serve(const char *host, Server *server);
+
+Server *server(const char *host);
+
+} // namespace host
+
+#endif
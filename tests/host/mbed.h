@@ -0,0 +1,374 @@
+/**
+ * @file mbed.h
+ * @brief Host stand-in for the parts of Mbed OS the application modules use,
+ * so they build and run as ordinary programs on the development machine.
+ */
+#ifndef __HOST_MBED_H__
+#define __HOST_MBED_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+/*
+Kernel::Clock, Timer and Timeout all read one clock in microseconds. It
+follows the host's steady clock plus whatever host::skip() added, until
+host::simulate() freezes it. From then on only skip() and run_until() move
+it, and a test can play weeks of wall-clock time in milliseconds.
+
+Timeouts and queued events only run inside skip(), run_until() and
+ThisThread::sleep_for(), on the calling thread, in the order they fall due.
+*/
+namespace host {
+int64_t now_us();
+
+void simulate();
+bool simulated();
+
+/**
+ * @brief move the clock on, running what falls due on the way
+ */
+void skip(std::chrono::microseconds time);
+
+/**
+ * @brief move the clock to t (in now_us() terms), running what falls due
+ */
+void run_until(int64_t t);
+
+/*
+time() reads a stand-in for the RTC on the same clock. It counts whole
+seconds, starts a new one when set_time() sets it, and can be made to run
+fast or slow the way a 32 kHz crystal does.
+*/
+
+/**
+ * @brief make the RTC run ppm fast from now on, negative is slow
+ */
+void rtc_drift(double ppm);
+} // namespace host
+
+void set_time(time_t t);
+
+typedef int PinName;
+#define NC (-1)
+
+// Callback
+
+template <typename F> class Callback;
+
+template <typename R, typename... A> class Callback<R(A...)> {
+public:
+  Callback() {}
+  Callback(std::nullptr_t) {}
+  Callback(R (*f)(A...)) {
+    if (f) {
+      _f = f;
+    }
+  }
+  template <typename T, typename U>
+  Callback(U *obj, R (T::*method)(A...))
+      : _f([obj, method](A... a) { return (obj->*method)(a...); }) {}
+  template <typename T, typename U>
+  Callback(const U *obj, R (T::*method)(A...) const)
+      : _f([obj, method](A... a) { return (obj->*method)(a...); }) {}
+  template <typename T, typename U>
+  Callback(R (*f)(T *, A...), U *arg)
+      : _f([f, arg](A... a) { return f(arg, a...); }) {}
+  template <typename F,
+            typename = typename std::enable_if<
+                !std::is_pointer<F>::value &&
+                !std::is_same<typename std::decay<F>::type,
+                              Callback>::value>::type>
+  Callback(F f) : _f(f) {}
+
+  R call(A... a) const { return _f(a...); }
+  R operator()(A... a) const { return _f(a...); }
+  explicit operator bool() const { return (bool)_f; }
+
+private:
+  std::function<R(A...)> _f;
+};
+
+template <typename R, typename... A> Callback<R(A...)> callback(R (*f)(A...)) {
+  return Callback<R(A...)>(f);
+}
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *obj, R (T::*method)(A...)) {
+  return Callback<R(A...)>(obj, method);
+}
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(R (*f)(T *, A...), U *arg) {
+  return Callback<R(A...)>(f, arg);
+}
+
+// Time
+
+namespace Kernel {
+struct Clock {
+  typedef std::chrono::milliseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<Clock> time_point;
+  static const bool is_steady = true;
+
+  static time_point now() {
+    return time_point(duration(host::now_us() / 1000));
+  }
+};
+} // namespace Kernel
+
+class Timer {
+public:
+  Timer() : _start(0), _total(0), _running(false) {}
+
+  void start() {
+    if (!_running) {
+      _start = host::now_us();
+      _running = true;
+    }
+  }
+
+  void stop() {
+    if (_running) {
+      _total += host::now_us() - _start;
+      _running = false;
+    }
+  }
+
+  void reset() {
+    _total = 0;
+    _start = host::now_us();
+  }
+
+  std::chrono::microseconds elapsed_time() const {
+    return std::chrono::microseconds(
+        _total + (_running ? host::now_us() - _start : 0));
+  }
+
+private:
+  int64_t _start;
+  int64_t _total;
+  bool _running;
+};
+
+class Timeout {
+public:
+  Timeout();
+  ~Timeout();
+
+  void attach(Callback<void()> func, std::chrono::microseconds t);
+  void detach();
+
+  /**
+   * @return when it goes off in now_us() terms, -1 when not attached
+   */
+  int64_t due() const { return _due; }
+
+  // For host::run_until()
+  static Timeout *next_due();
+  void fire();
+
+private:
+  Callback<void()> _func;
+  int64_t _due;
+};
+
+// RTOS
+
+class Mutex {
+public:
+  void lock() { _mutex.lock(); }
+  bool trylock() { return _mutex.try_lock(); }
+  void unlock() { _mutex.unlock(); }
+
+private:
+  friend class ConditionVariable;
+  std::recursive_mutex _mutex;
+};
+
+// An enum class as in Mbed OS 6, so it cannot be taken for a bool
+namespace rtos {
+enum class cv_status { no_timeout, timeout };
+} // namespace rtos
+using rtos::cv_status;
+
+class ConditionVariable {
+public:
+  explicit ConditionVariable(Mutex &mutex) : _mutex(mutex) {}
+
+  void wait() { _cv.wait(_mutex._mutex); }
+
+  /**
+   * @return cv_status::timeout when the deadline passed first
+   */
+  cv_status wait_until(Kernel::Clock::time_point deadline) {
+    return wait_for(deadline - Kernel::Clock::now());
+  }
+
+  cv_status wait_for(Kernel::Clock::duration time) {
+    if (time <= time.zero() ||
+        _cv.wait_for(_mutex._mutex, time) == std::cv_status::timeout) {
+      return cv_status::timeout;
+    }
+    return cv_status::no_timeout;
+  }
+
+  void notify_one() { _cv.notify_one(); }
+  void notify_all() { _cv.notify_all(); }
+
+private:
+  Mutex &_mutex;
+  std::condition_variable_any _cv;
+};
+
+namespace ThisThread {
+void sleep_for(Kernel::Clock::duration time);
+} // namespace ThisThread
+
+// Events
+
+#define EVENTS_EVENT_SIZE 64
+#define EVENTS_QUEUE_SIZE (32 * EVENTS_EVENT_SIZE)
+
+/**
+ * Holds size / EVENTS_EVENT_SIZE events, call() returns 0 when it is full,
+ * as the real one does when its buffer runs out.
+ */
+class EventQueue {
+public:
+  explicit EventQueue(unsigned size = EVENTS_QUEUE_SIZE);
+  ~EventQueue();
+
+  template <typename F, typename... A> int call(F f, A... a) {
+    return post(0, 0, bind(f, a...));
+  }
+
+  template <typename F, typename... A>
+  int call_in(Kernel::Clock::duration delay, F f, A... a) {
+    return post(delay.count(), 0, bind(f, a...));
+  }
+
+  template <typename F, typename... A>
+  int call_every(Kernel::Clock::duration period, F f, A... a) {
+    return post(period.count(), period.count(), bind(f, a...));
+  }
+
+  bool cancel(int id);
+
+  /**
+   * @brief run the events that are due, outside host::run_until()
+   */
+  void dispatch_once();
+
+  size_t pending() const { return _events.size(); }
+
+  // For host::run_until()
+  static EventQueue *next_due(int64_t *due);
+  void run_next();
+
+private:
+  struct Event {
+    int id;
+    int64_t due;
+    int64_t period_us;
+    uint64_t order;
+    Callback<void()> func;
+  };
+
+  template <typename F, typename... A>
+  static Callback<void()> bind(F f, A... a) {
+    return Callback<void()>([f, a...]() { f(a...); });
+  }
+  template <typename F> static Callback<void()> bind(F f) {
+    return Callback<void()>(f);
+  }
+
+  int post(int64_t delay_ms, int64_t period_ms, Callback<void()> func);
+  size_t earliest() const;
+
+  std::vector<Event> _events;
+  size_t _capacity;
+  int _next_id;
+  uint64_t _order;
+  std::recursive_mutex _mutex;
+};
+
+// Peripherals
+
+class PwmOut {
+public:
+  struct Change {
+    int64_t us; // host::now_us() of the write
+    int period_us;
+    int pulsewidth_us;
+  };
+
+  explicit PwmOut(PinName pin) : _period_us(20000), _pulsewidth_us(0) {
+    (void)pin;
+  }
+
+  void period_us(int us) {
+    _period_us = us;
+    log.push_back({host::now_us(), _period_us, _pulsewidth_us});
+  }
+
+  void pulsewidth_us(int us) {
+    _pulsewidth_us = us;
+    log.push_back({host::now_us(), _period_us, _pulsewidth_us});
+  }
+
+  // Every write, for the test to check
+  std::vector<Change> log;
+
+private:
+  int _period_us;
+  int _pulsewidth_us;
+};
+
+class DigitalOut {
+public:
+  explicit DigitalOut(PinName pin, int value = 0) : _value(value) {
+    (void)pin;
+  }
+  DigitalOut &operator=(int value) {
+    _value = value;
+    return *this;
+  }
+  operator int() const { return _value; }
+
+private:
+  int _value;
+};
+
+class InterruptIn {
+public:
+  explicit InterruptIn(PinName pin) { (void)pin; }
+
+  void rise(Callback<void()> func) { _rise = func; }
+  void fall(Callback<void()> func) { _fall = func; }
+
+  // Tests raise the edges by hand
+  void raise() {
+    if (_rise) {
+      _rise();
+    }
+  }
+
+private:
+  Callback<void()> _rise, _fall;
+};
+
+#define MBED_SUCCESS 0
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * @file mbed_host.cpp
+ * @brief Clock, RTC, Timeout, EventQueue and ThisThread of the host
+ * stand-in, see mbed.h
+ */
+#include "mbed.h"
+
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <thread>
+
+static std::atomic<int64_t> skipped_us(0);
+static std::atomic<bool> frozen(false);
+static std::atomic<int64_t> frozen_us(0);
+
+// The RTC read rtc_anchor_us at now_us() rtc_anchor, and runs at rtc_rate
+static double rtc_anchor_us = 0;
+static int64_t rtc_anchor = 0;
+static double rtc_rate = 1;
+
+static double rtc_us() {
+  return rtc_anchor_us + (host::now_us() - rtc_anchor) * rtc_rate;
+}
+
+static std::vector<Timeout *> &timeouts() {
+  static std::vector<Timeout *> all;
+  return all;
+}
+
+static std::vector<EventQueue *> &queues() {
+  static std::vector<EventQueue *> all;
+  return all;
+}
+
+static int64_t steady_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+namespace host {
+int64_t now_us() {
+  return frozen ? frozen_us.load() : steady_us() + skipped_us.load();
+}
+
+void simulate() {
+  frozen_us = now_us();
+  frozen = true;
+}
+
+bool simulated() { return frozen; }
+
+void rtc_drift(double ppm) {
+  rtc_anchor_us = rtc_us();
+  rtc_anchor = now_us();
+  rtc_rate = 1 + ppm * 1e-6;
+}
+
+void skip(std::chrono::microseconds time) {
+  run_until(now_us() + time.count());
+}
+
+void run_until(int64_t t) {
+  while (true) {
+    Timeout *timeout = Timeout::next_due();
+    int64_t queue_due = 0;
+    EventQueue *queue = EventQueue::next_due(&queue_due);
+
+    int64_t due = t;
+    if (timeout && timeout->due() <= due) {
+      due = timeout->due();
+    }
+    if (queue && queue_due < due) {
+      due = queue_due;
+    }
+    bool timeout_first = timeout && timeout->due() == due &&
+                         (!queue || queue_due >= due);
+    if (!timeout_first && !(queue && queue_due <= due)) {
+      break;
+    }
+
+    if (due > now_us()) {
+      if (frozen) {
+        frozen_us = due;
+      } else {
+        skipped_us += due - now_us();
+      }
+    }
+    if (timeout_first) {
+      timeout->fire();
+    } else {
+      queue->run_next();
+    }
+  }
+  if (t > now_us()) {
+    if (frozen) {
+      frozen_us = t;
+    } else {
+      skipped_us += t - now_us();
+    }
+  }
+}
+} // namespace host
+
+void set_time(time_t t) {
+  rtc_anchor_us = t * 1e6;
+  rtc_anchor = host::now_us();
+}
+
+// In place of the C library's, as the RTC is behind time() on the board
+extern "C" time_t time(time_t *t) {
+  time_t now = (time_t)floor(rtc_us() / 1e6);
+  if (t) {
+    *t = now;
+  }
+  return now;
+}
+
+Timeout::Timeout() : _due(-1) { timeouts().push_back(this); }
+
+Timeout::~Timeout() {
+  std::vector<Timeout *> &all = timeouts();
+  all.erase(std::remove(all.begin(), all.end(), this), all.end());
+}
+
+void Timeout::attach(Callback<void()> func, std::chrono::microseconds t) {
+  _func = func;
+  _due = host::now_us() + t.count();
+}
+
+void Timeout::detach() { _due = -1; }
+
+Timeout *Timeout::next_due() {
+  Timeout *next = nullptr;
+  for (Timeout *timeout : timeouts()) {
+    if (timeout->_due >= 0 && (!next || timeout->_due < next->_due)) {
+      next = timeout;
+    }
+  }
+  return next;
+}
+
+void Timeout::fire() {
+  // Detached first, the callback may attach it again
+  _due = -1;
+  _func();
+}
+
+void ThisThread::sleep_for(Kernel::Clock::duration time) {
+  if (host::simulated()) {
+    host::skip(time);
+  } else {
+    std::this_thread::sleep_for(time);
+  }
+}
+
+EventQueue::EventQueue(unsigned size)
+    : _capacity(size / EVENTS_EVENT_SIZE), _next_id(1), _order(0) {
+  queues().push_back(this);
+}
+
+EventQueue::~EventQueue() {
+  std::vector<EventQueue *> &all = queues();
+  all.erase(std::remove(all.begin(), all.end(), this), all.end());
+}
+
+int EventQueue::post(int64_t delay_ms, int64_t period_ms,
+                     Callback<void()> func) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  if (_events.size() >= _capacity) {
+    return 0;
+  }
+  int id = _next_id++;
+  _events.push_back(
+      {id, host::now_us() + delay_ms * 1000, period_ms * 1000, _order++, func});
+  return id;
+}
+
+bool EventQueue::cancel(int id) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  for (size_t i = 0; i < _events.size(); i++) {
+    if (_events[i].id == id) {
+      _events.erase(_events.begin() + i);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t EventQueue::earliest() const {
+  size_t next = 0;
+  for (size_t i = 1; i < _events.size(); i++) {
+    const Event &e = _events[i];
+    if (e.due < _events[next].due ||
+        (e.due == _events[next].due && e.order < _events[next].order)) {
+      next = i;
+    }
+  }
+  return next;
+}
+
+EventQueue *EventQueue::next_due(int64_t *due) {
+  EventQueue *next = nullptr;
+  for (EventQueue *queue : queues()) {
+    std::lock_guard<std::recursive_mutex> lock(queue->_mutex);
+    if (queue->_events.empty()) {
+      continue;
+    }
+    int64_t queue_due = queue->_events[queue->earliest()].due;
+    if (!next || queue_due < *due) {
+      next = queue;
+      *due = queue_due;
+    }
+  }
+  return next;
+}
+
+void EventQueue::run_next() {
+  Callback<void()> func;
+  {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if (_events.empty()) {
+      return;
+    }
+    size_t i = earliest();
+    Event &e = _events[i];
+    func = e.func;
+    if (e.period_us > 0) {
+      e.due += e.period_us;
+      e.order = _order++;
+    } else {
+      _events.erase(_events.begin() + i);
+    }
+  }
+  func();
+}
+
+void EventQueue::dispatch_once() {
+  int64_t now = host::now_us();
+  while (true) {
+    {
+      std::lock_guard<std::recursive_mutex> lock(_mutex);
+      if (_events.empty() || _events[earliest()].due > now) {
+        return;
+      }
+    }
+    run_next();
+  }
+}
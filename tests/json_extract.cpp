@@ -0,0 +1,75 @@
+/**
+ * @file json_extract.cpp
+ * @brief SAX field extraction, see json_extract.h
+ */
+#include "json_extract.h"
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+/*
+Forwards the nlohmann SAX events to a field sink.
+*/
+class JsonExtractor : public nlohmann::json_sax<json> {
+public:
+  explicit JsonExtractor(JsonFieldSink *sink) : _sink(sink) {}
+
+  bool null() override { return _sink->null(); }
+
+  bool boolean(bool val) override { return _sink->boolean(val); }
+
+  bool number_integer(number_integer_t val) override {
+    return _sink->number((double)val, val);
+  }
+
+  bool number_unsigned(number_unsigned_t val) override {
+    return _sink->number((double)val, (int64_t)val);
+  }
+
+  bool number_float(number_float_t val, const string_t &) override {
+    int64_t integer = val > -9.2e18 && val < 9.2e18 ? (int64_t)val : 0;
+    return _sink->number(val, integer);
+  }
+
+  bool string(string_t &val) override {
+    return _sink->string(val.data(), val.size());
+  }
+
+  bool binary(binary_t &) override { return _sink->null(); }
+
+  bool start_object(std::size_t) override {
+    return _sink->start_container(false);
+  }
+
+  bool key(string_t &val) override {
+    return _sink->key(val.data(), val.size());
+  }
+
+  bool end_object() override { return _sink->end_container(); }
+
+  bool start_array(std::size_t) override {
+    return _sink->start_container(true);
+  }
+
+  bool end_array() override { return _sink->end_container(); }
+
+  bool parse_error(std::size_t, const std::string &,
+                   const nlohmann::detail::exception &) override {
+    return false;
+  }
+
+private:
+  JsonFieldSink *_sink;
+};
+
+uint32_t json_extract(const char *data, size_t size, const JsonField *fields,
+                      size_t count, void *out) {
+  if (count == 0 || count > JSON_MAX_FIELDS) {
+    return 0;
+  }
+  JsonFieldSink sink(fields, count, out);
+  JsonExtractor extractor(&sink);
+  json::sax_parse(data, data + size, &extractor);
+  return sink.found();
+}
@@ -0,0 +1,30 @@
+/**
+ * @file json_extract.h
+ * @brief The fields of a whole JSON document through the nlohmann SAX
+ * interface, the way the firmware extracted them before the push parser.
+ * Kept for the host benchmark to compare against.
+ */
+#ifndef __JSON_EXTRACT_H__
+#define __JSON_EXTRACT_H__
+
+#include "json_fields.h"
+
+/**
+ * @brief parse a JSON document and store the listed fields into out.
+ * Fields that are missing or of an incompatible type are left untouched,
+ * fields seen before a syntax error are kept. Parsing stops as soon as every
+ * field has been found.
+ * @param fields at most JSON_MAX_FIELDS fields
+ * @return bit i set when fields[i] was stored
+ */
+uint32_t json_extract(const char *data, size_t size, const JsonField *fields,
+                      size_t count, void *out);
+
+template <size_t N, typename T>
+uint32_t json_extract(const char *data, size_t size,
+                      const JsonField (&fields)[N], T *out) {
+  static_assert(N <= JSON_MAX_FIELDS, "too many fields");
+  return json_extract(data, size, fields, N, out);
+}
+
+#endif
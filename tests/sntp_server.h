@@ -0,0 +1,92 @@
+/**
+ * @file sntp_server.h
+ * @brief Stand-in for an SNTP pool server in the host tests, answering with
+ * a reference clock that is host::now_us() from a fixed date on. Fields it
+ * gets wrong on purpose, and answers it drops or holds back, are set by the
+ * test.
+ */
+#ifndef __SNTP_SERVER_H__
+#define __SNTP_SERVER_H__
+
+#include "UDPSocket.h"
+
+#include <string.h>
+
+#define NTP_UNIX_OFFSET 2208988800ULL
+
+class SntpServer : public host::UdpServer {
+public:
+  // Monday 19 October 2026, 08:00:00.123456 UTC at the time it is made
+  SntpServer() : base_us(1792396800123456LL - host::now_us()) {}
+
+  /**
+   * @return reference time in us since 1970
+   */
+  int64_t reference_us() const { return base_us + host::now_us(); }
+
+  std::string answer(const std::string &packet, int64_t arrival_us) override {
+    to_client = late > 0 ? 1010ms : 20ms;
+    if (late > 0) {
+      late--;
+    }
+    if (drop > 0) {
+      drop--;
+      return "";
+    }
+    if (packet.size() < 48 || (packet[0] & 0x07) != 3) {
+      return "";
+    }
+    uint8_t reply[48] = {};
+    reply[0] = (leap << 6) | (4 << 3) | mode;
+    reply[1] = stratum;
+    memcpy(reply + 24, packet.data() + 40, 8);
+    write_ntp(reply + 32, base_us + arrival_us);
+    if (!zero_transmit) {
+      write_ntp(reply + 40, base_us + arrival_us + processing.count());
+    }
+    return std::string((const char *)reply, sizeof(reply));
+  }
+
+  int64_t base_us; // reference minus host::now_us()
+  uint8_t leap = 0;
+  uint8_t mode = 4;
+  uint8_t stratum = 2;
+  bool zero_transmit = false;
+  int drop = 0; // answers not sent
+  int late = 0; // answers that come after the client's timeout
+
+private:
+  static void write_ntp(uint8_t *p, int64_t unix_us) {
+    uint32_t seconds = (uint32_t)(unix_us / 1000000 + NTP_UNIX_OFFSET);
+    uint32_t fraction =
+        (uint32_t)(((uint64_t)(unix_us % 1000000) << 32) / 1000000);
+    for (int i = 0; i < 4; i++) {
+      p[i] = seconds >> (24 - 8 * i);
+      p[4 + i] = fraction >> (24 - 8 * i);
+    }
+  }
+};
+
+/**
+ * @return how far the RTC is behind the server's reference, measured as its
+ * next second begins
+ */
+static inline double rtc_behind_ms(const SntpServer &server) {
+  time_t start = time(NULL);
+  while (time(NULL) == start) {
+    host::skip(100us);
+  }
+  return (server.reference_us() - (int64_t)time(NULL) * 1000000) / 1000.0;
+}
+
+/**
+ * @brief set the RTC off_ms behind the reference, as a second of the RTC
+ * begins
+ */
+static inline void set_rtc_off(const SntpServer &server, int64_t off_ms) {
+  int64_t rtc_us = server.reference_us() - off_ms * 1000;
+  host::skip(std::chrono::microseconds(999999 - (rtc_us + 999999) % 1000000));
+  set_time((server.reference_us() - off_ms * 1000) / 1000000);
+}
+
+#endif
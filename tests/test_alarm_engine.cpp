@@ -0,0 +1,198 @@
+/**
+ * @file test_alarm_engine.cpp
+ * @brief AlarmEngine over four simulated weeks on an RTC that drifts from
+ * the microsecond ticker, against a day by day enumeration of when each
+ * alarm should go off; clock jumps, snooze, a full queue, and the wakeups
+ * compared with the 500 ms polling loop it replaced.
+ */
+#include "alarm_engine.h"
+#include "check.h"
+
+#include <vector>
+
+#define SECONDS_PER_DAY 86400
+
+// Monday 19 October 2026 00:00 UTC
+static const time_t start = 1792368000;
+static double rtc_ppm = 0;
+static time_t rtc_offset = 0; // clock jumps
+
+// The RTC, running rtc_ppm fast against the ticker the Timeouts use
+static time_t rtc() {
+  return start + rtc_offset + (time_t)(host::now_us() * (1 + rtc_ppm * 1e-6) /
+                                       1000000);
+}
+
+struct Fired {
+  int id;
+  time_t at;
+};
+
+static std::vector<Fired> fired;
+
+static void on_fired(int id) { fired.push_back({id, rtc()}); }
+
+struct Setting {
+  uint8_t hour, minute, weekdays;
+};
+
+// Every fire time of an alarm in [from, to), one day at a time
+static std::vector<time_t> expected(const Setting &s, time_t from, time_t to) {
+  std::vector<time_t> times;
+  for (time_t day = from / SECONDS_PER_DAY * SECONDS_PER_DAY; day < to;
+       day += SECONDS_PER_DAY) {
+    time_t t = day + s.hour * 3600 + s.minute * 60;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    if (t > from && t < to &&
+        (s.weekdays == ALARM_ONCE || (s.weekdays & (1 << tm.tm_wday)))) {
+      times.push_back(t);
+      if (s.weekdays == ALARM_ONCE) {
+        break;
+      }
+    }
+  }
+  return times;
+}
+
+static void test_weeks(double ppm) {
+  rtc_ppm = ppm;
+  fired.clear();
+  host::skip(1s);
+  EventQueue queue;
+  AlarmEngine alarms(&queue, callback(on_fired), callback(rtc));
+  const Setting settings[] = {
+      {6, 30, ALARM_WORKDAYS}, {9, 0, ALARM_WEEKEND}, {12, 15, ALARM_ONCE},
+      {23, 59, ALARM_EVERY_DAY}, {0, 0, ALARM_WEDNESDAY | ALARM_SUNDAY},
+  };
+  const int count = sizeof(settings) / sizeof(settings[0]);
+  for (const Setting &s : settings) {
+    alarms.add(s.hour, s.minute, s.weekdays);
+  }
+
+  // Nothing goes off before the clock is known
+  host::skip(2h);
+  CHECK(fired.empty() && alarms.stats().wakeups == 0);
+  time_t from = rtc();
+  alarms.clock_set();
+  host::skip(28 * 24h);
+  time_t to = rtc();
+
+  int differ = 0, late = 0;
+  size_t total = 0;
+  for (int id = 0; id < count; id++) {
+    std::vector<time_t> want = expected(settings[id], from, to);
+    std::vector<time_t> got;
+    for (const Fired &f : fired) {
+      if (f.id == id) {
+        got.push_back(f.at);
+      }
+    }
+    if (got.size() != want.size()) {
+      differ++;
+      continue;
+    }
+    for (size_t i = 0; i < got.size(); i++) {
+      // Fired in the right second, or within the next two
+      if (got[i] < want[i] || got[i] > want[i] + 2) {
+        late++;
+      }
+    }
+    total += want.size();
+  }
+  CHECK(differ == 0 && late == 0);
+  CHECK(fired.size() == total);
+  AlarmStats stats = alarms.stats();
+  // A wakeup per hour of waiting and a few per alarm, where the 500 ms loop
+  // woke up twice a second
+  CHECK(stats.wakeups < 28 * 24 + 3 * total);
+  CHECK(stats.retries == 0 && stats.late == 0 && stats.max_late_ms == 0);
+  printf("%+.0f ppm RTC, 4 weeks: %zu alarms, %u wakeups, 500 ms polling "
+         "woke %u times\n",
+         ppm, total, stats.wakeups, 28 * SECONDS_PER_DAY * 2);
+}
+
+static void test_changes() {
+  rtc_ppm = 0;
+  fired.clear();
+  EventQueue queue;
+  AlarmEngine alarms(&queue, callback(on_fired), callback(rtc));
+  alarms.clock_set();
+  time_t now = rtc();
+  time_t midnight = now / SECONDS_PER_DAY * SECONDS_PER_DAY;
+  int daily = alarms.add(7, 0, ALARM_EVERY_DAY);
+  CHECK(alarms.next_fire() ==
+        midnight + 7 * 3600 + (now % SECONDS_PER_DAY >= 7 * 3600
+                                   ? SECONDS_PER_DAY
+                                   : 0));
+
+  // A clock set three days ahead skips the occurrences in between
+  host::skip(1min);
+  rtc_offset += 3 * SECONDS_PER_DAY;
+  alarms.clock_set();
+  host::skip(1min);
+  CHECK(fired.empty());
+  host::skip(24h);
+  CHECK(fired.size() == 1 && fired[0].id == daily);
+
+  // Snoozed, it goes off again after the delay and then keeps its days
+  alarms.snooze(daily, 5min);
+  host::skip(4min);
+  CHECK(fired.size() == 1);
+  host::skip(2min);
+  CHECK(fired.size() == 2);
+  Alarm alarm;
+  alarms.get(daily, &alarm);
+  CHECK(alarm.enabled && alarm.weekdays == ALARM_EVERY_DAY);
+  CHECK((alarm.next - 7 * 3600) % SECONDS_PER_DAY == 0);
+
+  // Disabled, removed and invalid
+  alarms.enable(daily, false);
+  CHECK(alarms.next_fire() == 0);
+  host::skip(48h);
+  CHECK(fired.size() == 2);
+  CHECK(alarms.remove(daily) && !alarms.get(daily, &alarm));
+  CHECK(alarms.add(24, 0, ALARM_ONCE) == -1);
+  for (int i = 0; i < ALARM_MAX; i++) {
+    CHECK(alarms.add(8, i, ALARM_ONCE) >= 0);
+  }
+  CHECK(alarms.add(9, 0, ALARM_ONCE) == -1);
+}
+
+static void filler() {}
+
+// The wakeup finds the queue full, and the alarm still goes off once there
+// is room again
+static void test_queue_full() {
+  rtc_ppm = 0;
+  fired.clear();
+  EventQueue queue(EVENTS_EVENT_SIZE);
+  AlarmEngine alarms(&queue, callback(on_fired), callback(rtc));
+  alarms.clock_set();
+  int id = alarms.add(6, 30, ALARM_EVERY_DAY);
+  time_t due = alarms.next_fire();
+
+  int busy = queue.call_in(48h, filler);
+  CHECK(busy != 0);
+  host::skip(std::chrono::seconds(due - rtc()) + 1s);
+  CHECK(fired.empty());
+  CHECK(alarms.stats().retries >= 10);
+
+  queue.cancel(busy);
+  host::skip(ALARM_RETRY_WAIT);
+  CHECK(fired.size() == 1 && fired[0].id == id);
+  CHECK(fired[0].at <= due + 2);
+  // Counted late by the time it waited for room
+  CHECK(alarms.stats().late == 1 && alarms.stats().max_late_ms >= 1000);
+  CHECK(alarms.next_fire() == due + SECONDS_PER_DAY);
+}
+
+int main() {
+  host::simulate();
+  test_weeks(0);
+  test_weeks(100);
+  test_weeks(-100);
+  test_changes();
+  test_queue_full();
+  return check_result();
+}
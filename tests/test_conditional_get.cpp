@@ -0,0 +1,117 @@
+/**
+ * @file test_conditional_get.cpp
+ * @brief Conditional GETs of the feed against a server that answers 304
+ * while the validators match, and the bytes they save over a day of
+ * refreshes.
+ */
+#include "check.h"
+#include "feed_server.h"
+#include "fixture.h"
+#include "http_client.h"
+
+#include <string.h>
+
+static HttpBodyCallback collect(std::string *out) {
+  return HttpBodyCallback([out](const char *data, size_t size) {
+    out->append(data, size);
+    return true;
+  });
+}
+
+static int fetch(HttpClient *client, HttpValidators *validators,
+                 std::string *body) {
+  body->clear();
+  return client->get("feeds.bbci.co.uk", "/news/world/rss.xml", "cert",
+                     collect(body), validators);
+}
+
+static void test_validators(const std::string &doc) {
+  NetworkInterface network;
+  FeedServer server;
+  server.update(doc);
+  host::serve("feeds.bbci.co.uk", &server);
+  HttpClient client(&network);
+  HttpValidators validators = {};
+  std::string body;
+
+  CHECK(fetch(&client, &validators, &body) == 200);
+  CHECK(body == doc);
+  CHECK(strcmp(validators.etag, "\"feed-1\"") == 0);
+  CHECK(validators.last_modified[0] != '\0');
+  uint32_t full_bytes = client.stats().last_received;
+
+  CHECK(fetch(&client, &validators, &body) == 304);
+  CHECK(body.empty());
+  uint32_t not_modified_bytes = client.stats().last_received;
+  CHECK(not_modified_bytes < 300);
+  printf("full response %u bytes, 304 %u bytes\n", full_bytes,
+         not_modified_bytes);
+
+  // A changed document comes back whole, with its new validators
+  std::string changed = doc;
+  changed.replace(changed.find("<item>"), 6, "<item> ");
+  server.update(changed);
+  CHECK(fetch(&client, &validators, &body) == 200);
+  CHECK(body == changed);
+  CHECK(strcmp(validators.etag, "\"feed-2\"") == 0);
+
+  // Last-Modified alone is enough
+  server.send_etag = false;
+  server.update(doc);
+  memset(&validators, 0, sizeof(validators));
+  CHECK(fetch(&client, &validators, &body) == 200);
+  CHECK(validators.etag[0] == '\0');
+  CHECK(fetch(&client, &validators, &body) == 304);
+
+  // An ETag too long to keep is never sent back cut short
+  server.send_etag = true;
+  server.send_last_modified = false;
+  server.etag_padding = std::string(HTTP_VALIDATOR_SIZE, 'x');
+  memset(&validators, 0, sizeof(validators));
+  CHECK(fetch(&client, &validators, &body) == 200);
+  CHECK(validators.etag[0] == '\0');
+  CHECK(fetch(&client, &validators, &body) == 200);
+  CHECK(FeedServer::header(server.last_request, "If-None-Match").empty());
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+// A refresh every 5 minutes for a day, the feed changing every hour
+static void bench(const std::string &doc) {
+  uint64_t bytes[2];
+  uint32_t full[2];
+  for (int conditional = 0; conditional < 2; conditional++) {
+    NetworkInterface network;
+    FeedServer server;
+    server.update(doc);
+    host::serve("feeds.bbci.co.uk", &server);
+    HttpClient client(&network);
+    HttpValidators validators = {};
+    std::string body;
+
+    for (int i = 0; i < 24 * 12; i++) {
+      if (i % 12 == 0) {
+        server.update(doc);
+      }
+      int status =
+          fetch(&client, conditional ? &validators : nullptr, &body);
+      CHECK(status == 200 || (conditional && status == 304));
+    }
+    bytes[conditional] = server.bytes_sent;
+    full[conditional] = server.full;
+    host::serve("feeds.bbci.co.uk", nullptr);
+  }
+  CHECK(full[1] == 24);
+  printf("a day of refreshes: %llu KB in %u full responses unconditional, "
+         "%llu KB in %u conditional\n",
+         (unsigned long long)bytes[0] / 1024, full[0],
+         (unsigned long long)bytes[1] / 1024, full[1]);
+}
+
+int main() {
+  host::simulate();
+  std::string doc = read_fixture("bbc_world.xml");
+  CHECK(!doc.empty());
+  test_validators(doc);
+  bench(doc);
+  return check_result();
+}
@@ -0,0 +1,236 @@
+/**
+ * @file test_dns_cache.cpp
+ * @brief DnsCache in front of a stub resolver: hits, expiry, failures,
+ * eviction, prewarm answers arriving on another thread, and the lookups and
+ * time it saves a run of fetches.
+ */
+#include "check.h"
+#include "dns_cache.h"
+#include "host_server.h"
+#include "http_client.h"
+
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace std::chrono;
+
+/*
+Answers from a table after delay, counting the queries. Asynchronous
+queries are held until answer_async(), which the test calls from another
+thread the way the network stack's event thread answers on the board.
+*/
+class StubResolver : public NetworkInterface {
+public:
+  nsapi_error_t gethostbyname(const char *host, SocketAddress *address,
+                              nsapi_version_t, const char *) override {
+    queries++;
+    host::skip(delay);
+    std::map<std::string, nsapi_error_t>::iterator it = results.find(host);
+    nsapi_error_t result =
+        it == results.end() ? NSAPI_ERROR_DNS_FAILURE : it->second;
+    if (result == NSAPI_ERROR_OK) {
+      address->set_ip_address("192.0.2.7");
+    }
+    return result;
+  }
+
+  nsapi_value_or_error_t gethostbyname_async(const char *host,
+                                             hostbyname_cb_t callback,
+                                             nsapi_version_t,
+                                             const char *) override {
+    async_queries++;
+    pending.push_back({host, callback});
+    return (nsapi_value_or_error_t)pending.size();
+  }
+
+  void answer_async() {
+    for (const Pending &p : pending) {
+      std::map<std::string, nsapi_error_t>::iterator it = results.find(p.host);
+      SocketAddress address("192.0.2.8");
+      if (it != results.end() && it->second == NSAPI_ERROR_OK) {
+        p.callback(1, &address);
+      } else {
+        p.callback(NSAPI_ERROR_DNS_FAILURE, nullptr);
+      }
+    }
+    pending.clear();
+  }
+
+  struct Pending {
+    std::string host;
+    hostbyname_cb_t callback;
+  };
+
+  std::map<std::string, nsapi_error_t> results;
+  std::vector<Pending> pending;
+  microseconds delay = 0us;
+  uint32_t queries = 0;
+  uint32_t async_queries = 0;
+};
+
+static void test_expiry() {
+  StubResolver resolver;
+  resolver.results["api.weatherapi.com"] = NSAPI_ERROR_OK;
+  DnsCache cache(&resolver);
+  SocketAddress address;
+  microseconds ttl = DNS_CACHE_TTL;
+
+  for (int i = 0; i < 10; i++) {
+    CHECK(cache.gethostbyname("api.weatherapi.com", &address) ==
+          NSAPI_ERROR_OK);
+    CHECK(strcmp(address.get_ip_address(), "192.0.2.7") == 0);
+    host::skip(ttl / 20);
+  }
+  CHECK(resolver.queries == 1);
+  host::skip(ttl / 2);
+  CHECK(cache.gethostbyname("api.weatherapi.com", &address) ==
+        NSAPI_ERROR_OK);
+  CHECK(resolver.queries == 2);
+
+  // Failures are kept for the shorter negative TTL
+  CHECK(cache.gethostbyname("no.such.host", &address) ==
+        NSAPI_ERROR_DNS_FAILURE);
+  CHECK(cache.gethostbyname("no.such.host", &address) ==
+        NSAPI_ERROR_DNS_FAILURE);
+  CHECK(resolver.queries == 3);
+  host::skip(DNS_NEGATIVE_TTL + 1s);
+  cache.gethostbyname("no.such.host", &address);
+  CHECK(resolver.queries == 4);
+
+  // An error that says nothing about the name is not kept
+  resolver.results["feeds.bbci.co.uk"] = NSAPI_ERROR_NO_CONNECTION;
+  cache.gethostbyname("feeds.bbci.co.uk", &address);
+  resolver.results["feeds.bbci.co.uk"] = NSAPI_ERROR_OK;
+  CHECK(cache.gethostbyname("feeds.bbci.co.uk", &address) == NSAPI_ERROR_OK);
+  CHECK(resolver.queries == 6);
+
+  // forget() after a failed connect
+  cache.forget("feeds.bbci.co.uk");
+  cache.gethostbyname("feeds.bbci.co.uk", &address);
+  CHECK(resolver.queries == 7);
+
+  DnsCacheStats stats = cache.stats();
+  CHECK(stats.hits == 9 && stats.negative_hits == 1 && stats.misses == 7);
+}
+
+static void test_eviction() {
+  StubResolver resolver;
+  const char *hosts[] = {"a.example", "b.example", "c.example", "d.example",
+                         "e.example"};
+  for (const char *host : hosts) {
+    resolver.results[host] = NSAPI_ERROR_OK;
+  }
+  DnsCache cache(&resolver);
+  SocketAddress address;
+
+  // Fill the cache, use all but b again, then a fifth name takes b's entry
+  for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+    cache.gethostbyname(hosts[i], &address);
+    host::skip(1s);
+  }
+  cache.gethostbyname("a.example", &address);
+  cache.gethostbyname("c.example", &address);
+  cache.gethostbyname("d.example", &address);
+  cache.gethostbyname("e.example", &address);
+  CHECK(resolver.queries == 5);
+  cache.gethostbyname("a.example", &address);
+  cache.gethostbyname("c.example", &address);
+  CHECK(resolver.queries == 5);
+  cache.gethostbyname("b.example", &address);
+  CHECK(resolver.queries == 6);
+
+  // Names too long for an entry are looked up every time
+  std::string long_name(DNS_HOST_SIZE, 'x');
+  resolver.results[long_name] = NSAPI_ERROR_OK;
+  cache.gethostbyname(long_name.c_str(), &address);
+  cache.gethostbyname(long_name.c_str(), &address);
+  CHECK(resolver.queries == 8);
+}
+
+static void test_prewarm() {
+  StubResolver resolver;
+  resolver.results["api.ipgeolocation.io"] = NSAPI_ERROR_OK;
+  resolver.results["api.weatherapi.com"] = NSAPI_ERROR_OK;
+  resolver.results["feeds.bbci.co.uk"] = NSAPI_ERROR_OK;
+  DnsCache cache(&resolver);
+  const char *hosts[] = {"api.ipgeolocation.io", "api.weatherapi.com",
+                         "feeds.bbci.co.uk", "pool.ntp.invalid"};
+  cache.prewarm(hosts, 4);
+  CHECK(resolver.async_queries == 4);
+
+  // A lookup waits for the answer already on its way instead of asking again
+  std::thread stack([&resolver] {
+    std::this_thread::sleep_for(50ms);
+    resolver.answer_async();
+  });
+  SocketAddress address;
+  CHECK(cache.gethostbyname("api.weatherapi.com", &address) ==
+        NSAPI_ERROR_OK);
+  CHECK(strcmp(address.get_ip_address(), "192.0.2.8") == 0);
+  stack.join();
+
+  CHECK(cache.gethostbyname("feeds.bbci.co.uk", &address) == NSAPI_ERROR_OK);
+  CHECK(cache.gethostbyname("pool.ntp.invalid", &address) ==
+        NSAPI_ERROR_DNS_FAILURE);
+  CHECK(resolver.queries == 0);
+  DnsCacheStats stats = cache.stats();
+  CHECK(stats.prewarmed == 4 && stats.misses == 0);
+
+  // Fresh entries are not asked for again
+  cache.prewarm(hosts, 3);
+  CHECK(resolver.async_queries == 4);
+}
+
+// Serves an empty document
+class EmptyServer : public host::Server {
+public:
+  std::string respond(const std::string &) override {
+    return response(200, "Connection: close\r\n", "");
+  }
+};
+
+static void bench() {
+  StubResolver resolver;
+  resolver.delay = 120ms;
+  resolver.results["api.weatherapi.com"] = NSAPI_ERROR_OK;
+  EmptyServer server;
+  host::serve("api.weatherapi.com", &server);
+
+  // A fetch every 15 minutes for a day, on a new connection each time as
+  // the weather server closes them
+  const int fetches = 96;
+  uint32_t queries[2];
+  double ms[2];
+  for (int cached = 0; cached < 2; cached++) {
+    DnsCache cache(&resolver);
+    HttpClient client(&resolver, cached ? &cache : nullptr);
+    resolver.queries = 0;
+    Timer timer;
+    timer.start();
+    for (int i = 0; i < fetches; i++) {
+      CHECK(client.get("api.weatherapi.com", "/", "cert",
+                       HttpBodyCallback()) == 200);
+      timer.stop();
+      host::skip(15min);
+      timer.start();
+    }
+    queries[cached] = resolver.queries;
+    ms[cached] = duration<double, std::milli>(timer.elapsed_time()).count();
+  }
+  CHECK(queries[1] == 24);
+  printf("%d fetches, %lld ms per lookup: %u lookups and %.0f ms per fetch "
+         "without the cache, %u and %.0f ms with it\n",
+         fetches, (long long)duration_cast<milliseconds>(resolver.delay)
+                      .count(),
+         queries[0], ms[0] / fetches, queries[1], ms[1] / fetches);
+  host::serve("api.weatherapi.com", nullptr);
+}
+
+int main() {
+  test_expiry();
+  test_eviction();
+  test_prewarm();
+  bench();
+  return check_result();
+}
@@ -0,0 +1,167 @@
+/**
+ * @file test_double_buffer.cpp
+ * @brief DoubleBuffer with a writer and a reader thread publishing and
+ * reading as fast as they can, counting the copies that mix two values.
+ * The version-only check it had before runs the same way for comparison.
+ */
+#include "check.h"
+#include "double_buffer.h"
+
+#include <atomic>
+#include <random>
+#include <string.h>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+/*
+Every word holds the same number, a torn copy has two. Copies give up the
+CPU at a random point, so the threads also preempt each other in the
+middle of a copy on a single core, as they do on the board.
+*/
+struct Value {
+  uint32_t words[1024];
+
+  Value() {}
+  Value(const Value &) = delete;
+
+  Value &operator=(const Value &other) {
+    static thread_local std::minstd_rand rng(std::hash<std::thread::id>()(
+        std::this_thread::get_id()));
+    const size_t size = sizeof(words) / sizeof(words[0]);
+    size_t split = rng() % size;
+    memcpy(words, other.words, split * sizeof(words[0]));
+    std::this_thread::yield();
+    memcpy(words + split, other.words + split,
+           (size - split) * sizeof(words[0]));
+    return *this;
+  }
+
+  void fill(uint32_t n) {
+    for (uint32_t &w : words) {
+      w = n;
+    }
+  }
+
+  bool torn() const {
+    for (uint32_t w : words) {
+      if (w != words[0]) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+// The buffer as it was, accepting a copy unless the version moved by two
+template <typename T> class VersionOnlyBuffer {
+public:
+  VersionOnlyBuffer() : _version(0) {}
+
+  void publish(const T &value) {
+    uint32_t version = _version.load(std::memory_order_relaxed);
+    _slots[(version + 1) & 1] = value;
+    _version.store(version + 1, std::memory_order_release);
+  }
+
+  bool read(T *value, uint32_t *seen) const {
+    while (true) {
+      uint32_t version = _version.load(std::memory_order_acquire);
+      if (version == *seen) {
+        return false;
+      }
+      *value = _slots[version & 1];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (_version.load(std::memory_order_relaxed) - version < 2) {
+        *seen = version;
+        return true;
+      }
+    }
+  }
+
+private:
+  T _slots[2];
+  std::atomic<uint32_t> _version;
+};
+
+struct Stress {
+  uint64_t reads;
+  uint64_t torn;
+  uint64_t out_of_order;
+  uint32_t published;
+};
+
+/*
+Until the reader has had reads values, or timeout passed on a busy host.
+How many it gets in that time depends on the scheduler, so only that it
+got some is a check.
+*/
+template <typename Buffer>
+static Stress stress(uint64_t reads, std::chrono::milliseconds timeout) {
+  static Buffer buffer;
+  std::atomic<bool> stop(false);
+  Stress s = {0, 0, 0, 0};
+
+  std::thread writer([&] {
+    static Value value;
+    uint32_t n = 1;
+    while (!stop.load(std::memory_order_relaxed)) {
+      value.fill(n++);
+      buffer.publish(value);
+      // An uneven gap, so the reader sometimes copies across the start of
+      // the next publish and sometimes gets through without a retry
+      for (uint32_t i = 0; i < n % 3; i++) {
+        std::this_thread::yield();
+      }
+    }
+    s.published = n - 1;
+  });
+
+  std::thread reader([&] {
+    static Value value;
+    uint32_t seen = 0, last = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (!buffer.read(&value, &seen)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (++s.reads == reads) {
+        stop = true;
+      }
+      if (value.torn()) {
+        s.torn++;
+      } else if (value.words[0] < last) {
+        s.out_of_order++;
+      } else {
+        last = value.words[0];
+      }
+    }
+  });
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!stop && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(10ms);
+  }
+  stop = true;
+  writer.join();
+  reader.join();
+  return s;
+}
+
+int main() {
+  Stress now = stress<DoubleBuffer<Value>>(20000, 10s);
+  CHECK(now.reads > 0);
+  CHECK(now.torn == 0);
+  CHECK(now.out_of_order == 0);
+  printf("sequence count: %u published, %llu read, %llu torn, %llu older "
+         "than one read before\n",
+         now.published, (unsigned long long)now.reads,
+         (unsigned long long)now.torn, (unsigned long long)now.out_of_order);
+
+  // Depends on the scheduler, so only reported
+  Stress before = stress<VersionOnlyBuffer<Value>>(20000, 10s);
+  printf("version only:   %u published, %llu read, %llu torn\n",
+         before.published, (unsigned long long)before.reads,
+         (unsigned long long)before.torn);
+  return check_result();
+}
@@ -0,0 +1,147 @@
+/**
+ * @file test_drift_estimator.cpp
+ * @brief DriftEstimator fed made-up syncs of a clock with a known rate
+ * error, then three days of an RTC on the host that runs slow, synced with
+ * SntpClient every six hours: how far the clock is off between syncs with
+ * and without the correction.
+ */
+#include "check.h"
+#include "dns_cache.h"
+#include "drift_estimator.h"
+#include "sntp_client.h"
+#include "sntp_server.h"
+
+#include <math.h>
+#include <random>
+
+/*
+A sync every interval_s of a clock ppm slow, the drift measured with up to
+noise_ms either way. Returns the estimate after the last one.
+*/
+static float fit(DriftEstimator *drift, int syncs, int interval_s, double ppm,
+                 int noise_ms = 0, int64_t *elapsed_ms = nullptr) {
+  static std::minstd_rand random(23);
+  int64_t elapsed = elapsed_ms ? *elapsed_ms : 0;
+  for (int i = 0; i < syncs; i++) {
+    int64_t drift_ms = llround(elapsed * ppm * 1e-6);
+    if (noise_ms) {
+      drift_ms += (int64_t)(random() % (2 * noise_ms + 1)) - noise_ms;
+    }
+    drift->add(1792368000 + elapsed / 1000, elapsed, drift_ms, 0);
+    elapsed += (int64_t)interval_s * 1000;
+  }
+  if (elapsed_ms) {
+    *elapsed_ms = elapsed;
+  }
+  return drift->ppm();
+}
+
+static void test_fit() {
+  // Exact but for the whole ms the drift is measured in
+  for (double ppm : {-120.0, -37.5, 0.0, 12.25, 80.0}) {
+    DriftEstimator drift;
+    CHECK(fabs(fit(&drift, DRIFT_HISTORY, 3600, ppm) - ppm) < 0.05);
+  }
+
+  // Not before the syncs span DRIFT_MIN_SPAN_S
+  {
+    DriftEstimator drift;
+    int64_t elapsed = 0;
+    CHECK(fit(&drift, 4, DRIFT_MIN_SPAN_S / 4, 50, 0, &elapsed) == 0);
+    CHECK(drift.correction_ms() == 0);
+    CHECK(fit(&drift, 1, DRIFT_MIN_SPAN_S / 4, 50, 0, &elapsed) != 0);
+  }
+
+  // A rate no crystal has comes from a bad sync and is not applied
+  {
+    DriftEstimator drift;
+    CHECK(fit(&drift, 4, 3600, DRIFT_MAX_PPM * 2) == 0);
+    CHECK(drift.correction_ms() == 0);
+  }
+
+  // Syncs off by up to 20 ms either way, six hours apart
+  {
+    DriftEstimator drift;
+    float ppm = fit(&drift, DRIFT_HISTORY, 6 * 3600, 35, 20);
+    CHECK(fabs(ppm - 35) < 0.5);
+    printf("35 ppm, syncs 6 h apart off by up to 20 ms: fit %.2f ppm\n", ppm);
+  }
+
+  // The crystal warms up and changes rate, the old syncs age out
+  {
+    DriftEstimator drift;
+    int64_t elapsed = 0;
+    fit(&drift, DRIFT_HISTORY, 3600, 20, 0, &elapsed);
+    // The drift carries on from where it was at the new rate
+    float ppm = 0;
+    int64_t base = llround(elapsed * 20e-6) - llround(elapsed * 60e-6);
+    for (int i = 0; i < DRIFT_HISTORY; i++) {
+      drift.add(1792368000 + elapsed / 1000, elapsed,
+                base + llround(elapsed * 60e-6), 0);
+      elapsed += 3600 * 1000;
+      ppm = drift.ppm();
+    }
+    CHECK(fabs(ppm - 60) < 0.01);
+
+    // Oldest first, the first hour at the new rate 40 ppm more than the
+    // old fit predicted, and much less by the time the old syncs are gone
+    DriftRecord records[DRIFT_HISTORY + 2];
+    CHECK(drift.history(records, DRIFT_HISTORY + 2) == DRIFT_HISTORY);
+    CHECK(records[DRIFT_HISTORY - 1].elapsed_ms == elapsed - 3600 * 1000);
+    CHECK(llabs(records[1].error_ms - 144) <= 1);
+    CHECK(llabs(records[DRIFT_HISTORY - 1].error_ms) < 144 / 4);
+    CHECK(drift.history(records, 2) == 2 &&
+          records[1].elapsed_ms == elapsed - 3600 * 1000);
+  }
+}
+
+// The correction the clock gets between syncs, measured against the real
+// offset as each RTC second begins
+static void test_rtc(NetworkInterface *network, DnsCache *dns,
+                     SntpServer *server) {
+  SntpClient sntp(network, dns);
+  DriftEstimator drift;
+  server->jitter = 10ms;
+  host::rtc_drift(-80);
+  set_rtc_off(*server, 4000);
+
+  double worst[2] = {0, 0}; // without and with the correction, last day
+  const int days = 3;
+  for (int sync = 0; sync < days * 4; sync++) {
+    SntpResult result;
+    CHECK(sntp.sync("pool.ntp.org", &result) == NSAPI_ERROR_OK);
+    drift.add(result.time, result.elapsed_ms, result.drift_total_ms,
+              result.stepped ? 0 : result.offset_ms);
+    for (int minutes = 10; minutes < 6 * 60; minutes += 10) {
+      host::skip(10min);
+      double behind = rtc_behind_ms(*server);
+      double corrected = behind - drift.correction_ms();
+      if (sync >= (days - 1) * 4) {
+        worst[0] = fabs(behind) > worst[0] ? fabs(behind) : worst[0];
+        worst[1] = fabs(corrected) > worst[1] ? fabs(corrected) : worst[1];
+      }
+      // Once there is a rate, now() is the reference to the second
+      int64_t reference_s = (server->reference_us() + 500000) / 1000000;
+      CHECK(drift.ppm() == 0 || llabs(drift.now() - reference_s) <= 1);
+    }
+  }
+  CHECK(fabs(drift.ppm() - 80) < 2);
+  CHECK(worst[0] > 1000 && worst[1] < 50);
+  printf("80 ppm slow RTC synced every 6 h: fit %.2f ppm, off by up to "
+         "%.0f ms between syncs, %.0f ms corrected\n",
+         drift.ppm(), worst[0], worst[1]);
+  host::rtc_drift(0);
+}
+
+int main() {
+  host::simulate();
+  test_fit();
+
+  NetworkInterface network;
+  DnsCache dns(&network);
+  SntpServer server;
+  host::serve_udp("pool.ntp.org", &server);
+  test_rtc(&network, &dns, &server);
+  host::serve_udp("pool.ntp.org", nullptr);
+  return check_result();
+}
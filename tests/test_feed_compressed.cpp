@@ -0,0 +1,219 @@
+/**
+ * @file test_feed_compressed.cpp
+ * @brief Inflater against zlib on the feed in every chunking, and the
+ * compressed feed fetch against the Range parts at a headline count that
+ * takes the compressed path, including the fall back to parts when the
+ * stream reaches back past the window.
+ */
+#include "check.h"
+#include "feed_fetch.h"
+#include "feed_server.h"
+#include "fixture.h"
+#include "inflate.h"
+
+#include <random>
+#include <string>
+
+using namespace std::chrono;
+
+struct Decoded {
+  std::string out;
+  size_t limit; // stop asking for more after this many bytes
+};
+
+static bool collect(Decoded *decoded, const char *data, size_t size) {
+  decoded->out.append(data, size);
+  return decoded->out.size() < decoded->limit;
+}
+
+static Decoded inflate(Inflater *inflater, Inflater::Format format,
+                       const std::string &in, size_t chunk,
+                       size_t limit = SIZE_MAX) {
+  Decoded decoded = {"", limit};
+  InflateOutput out = callback(collect, &decoded);
+  inflater->reset(format);
+  for (size_t i = 0; i < in.size(); i += chunk) {
+    size_t n = in.size() - i < chunk ? in.size() - i : chunk;
+    if (!inflater->feed(in.data() + i, n, &out)) {
+      break;
+    }
+  }
+  return decoded;
+}
+
+static const struct {
+  const char *name;
+  Inflater::Format format;
+  int window_bits; // to FeedServer::compress() for an 8 KB window
+} formats[] = {
+    {"gzip", Inflater::GZIP, 13 + 16},
+    {"zlib", Inflater::DEFLATE, 13},
+    {"raw deflate", Inflater::DEFLATE, -13},
+};
+
+static void test_chunks(const std::string &doc) {
+  static Inflater inflater;
+  for (const auto &f : formats) {
+    std::string in = FeedServer::compress(doc, f.window_bits);
+    int differ = 0;
+    // Every size up to 64, then growing by half
+    for (size_t chunk = 1; chunk <= in.size();
+         chunk = chunk < 64 ? chunk + 1 : chunk * 3 / 2) {
+      Decoded decoded = inflate(&inflater, f.format, in, chunk);
+      if (!inflater.done() || decoded.out != doc ||
+          inflater.total_out() != doc.size()) {
+        differ++;
+      }
+    }
+    Decoded decoded = inflate(&inflater, f.format, in, in.size());
+    CHECK(inflater.done() && decoded.out == doc);
+    CHECK(differ == 0);
+
+    // An output that wants no more stops the stream without failing it
+    decoded = inflate(&inflater, f.format, in, 7, 1000);
+    CHECK(!inflater.done() && !inflater.failed());
+    CHECK(decoded.out.size() >= 1000 && decoded.out.size() < 1000 + 7 * 258);
+    CHECK(decoded.out == doc.substr(0, decoded.out.size()));
+
+    double ns = bench_ns(200, [&] { inflate(&inflater, f.format, in, 1460); });
+    printf("%s: %zu bytes to %zu, %.0f us to inflate in 1460 byte chunks\n",
+           f.name, in.size(), doc.size(), ns / 1000);
+  }
+
+  // With the 32 KB window zlib uses by default, the first
+  // INFLATE_WINDOW_SIZE bytes always decode and further on a match may
+  // reach too far back
+  std::string in = FeedServer::compress(doc, 15);
+  Decoded decoded = inflate(&inflater, Inflater::DEFLATE, in, 100);
+  CHECK(inflater.done() || inflater.failed());
+  CHECK(decoded.out.size() >= INFLATE_WINDOW_SIZE);
+  CHECK(decoded.out == doc.substr(0, decoded.out.size()));
+  CHECK(inflater.failed() || decoded.out == doc);
+
+  // Corrupt
+  in[in.size() / 2] ^= 0x55;
+  in.resize(in.size() * 3 / 4);
+  decoded = inflate(&inflater, Inflater::DEFLATE, in, 100);
+  CHECK(!inflater.done());
+}
+
+struct Measured {
+  FeedFetch fetch;
+  double ms;
+};
+
+static Measured measure(bool compressed, RssFeed *feed) {
+  NetworkInterface network;
+  HttpClient client(&network);
+  HttpValidators validators = {};
+  Timer timer;
+  timer.start();
+  Measured m;
+  m.fetch = fetch_feed(&client, "feeds.bbci.co.uk", "/news/world/rss.xml",
+                       feed, &validators, compressed);
+  m.ms = duration<double, std::milli>(timer.elapsed_time()).count();
+  return m;
+}
+
+static void test_fetch(const std::string &doc) {
+  std::vector<std::string> want = feed_titles(doc, RSS_MAX_HEADLINES);
+  FeedServer server;
+  server.update(doc);
+  server.bytes_per_second = 100000;
+  host::serve("feeds.bbci.co.uk", &server);
+
+  RssFeed feed;
+  Measured parts = measure(false, &feed);
+  CHECK(parts.fetch.status == 206);
+  CHECK(feed_matches(feed, want));
+  printf("%d headlines in %d byte parts: %lu bytes in %d requests, %.0f ms\n",
+         RSS_MAX_HEADLINES, RSS_RANGE_SIZE, parts.fetch.received,
+         parts.fetch.requests, parts.ms);
+
+  const char *encodings[] = {"gzip", "deflate", "deflate"};
+  for (int i = 0; i < 3; i++) {
+    server.encoding = encodings[i];
+    server.raw = i == 2;
+    memset(&feed, 0, sizeof(feed));
+    Measured compressed = measure(true, &feed);
+    CHECK(compressed.fetch.status == 200);
+    CHECK(compressed.fetch.requests == 1);
+    CHECK(feed_matches(feed, want));
+    CHECK(compressed.fetch.received < parts.fetch.received);
+    printf("%d headlines, %s%s: %lu bytes in %d request, %.0f ms\n",
+           RSS_MAX_HEADLINES, i == 2 ? "raw " : "", encodings[i],
+           compressed.fetch.received, compressed.fetch.requests,
+           compressed.ms);
+  }
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+/*
+Random text longer than the window in the channel header, then the start of
+it again in the first title. zlib with its 32 KB window codes the title as a
+match reaching past the 8 KB the inflater keeps, so the compressed fetch
+fails and the feed is fetched in parts instead.
+*/
+static void test_fallback(const std::string &doc) {
+  std::minstd_rand random(17);
+  std::string text;
+  while (text.size() < INFLATE_WINDOW_SIZE + 1024) {
+    text += (char)('a' + random() % 26);
+  }
+  std::string far = doc;
+  far.insert(far.find("<channel>") + 9, "<!--" + text + "-->");
+  size_t title = far.find("<title><![CDATA[", far.find("<item>"));
+  far.insert(title + 16, text.substr(0, 100) + " ");
+
+  static Inflater inflater;
+  inflate(&inflater, Inflater::DEFLATE, FeedServer::compress(far, 15), 1460);
+  CHECK(inflater.failed());
+
+  FeedServer server;
+  server.update(far);
+  server.encoding = "gzip";
+  host::serve("feeds.bbci.co.uk", &server);
+  RssFeed feed;
+  Measured m = measure(true, &feed);
+  CHECK(m.fetch.status == 206);
+  CHECK(m.fetch.requests >= 3);
+  CHECK(server.full == 1 && server.partial >= 2);
+  CHECK(feed_matches(feed, feed_titles(far, RSS_MAX_HEADLINES)));
+  CHECK(strncmp(feed.headlines[0], text.c_str(), 100) == 0);
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+/*
+Parts ask for the identity coding. One that comes compressed anyway fails
+the fetch instead of going to the parser as inflated garbage.
+*/
+static void test_compressed_part(const std::string &doc) {
+  FeedServer server;
+  server.update(doc);
+  server.encoding = "gzip";
+  host::serve("feeds.bbci.co.uk", &server);
+  RssFeed feed;
+  Measured m = measure(false, &feed);
+  CHECK(m.fetch.status == 206);
+  CHECK(feed_matches(feed, feed_titles(doc, RSS_MAX_HEADLINES)));
+  CHECK(server.range_accept == "identity");
+
+  server.compress_ranges = true;
+  memset(&feed, 0, sizeof(feed));
+  m = measure(false, &feed);
+  CHECK(m.fetch.status == NSAPI_ERROR_DEVICE_ERROR);
+  CHECK(m.fetch.requests == 1 && feed.headline_count == 0);
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+int main() {
+  host::simulate();
+  std::string doc = read_fixture("bbc_world.xml");
+  CHECK(!doc.empty());
+  CHECK(RSS_COMPRESSED == 1);
+  test_chunks(doc);
+  test_fetch(doc);
+  test_fallback(doc);
+  test_compressed_part(doc);
+  return check_result();
+}
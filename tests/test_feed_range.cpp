@@ -0,0 +1,171 @@
+/**
+ * @file test_feed_range.cpp
+ * @brief The feed fetched in Range parts for RSS_MAX_HEADLINES headlines,
+ * built once for each headline count, against a server that honours Range
+ * and one that sends the whole feed: headlines, bytes, requests and time.
+ */
+#include "check.h"
+#include "feed_fetch.h"
+#include "feed_server.h"
+#include "fixture.h"
+
+#include <string>
+
+using namespace std::chrono;
+
+struct Measured {
+  FeedFetch fetch;
+  double ms;
+  uint32_t handshakes; // for this fetch and the next one
+};
+
+static Measured measure(FeedServer *server, RssFeed *feed) {
+  NetworkInterface network;
+  HttpClient client(&network);
+  HttpValidators validators = {};
+  uint32_t handshakes = server->handshakes;
+  Timer timer;
+  timer.start();
+  Measured m;
+  m.fetch = fetch_feed(&client, "feeds.bbci.co.uk", "/news/world/rss.xml",
+                       feed, &validators);
+  m.ms = duration<double, std::milli>(timer.elapsed_time()).count();
+  RssFeed again;
+  fetch_feed(&client, "feeds.bbci.co.uk", "/news/world/rss.xml", &again,
+             &validators);
+  m.handshakes = server->handshakes - handshakes;
+  return m;
+}
+
+// Changes the document once, right after the first part went out
+class ChangingServer : public FeedServer {
+public:
+  std::string respond(const std::string &request) override {
+    std::string response = FeedServer::respond(request);
+    if (partial == 1 && !next.empty()) {
+      update(next);
+      next.clear();
+    }
+    return response;
+  }
+
+  std::string next;
+};
+
+int main() {
+  host::simulate();
+  std::string doc = read_fixture("bbc_world.xml");
+  CHECK(!doc.empty());
+  std::vector<std::string> want = feed_titles(doc, RSS_MAX_HEADLINES);
+  CHECK(RSS_COMPRESSED == 0);
+
+  FeedServer server;
+  server.update(doc);
+  server.bytes_per_second = 100000;
+  host::serve("feeds.bbci.co.uk", &server);
+
+  RssFeed feed;
+  Measured parts = measure(&server, &feed);
+  CHECK(parts.fetch.status == 206);
+  CHECK(feed_matches(feed, want));
+  // Every part is read to its end, so the connection is kept
+  CHECK(parts.handshakes == 1);
+
+  server.ranges = false;
+  Measured whole = measure(&server, &feed);
+  CHECK(whole.fetch.status == 200);
+  CHECK(feed_matches(feed, want));
+  CHECK(parts.fetch.received < whole.fetch.received + RSS_RANGE_SIZE);
+
+  printf("%d headlines, %d byte parts: %lu bytes in %d requests, %.0f ms, "
+         "%u handshakes for two fetches\n",
+         RSS_MAX_HEADLINES, RSS_RANGE_SIZE, parts.fetch.received,
+         parts.fetch.requests, parts.ms, parts.handshakes);
+  printf("%d headlines, no Range:      %lu bytes in %d request, %.0f ms, "
+         "%u handshakes for two fetches\n",
+         RSS_MAX_HEADLINES, whole.fetch.received, whole.fetch.requests,
+         whole.ms, whole.handshakes);
+
+  // Unchanged since the last fetch, the first part is a 304
+  {
+    server.ranges = true;
+    NetworkInterface network;
+    HttpClient client(&network);
+    HttpValidators validators = {};
+    fetch_feed(&client, "feeds.bbci.co.uk", "/", &feed, &validators);
+    RssFeed again;
+    FeedFetch fetch =
+        fetch_feed(&client, "feeds.bbci.co.uk", "/", &again, &validators);
+    CHECK(fetch.status == 304 && fetch.requests == 1);
+  }
+  host::serve("feeds.bbci.co.uk", nullptr);
+
+  // Changed between two parts, If-Range gets the whole new document and
+  // the fetch starts again from the first part of it. A comment in the
+  // channel header as long as a part makes sure there is a second one.
+  {
+    std::string padded = doc;
+    padded.insert(padded.find("<channel>") + 9,
+                  "<!--" + std::string(RSS_RANGE_SIZE, ' ') + "-->");
+    std::string changed = padded;
+    size_t title = changed.find("<title><![CDATA[", changed.find("<item>"));
+    changed.insert(title + 16, "Updated: ");
+
+    ChangingServer changing;
+    changing.update(padded);
+    changing.next = changed;
+    host::serve("feeds.bbci.co.uk", &changing);
+    NetworkInterface network;
+    HttpClient client(&network);
+    HttpValidators validators = {};
+    FeedFetch fetch =
+        fetch_feed(&client, "feeds.bbci.co.uk", "/", &feed, &validators);
+    CHECK(fetch.status == 206);
+    CHECK(changing.full == 1);
+    CHECK(feed_matches(feed, feed_titles(changed, RSS_MAX_HEADLINES)));
+    CHECK(strncmp(feed.headlines[0], "Updated: ", 9) == 0);
+    host::serve("feeds.bbci.co.uk", nullptr);
+  }
+
+  // Content-Range without the total. The parts go on until the headlines
+  // are in, a short part, or a 416 when the document ends with a part.
+  {
+    std::string padded = doc;
+    padded.insert(padded.find("<channel>") + 9,
+                  "<!--" + std::string(RSS_RANGE_SIZE, ' ') + "-->");
+    FeedServer unknown;
+    unknown.unknown_total = true;
+    unknown.update(padded);
+    host::serve("feeds.bbci.co.uk", &unknown);
+    NetworkInterface network;
+    HttpClient client(&network);
+    HttpValidators validators = {};
+    FeedFetch fetch =
+        fetch_feed(&client, "feeds.bbci.co.uk", "/", &feed, &validators);
+    CHECK(fetch.status == 206 && fetch.requests >= 2);
+    CHECK(feed_matches(feed, want));
+
+    // Two items, padded to a whole number of parts and then one byte more
+    size_t second = doc.find("<item>", doc.find("<item>") + 1);
+    std::string two = doc.substr(0, doc.find("</item>", second) + 7) +
+                      "</channel></rss>";
+    size_t pad = RSS_RANGE_SIZE - two.size() % RSS_RANGE_SIZE;
+    pad += pad < 8 ? RSS_RANGE_SIZE : 0; // room for the comment
+    for (size_t extra : {pad, pad + 1}) {
+      std::string sized = two;
+      sized.insert(sized.find("<channel>") + 9,
+                   "<!--" + std::string(extra - 7, ' ') + "-->");
+      unknown.update(sized);
+      unknown.unsatisfiable = 0;
+      memset(&validators, 0, sizeof(validators));
+      fetch = fetch_feed(&client, "feeds.bbci.co.uk", "/", &feed, &validators);
+      CHECK(fetch.status == 206);
+      CHECK(feed_matches(feed, feed_titles(sized, 2)));
+      // The parts and then the 416, or the short part
+      CHECK(fetch.requests == (int)(sized.size() / RSS_RANGE_SIZE) + 1);
+      CHECK(unknown.unsatisfiable == (extra == pad ? 1u : 0u));
+    }
+    host::serve("feeds.bbci.co.uk", nullptr);
+  }
+  return check_result();
+}
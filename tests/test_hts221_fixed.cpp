@@ -0,0 +1,164 @@
+/**
+ * @file test_hts221_fixed.cpp
+ * @brief The integer HTS221 conversion over every int16 raw value, against
+ * the exact result of the calibration line and the float formula, and how
+ * long each takes.
+ */
+#include "HTS221_driver.h"
+#include "check.h"
+
+#include <random>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+// The float path needs no bus, it only uses the calibration struct
+extern "C" uint8_t HTS221_io_read(void *, uint8_t, uint8_t *, uint16_t) {
+  return 1;
+}
+extern "C" uint8_t HTS221_io_write(void *, uint8_t, uint8_t *, uint16_t) {
+  return 1;
+}
+
+// (raw - x0) * (y1 - y0) / (x1 - x0) + y0 in steps of 1/scale, cut toward
+// zero, with no rounding anywhere
+static int64_t exact(int16_t raw, int16_t x0, int16_t x1, int16_t y0,
+                     int16_t y1, int64_t scale) {
+  int64_t num = (int64_t)(y1 - y0) * scale;
+  int64_t den = (int64_t)x1 - x0;
+  return ((int64_t)raw * num + (int64_t)y0 * scale * den - (int64_t)x0 * num) /
+         den;
+}
+
+static bool fits_int32(int64_t value) {
+  return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+struct Tally {
+  uint64_t values;
+  uint64_t not_exact;
+  uint64_t float_off_by_1;
+  uint64_t float_off_more;
+  uint64_t overflow;
+};
+
+static void check_calibration(const HTS221_Calibration_st &calib,
+                              Tally *tally) {
+  HTS221_Conversion_st conv;
+  if (HTS221_Get_Conversion(&calib, &conv) != HTS221_OK) {
+    return;
+  }
+
+  for (int32_t r = INT16_MIN; r <= INT16_MAX; r++) {
+    int16_t raw = (int16_t)r;
+    tally->values++;
+
+    // The largest intermediate is raw * num + offset
+    if (!fits_int32((int64_t)raw * conv.h_num + conv.h_offset) ||
+        !fits_int32((int64_t)raw * conv.t_num + conv.t_offset)) {
+      tally->overflow++;
+    }
+
+    uint16_t permille;
+    HTS221_Calc_Humidity_Permille(&conv, raw, &permille);
+    int64_t want_h = exact(raw, calib.H0_T0_out, calib.H1_T0_out,
+                           calib.H0_rh, calib.H1_rh, 10);
+    want_h = want_h > 1000 ? 1000 : want_h < 0 ? 0 : want_h;
+
+    int16_t centi;
+    HTS221_Calc_Temperature_Centi(&conv, raw, &centi);
+    int64_t want_t = exact(raw, calib.T0_out, calib.T1_out, calib.T0_degC,
+                           calib.T1_degC, 100);
+    want_t = want_t > INT16_MAX ? INT16_MAX
+             : want_t < INT16_MIN ? INT16_MIN
+                                  : want_t;
+
+    if (permille != want_h || centi != want_t) {
+      tally->not_exact++;
+    }
+
+    // The float formula, in the same unit for humidity
+    uint16_t float_h;
+    HTS221_Calc_Humidity(&calib, raw, &float_h);
+    int off = abs((int)float_h - (int)permille);
+    if (off == 1) {
+      tally->float_off_by_1++;
+    } else if (off > 1) {
+      tally->float_off_more++;
+    }
+  }
+}
+
+int main() {
+  Tally tally = {};
+  std::mt19937 rng(5);
+
+  // Random parts, and the corners of what the registers can hold
+  std::vector<HTS221_Calibration_st> sets;
+  for (int i = 0; i < 300; i++) {
+    HTS221_Calibration_st c;
+    c.H0_rh = rng() % 128;
+    c.H1_rh = rng() % 128;
+    c.T0_degC = rng() % 128;
+    c.T1_degC = rng() % 128;
+    c.H0_T0_out = (int16_t)rng();
+    c.H1_T0_out = (int16_t)rng();
+    c.T0_out = (int16_t)rng();
+    c.T1_out = (int16_t)rng();
+    sets.push_back(c);
+  }
+  const int16_t outs[] = {INT16_MIN, -1, 0, 1, INT16_MAX};
+  for (int16_t x0 : outs) {
+    for (int16_t x1 : outs) {
+      for (int16_t y1 : {0, 127}) {
+        sets.push_back({0, y1, x0, x1, 0, y1, x0, x1});
+        sets.push_back({127, (int16_t)(127 - y1), x0, x1, 127,
+                        (int16_t)(127 - y1), x0, x1});
+      }
+    }
+  }
+
+  for (const HTS221_Calibration_st &calib : sets) {
+    check_calibration(calib, &tally);
+  }
+
+  CHECK(tally.overflow == 0);
+  CHECK(tally.not_exact == 0);
+  CHECK(tally.float_off_more == 0);
+  printf("%zu calibrations, %llu raw values: %llu not exact, %llu 32-bit "
+         "overflows\n",
+         sets.size(), (unsigned long long)tally.values,
+         (unsigned long long)tally.not_exact,
+         (unsigned long long)tally.overflow);
+  printf("humidity vs float formula: %llu off by 1 permille (float "
+         "rounding), %llu more\n",
+         (unsigned long long)tally.float_off_by_1,
+         (unsigned long long)tally.float_off_more);
+
+  // A host FPU makes float cheap, on the Cortex-M4 build without one the
+  // float path goes through the soft-float library instead
+  HTS221_Calibration_st calib = {30, 80, -4500, -12800, 19, 42, -120, 680};
+  HTS221_Conversion_st conv;
+  HTS221_Get_Conversion(&calib, &conv);
+  volatile int16_t raw = 0;
+  volatile uint32_t sink = 0;
+  double float_ns = bench_ns(5000000, [&] {
+    uint16_t h;
+    int16_t t;
+    HTS221_Calc_Humidity(&calib, raw, &h);
+    HTS221_Calc_Temperature(&calib, raw, &t);
+    sink = sink + h + t;
+    raw = raw + 7;
+  });
+  double fixed_ns = bench_ns(5000000, [&] {
+    uint16_t h;
+    int16_t t;
+    HTS221_Calc_Humidity_Permille(&conv, raw, &h);
+    HTS221_Calc_Temperature_Centi(&conv, raw, &t);
+    sink = sink + h + t;
+    raw = raw + 7;
+  });
+  printf("per sample on this host: float %.2f ns, integer %.2f ns\n",
+         float_ns, fixed_ns);
+  return check_result();
+}
@@ -0,0 +1,227 @@
+/**
+ * @file test_http_client.cpp
+ * @brief HttpClient against in-process servers: how many handshakes a run
+ * of fetches costs with kept connections and with a connection per fetch,
+ * the time to first byte, and the ways a kept connection gets lost.
+ */
+#include "check.h"
+#include "fixture.h"
+#include "host_server.h"
+#include "http_client.h"
+
+#include <string>
+
+using namespace std::chrono;
+
+// Serves one document, closing after each response when keep_alive is off
+class DocumentServer : public host::Server {
+public:
+  std::string respond(const std::string &request) override {
+    (void)request;
+    std::string headers = "Content-Type: application/rss+xml\r\n";
+    if (!keep_alive) {
+      headers += "Connection: close\r\n";
+    }
+    if (chunked) {
+      std::string response =
+          "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n" + headers +
+          "\r\n";
+      for (size_t pos = 0; pos < body.size(); pos += 1000) {
+        std::string part = body.substr(pos, 1000);
+        char size[16];
+        snprintf(size, sizeof(size), "%zx\r\n", part.size());
+        response += size + part + "\r\n";
+      }
+      return response + "0\r\n\r\n";
+    }
+    return response(200, headers, body);
+  }
+
+  std::string body;
+  bool keep_alive = true;
+  bool chunked = false;
+};
+
+static HttpBodyCallback collect(std::string *out, size_t stop_after = 0) {
+  return HttpBodyCallback([out, stop_after](const char *data, size_t size) {
+    out->append(data, size);
+    return stop_after == 0 || out->size() < stop_after;
+  });
+}
+
+struct Run {
+  uint32_t handshakes;
+  int failed;
+  double ms_per_fetch;
+  double ttfb_ms;
+};
+
+// A fetch a minute, as the scheduler does for the feed
+static Run fetch_every_minute(HttpClient *client, DocumentServer *server,
+                              int fetches) {
+  uint32_t handshakes = server->handshakes;
+  Run run = {0, 0, 0, 0};
+  for (int i = 0; i < fetches; i++) {
+    std::string body;
+    Timer timer;
+    timer.start();
+    int status = client->get("feeds.bbci.co.uk", "/news/world/rss.xml",
+                             "cert", collect(&body));
+    run.ms_per_fetch += duration<double, std::milli>(timer.elapsed_time())
+                            .count();
+    // From the call, so a handshake counts
+    run.ttfb_ms +=
+        client->stats().last_connect_ms + client->stats().last_ttfb_ms;
+    if (status != 200 || body != server->body) {
+      run.failed++;
+    }
+    host::skip(HTTP_IDLE_TIMEOUT / 2);
+  }
+  run.handshakes = server->handshakes - handshakes;
+  run.ms_per_fetch /= fetches;
+  run.ttfb_ms /= fetches;
+  return run;
+}
+
+static void test_keep_alive(const std::string &doc) {
+  NetworkInterface network;
+  DocumentServer server;
+  server.body = doc;
+  host::serve("feeds.bbci.co.uk", &server);
+
+  // A connection per fetch, as before the client kept them
+  HttpClient client(&network);
+  server.keep_alive = false;
+  Run closing = fetch_every_minute(&client, &server, 20);
+  CHECK(closing.failed == 0);
+  CHECK(closing.handshakes == 20);
+
+  server.keep_alive = true;
+  client.close_all();
+  Run kept = fetch_every_minute(&client, &server, 20);
+  CHECK(kept.failed == 0);
+  CHECK(kept.handshakes == 1);
+  CHECK(client.stats().reused == 19);
+
+  printf("20 fetches of %zu bytes, %lld ms handshake, %lld ms round trip:\n",
+         doc.size(), (long long)duration_cast<milliseconds>(
+                         server.handshake_time).count(),
+         (long long)duration_cast<milliseconds>(server.round_trip).count());
+  printf("  connection per fetch: %u handshakes, %.0f ms per fetch, "
+         "%.0f ms to first byte\n",
+         closing.handshakes, closing.ms_per_fetch, closing.ttfb_ms);
+  printf("  kept connection:      %u handshakes, %.0f ms per fetch, "
+         "%.0f ms to first byte\n",
+         kept.handshakes, kept.ms_per_fetch, kept.ttfb_ms);
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+static void test_lost_connections(const std::string &doc) {
+  NetworkInterface network;
+  DocumentServer server;
+  server.body = doc;
+  host::serve("feeds.bbci.co.uk", &server);
+  HttpClient client(&network);
+
+  // The server closes after every third request, each fetch still succeeds
+  server.max_requests = 3;
+  Run run = fetch_every_minute(&client, &server, 10);
+  CHECK(run.failed == 0);
+  CHECK(run.handshakes == 4);
+
+  // Dropped by the server while idle, the retry is not seen by the caller
+  server.max_requests = 100;
+  server.idle_timeout = 10s;
+  run = fetch_every_minute(&client, &server, 5);
+  CHECK(run.failed == 0);
+  CHECK(run.handshakes == 5);
+
+  // Idle past HTTP_IDLE_TIMEOUT, closed by the client before it is used
+  server.idle_timeout = 600s;
+  std::string body;
+  client.get("feeds.bbci.co.uk", "/", "cert", collect(&body));
+  uint32_t before = server.handshakes, requests = server.requests;
+  host::skip(HTTP_IDLE_TIMEOUT + 1s);
+  body.clear();
+  CHECK(client.get("feeds.bbci.co.uk", "/", "cert", collect(&body)) == 200);
+  CHECK(server.handshakes == before + 1);
+  CHECK(server.requests == requests + 1);
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+static void test_framing(const std::string &doc) {
+  NetworkInterface network;
+  DocumentServer server;
+  server.body = doc;
+  server.chunked = true;
+  host::serve("feeds.bbci.co.uk", &server);
+  HttpClient client(&network);
+
+  std::string body;
+  CHECK(client.get("feeds.bbci.co.uk", "/", "cert", collect(&body)) == 200);
+  CHECK(body == doc);
+
+  // Stopping with a short rest drains it and keeps the connection
+  server.chunked = false;
+  server.body = doc.substr(0, 6000);
+  body.clear();
+  CHECK(client.get("feeds.bbci.co.uk", "/", "cert", collect(&body, 3000)) ==
+        200);
+  body.clear();
+  CHECK(client.get("feeds.bbci.co.uk", "/", "cert", collect(&body)) == 200);
+  CHECK(server.handshakes == 1);
+
+  // A long rest costs more to read than a new handshake
+  server.body = doc;
+  body.clear();
+  uint64_t sent = server.bytes_sent;
+  CHECK(client.get("feeds.bbci.co.uk", "/", "cert", collect(&body, 3000)) ==
+        200);
+  CHECK(server.bytes_sent - sent <
+        3000 + HTTP_DRAIN_LIMIT + HTTP_CHUNK_SIZE + server.recv_chunk);
+  body.clear();
+  CHECK(client.get("feeds.bbci.co.uk", "/", "cert", collect(&body)) == 200);
+  CHECK(server.handshakes == 2);
+  host::serve("feeds.bbci.co.uk", nullptr);
+}
+
+static void test_hosts() {
+  NetworkInterface network;
+  DocumentServer a, b, c;
+  a.body = "a";
+  b.body = "b";
+  c.body = "c";
+  host::serve("a.example", &a);
+  host::serve("b.example", &b);
+  host::serve("c.example", &c);
+  HttpClient client(&network);
+
+  // Two kept connections, a third host takes the place of the first
+  std::string body;
+  const char *order[] = {"a.example", "b.example", "a.example", "b.example",
+                         "c.example", "b.example", "a.example"};
+  for (const char *host : order) {
+    body.clear();
+    CHECK(client.get(host, "/", "cert", collect(&body)) == 200);
+    CHECK(body == std::string(host, 1));
+  }
+  CHECK(a.handshakes == 2 && b.handshakes == 1 && c.handshakes == 1);
+
+  // Unknown names fail without a connection
+  CHECK(client.get("d.example", "/", "cert", collect(&body)) ==
+        NSAPI_ERROR_DNS_FAILURE);
+  host::serve("a.example", nullptr);
+  host::serve("b.example", nullptr);
+  host::serve("c.example", nullptr);
+}
+
+int main() {
+  host::simulate();
+  std::string doc = read_fixture("bbc_world.xml");
+  CHECK(!doc.empty());
+  test_keep_alive(doc);
+  test_lost_connections(doc);
+  test_framing(doc);
+  test_hosts();
+  return check_result();
+}
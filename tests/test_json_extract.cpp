@@ -0,0 +1,190 @@
+/**
+ * @file test_json_extract.cpp
+ * @brief Field extraction through the nlohmann SAX interface against
+ * json::parse() into a DOM, as main.cpp did before, on recorded weather and
+ * geolocation responses: same values, peak heap and time.
+ */
+#include "check.h"
+#include "fixture.h"
+#include "json.hpp"
+#include "json_extract.h"
+
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+using json = nlohmann::json;
+
+/*
+Every allocation is counted, with its size kept in front of the block.
+Not inlined, so GCC does not pair the malloc() with a delete expression.
+*/
+static size_t heap_in_use = 0;
+static size_t heap_peak = 0;
+static const size_t HEAP_HEADER = 16;
+
+__attribute__((noinline)) void *operator new(size_t size) {
+  char *block = (char *)malloc(size + HEAP_HEADER);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *(size_t *)block = size;
+  heap_in_use += size;
+  if (heap_in_use > heap_peak) {
+    heap_peak = heap_in_use;
+  }
+  return block + HEAP_HEADER;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  if (p) {
+    char *block = (char *)p - HEAP_HEADER;
+    heap_in_use -= *(size_t *)block;
+    free(block);
+  }
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+// Peak heap of f above what was in use before it
+template <typename F> static size_t peak_heap(F f) {
+  size_t before = heap_in_use;
+  heap_peak = heap_in_use;
+  f();
+  return heap_peak - before;
+}
+
+struct GeoInfo {
+  char city[64];
+  char latitude[16];
+  char longitude[16];
+  double unix_time;
+  int dst;
+  char zone[40];
+};
+
+static const JsonField geo_fields[] = {
+    JSON_FIELD(GeoInfo, city, "/geo/city"),
+    JSON_FIELD(GeoInfo, latitude, "/geo/latitude"),
+    JSON_FIELD(GeoInfo, longitude, "/geo/longitude"),
+    JSON_FIELD(GeoInfo, unix_time, "/date_time_unix"),
+    JSON_FIELD(GeoInfo, dst, "/timezone_offset_with_dst"),
+    JSON_FIELD(GeoInfo, zone, "/timezone"),
+};
+
+struct WeatherInfo {
+  char condition[64];
+  float temp_c;
+};
+
+static const JsonField weather_fields[] = {
+    JSON_FIELD(WeatherInfo, condition, "/current/condition/text"),
+    JSON_FIELD(WeatherInfo, temp_c, "/current/temp_c"),
+};
+
+static void copy(char *dest, size_t size, const json &value) {
+  if (value.is_string()) {
+    strncpy(dest, value.get<std::string>().c_str(), size - 1);
+    dest[size - 1] = '\0';
+  }
+}
+
+// The DOM lookups of main.cpp before the SAX handler
+static bool dom_geo(const std::string &body, GeoInfo *geo) {
+  json document = json::parse(body, nullptr, false);
+  if (document.is_discarded()) {
+    return false;
+  }
+  copy(geo->city, sizeof(geo->city), document["geo"]["city"]);
+  copy(geo->latitude, sizeof(geo->latitude), document["geo"]["latitude"]);
+  copy(geo->longitude, sizeof(geo->longitude), document["geo"]["longitude"]);
+  copy(geo->zone, sizeof(geo->zone), document["timezone"]);
+  if (document["date_time_unix"].is_number()) {
+    geo->unix_time = document["date_time_unix"].get<double>();
+  }
+  if (document["timezone_offset_with_dst"].is_number()) {
+    geo->dst = document["timezone_offset_with_dst"].get<int>();
+  }
+  return true;
+}
+
+static bool dom_weather(const std::string &body, WeatherInfo *weather) {
+  json document = json::parse(body, nullptr, false);
+  if (document.is_discarded()) {
+    return false;
+  }
+  copy(weather->condition, sizeof(weather->condition),
+       document["current"]["condition"]["text"]);
+  if (document["current"]["temp_c"].is_number()) {
+    weather->temp_c = document["current"]["temp_c"].get<float>();
+  }
+  return true;
+}
+
+static void test_values(const std::string &geo_body,
+                        const std::string &weather_body) {
+  GeoInfo sax_geo = {}, dom_geo_info = {};
+  uint32_t found = json_extract(geo_body.data(), geo_body.size(), geo_fields,
+                                &sax_geo);
+  CHECK(json_all_found(found, geo_fields));
+  CHECK(dom_geo(geo_body, &dom_geo_info));
+  CHECK(strcmp(sax_geo.city, "Kristiansand") == 0);
+  CHECK(strcmp(sax_geo.city, dom_geo_info.city) == 0);
+  CHECK(strcmp(sax_geo.latitude, dom_geo_info.latitude) == 0);
+  CHECK(strcmp(sax_geo.longitude, dom_geo_info.longitude) == 0);
+  CHECK(strcmp(sax_geo.zone, "Europe/Oslo") == 0);
+  CHECK(sax_geo.unix_time == dom_geo_info.unix_time);
+  CHECK(sax_geo.dst == 2 && dom_geo_info.dst == 2);
+
+  WeatherInfo sax_weather = {}, dom_weather_info = {};
+  found = json_extract(weather_body.data(), weather_body.size(),
+                       weather_fields, &sax_weather);
+  CHECK(json_all_found(found, weather_fields));
+  CHECK(dom_weather(weather_body, &dom_weather_info));
+  CHECK(strcmp(sax_weather.condition, "Patchy light rain") == 0);
+  CHECK(strcmp(sax_weather.condition, dom_weather_info.condition) == 0);
+  CHECK(fabsf(sax_weather.temp_c - 9.3f) < 1e-6f);
+  CHECK(sax_weather.temp_c == dom_weather_info.temp_c);
+
+  // Cut short, the fields seen so far are kept
+  WeatherInfo cut = {};
+  found = json_extract(weather_body.data(), weather_body.find("\"temp_f\""),
+                       weather_fields, &cut);
+  CHECK(found == 2);
+  CHECK(cut.temp_c == sax_weather.temp_c);
+}
+
+template <typename T>
+static void bench(const char *name, const std::string &body,
+                  const JsonField *fields, size_t count,
+                  bool (*dom)(const std::string &, T *)) {
+  T out;
+  size_t dom_heap = peak_heap([&] { dom(body, &out); });
+  size_t sax_heap = peak_heap([&] {
+    json_extract(body.data(), body.size(), fields, count, &out);
+  });
+  double dom_us = bench_ns(20000, [&] { dom(body, &out); }) / 1000;
+  double sax_us = bench_ns(20000, [&] {
+    json_extract(body.data(), body.size(), fields, count, &out);
+  }) / 1000;
+  printf("%s, %zu bytes: DOM %zu bytes peak heap, %.2f us; "
+         "SAX %zu bytes, %.2f us\n",
+         name, body.size(), dom_heap, dom_us, sax_heap, sax_us);
+  CHECK(sax_heap < dom_heap);
+}
+
+int main() {
+  std::string geo = read_fixture("ipgeolocation_timezone.json");
+  std::string weather = read_fixture("weatherapi_current.json");
+  CHECK(!geo.empty() && !weather.empty());
+  test_values(geo, weather);
+  bench("ipgeolocation", geo, geo_fields,
+        sizeof(geo_fields) / sizeof(geo_fields[0]), dom_geo);
+  bench("weatherapi", weather, weather_fields,
+        sizeof(weather_fields) / sizeof(weather_fields[0]), dom_weather);
+  return check_result();
+}
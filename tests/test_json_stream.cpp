@@ -0,0 +1,226 @@
+/**
+ * @file test_json_stream.cpp
+ * @brief JsonStreamParser with the document split at every byte boundary,
+ * fed in every chunk size and in random pieces, against json_extract() on
+ * the whole document.
+ */
+#include "check.h"
+#include "fixture.h"
+#include "json_extract.h"
+#include "json_stream.h"
+
+#include <random>
+#include <string.h>
+
+// Any record of up to this size, compared byte by byte
+struct Record {
+  char bytes[256];
+};
+
+struct Result {
+  bool ok;
+  uint32_t found;
+  Record record;
+};
+
+template <typename F>
+static Result stream(const std::string &doc, const JsonField *fields,
+                     size_t count, F next_size) {
+  Result r = {};
+  JsonStreamParser parser(fields, count, &r.record);
+  size_t offset = 0;
+  while (offset < doc.size() && !parser.done() && !parser.failed()) {
+    size_t n = next_size();
+    n = n < doc.size() - offset ? n : doc.size() - offset;
+    parser.feed(doc.data() + offset, n);
+    offset += n;
+  }
+  if (!parser.done() && !parser.failed()) {
+    parser.finish();
+  }
+  r.ok = parser.done();
+  r.found = parser.found();
+  return r;
+}
+
+static bool same(const Result &a, const Result &b) {
+  return a.ok == b.ok && a.found == b.found &&
+         memcmp(&a.record, &b.record, sizeof(Record)) == 0;
+}
+
+// Every split into two pieces, every chunk size and random chunking
+static int check_splits(const std::string &doc, const JsonField *fields,
+                        size_t count, const Result &want) {
+  int wrong = 0;
+  for (size_t split = 0; split <= doc.size(); split++) {
+    bool first = true;
+    Result r = stream(doc, fields, count, [&] {
+      size_t n = first ? split : doc.size();
+      first = false;
+      return n;
+    });
+    wrong += !same(r, want);
+  }
+  for (size_t chunk = 1; chunk <= doc.size(); chunk++) {
+    wrong += !same(stream(doc, fields, count, [chunk] { return chunk; }),
+                   want);
+  }
+  std::mt19937 rng(11);
+  for (int run = 0; run < 2000; run++) {
+    wrong += !same(stream(doc, fields, count,
+                          [&rng] { return (size_t)(rng() % 40); }),
+                   want);
+  }
+  return wrong;
+}
+
+struct GeoInfo {
+  char city[64];
+  char latitude[16];
+  char longitude[16];
+  double unix_time;
+  int dst;
+  char zone[40];
+};
+
+static const JsonField geo_fields[] = {
+    JSON_FIELD(GeoInfo, city, "/geo/city"),
+    JSON_FIELD(GeoInfo, latitude, "/geo/latitude"),
+    JSON_FIELD(GeoInfo, longitude, "/geo/longitude"),
+    JSON_FIELD(GeoInfo, unix_time, "/date_time_unix"),
+    JSON_FIELD(GeoInfo, dst, "/timezone_offset_with_dst"),
+    JSON_FIELD(GeoInfo, zone, "/timezone"),
+};
+
+struct WeatherInfo {
+  char condition[64];
+  float temp_c;
+};
+
+static const JsonField weather_fields[] = {
+    JSON_FIELD(WeatherInfo, condition, "/current/condition/text"),
+    JSON_FIELD(WeatherInfo, temp_c, "/current/temp_c"),
+};
+
+// Escapes, surrogate pairs, arrays, odd keys and nesting too deep to track
+struct Edges {
+  char name[16];
+  char escaped[32];
+  char emoji[16];
+  int second;
+  bool flag;
+  double last;
+  char odd_key[8];
+  float deep;
+};
+
+static const JsonField edge_fields[] = {
+    JSON_FIELD(Edges, name, "/list/1/name"),
+    JSON_FIELD(Edges, escaped, "/text"),
+    JSON_FIELD(Edges, emoji, "/emoji"),
+    JSON_FIELD(Edges, second, "/numbers/1"),
+    JSON_FIELD(Edges, flag, "/flag"),
+    JSON_FIELD(Edges, last, "/last"),
+    JSON_FIELD(Edges, odd_key, "/a~1b~0c"),
+    JSON_FIELD(Edges, deep, "/d/d/d/d/d/d/d/d/d/v"),
+};
+
+static const char edge_doc[] =
+    " {\"list\": [{\"name\": \"first\"}, {\"skip\": null, \"name\": "
+    "\"second\"}],\n"
+    "  \"text\": \"tab\\there \\\"quoted\\\" \\u00e6\\u00f8\\u00e5\",\n"
+    "  \"emoji\": \"\\ud83c\\udf27 rain\", \"numbers\": [1, -25, 3e2],\n"
+    "  \"flag\": true, \"nothing\": null, \"a/b~c\": \"odd\",\n"
+    "  \"d\": {\"d\": {\"d\": {\"d\": {\"d\": {\"d\": {\"d\": {\"d\": "
+    "{\"d\": {\"v\": 1.5}}}}}}}}},\n"
+    "  \"last\": -1.25e-3 } ";
+
+static void test_document(const char *name, const std::string &doc,
+                          const JsonField *fields, size_t count,
+                          bool all_found) {
+  Result want = {};
+  want.found = json_extract(doc.data(), doc.size(), fields, count,
+                            &want.record);
+  want.ok = true;
+  CHECK(json_all_found(want.found, count) == all_found);
+
+  int wrong = check_splits(doc, fields, count, want);
+  CHECK(wrong == 0);
+  printf("%s, %zu bytes: %d of %zu splits and chunkings differ from "
+         "json_extract()\n",
+         name, doc.size(), wrong, 2 * doc.size() + 2001);
+}
+
+static void test_edges() {
+  std::string doc = edge_doc;
+  test_document("edge cases", doc, edge_fields,
+                sizeof(edge_fields) / sizeof(edge_fields[0]), false);
+
+  Edges edges = {};
+  JsonStreamParser parser(edge_fields, &edges);
+  parser.feed(doc.data(), doc.size());
+  parser.finish();
+  CHECK(parser.done());
+  CHECK(strcmp(edges.name, "second") == 0);
+  CHECK(strcmp(edges.escaped,
+               "tab\there \"quoted\" \xc3\xa6\xc3\xb8\xc3\xa5") == 0);
+  CHECK(strcmp(edges.emoji, "\xf0\x9f\x8c\xa7 rain") == 0);
+  CHECK(edges.second == -25);
+  CHECK(edges.flag);
+  CHECK(edges.last == -1.25e-3);
+  CHECK(strcmp(edges.odd_key, "odd") == 0);
+  // Deeper than JSON_MAX_DEPTH, never stored
+  CHECK(!(parser.found() & (1u << 7)));
+
+  // A number as the whole document only ends with finish()
+  double number = 0;
+  static const JsonField root[] = {{"", JSON_FIELD_DOUBLE, 0, sizeof(double)}};
+  JsonStreamParser top(root, &number);
+  top.feed("12", 2);
+  top.feed("5.5", 3);
+  CHECK(!top.done() && number == 0);
+  top.finish();
+  CHECK(top.done() && number == 125.5);
+
+  // Syntax errors stop the parser, fields before them are kept
+  WeatherInfo weather = {};
+  JsonStreamParser broken(weather_fields, &weather);
+  const char bad[] =
+      "{\"current\": {\"temp_c\": 4.5, \"x\": tru, \"condition\": {}}}";
+  CHECK(!broken.feed(bad, sizeof(bad) - 1));
+  CHECK(broken.failed());
+  CHECK(weather.temp_c == 4.5f && broken.found() == 2);
+}
+
+static void bench(const std::string &doc) {
+  WeatherInfo weather;
+  double sax_us = bench_ns(20000, [&] {
+    json_extract(doc.data(), doc.size(), weather_fields, &weather);
+  });
+  double stream_us = bench_ns(20000, [&] {
+    JsonStreamParser parser(weather_fields, &weather);
+    for (size_t pos = 0; pos < doc.size(); pos += 512) {
+      size_t n = doc.size() - pos < 512 ? doc.size() - pos : 512;
+      if (!parser.feed(doc.data() + pos, n)) {
+        break;
+      }
+    }
+  });
+  printf("weatherapi: json_extract() %.2f us on the whole body, "
+         "JsonStreamParser %.2f us in 512 byte chunks and %zu bytes of "
+         "state, no body buffer\n",
+         sax_us / 1000, stream_us / 1000, sizeof(JsonStreamParser));
+}
+
+int main() {
+  std::string geo = read_fixture("ipgeolocation_timezone.json");
+  std::string weather = read_fixture("weatherapi_current.json");
+  CHECK(!geo.empty() && !weather.empty());
+  test_document("ipgeolocation", geo, geo_fields,
+                sizeof(geo_fields) / sizeof(geo_fields[0]), true);
+  test_document("weatherapi", weather, weather_fields,
+                sizeof(weather_fields) / sizeof(weather_fields[0]), true);
+  test_edges();
+  bench(weather);
+  return check_result();
+}
@@ -0,0 +1,199 @@
+/**
+ * @file test_lcd_framebuffer.cpp
+ * @brief LcdFrameBuffer::flush() against a recording LCD: nothing on the bus
+ * for an unchanged frame, changed cells merged over short gaps into one
+ * transaction, the cursor command left out where the display's cursor
+ * already is, and the display matching the frame after random changes.
+ */
+#include "check.h"
+#include "lcd_framebuffer.h"
+
+#include <random>
+#include <string.h>
+
+typedef DFRobot_RGBLCD1602::Transaction Transaction;
+
+static bool same(const Transaction &t, int col, int row, const char *data) {
+  return t.col == col && t.row == row && t.data == data;
+}
+
+static bool shows(const DFRobot_RGBLCD1602 &lcd, const LcdFrameBuffer &fb) {
+  return memcmp(lcd.ddram[0], fb.row(0), LCD_FB_COLS) == 0 &&
+         memcmp(lcd.ddram[1], fb.row(1), LCD_FB_COLS) == 0;
+}
+
+// The clock screen as redraw() in main.cpp draws it
+static void draw_clock(LcdFrameBuffer *fb, int hour, int minute) {
+  fb->clear();
+  fb->setCursor(0, 0);
+  fb->printf("%s %02d %s %02d:%02d", "Sat", 17, "Oct", hour, minute);
+  fb->setCursor(0, 1);
+  fb->printf("Alarm: %02d:%02d", 6, 30);
+}
+
+static void test_clock() {
+  DFRobot_RGBLCD1602 lcd;
+  LcdFrameBuffer fb(&lcd);
+
+  // Everything once, a transaction per row
+  draw_clock(&fb, 12, 34);
+  CHECK(fb.flush() == 2 * LCD_FB_COLS);
+  CHECK(lcd.transactions.size() == 2);
+  CHECK(same(lcd.transactions[0], 0, 0, "Sat 17 Oct 12:34"));
+  CHECK(same(lcd.transactions[1], 0, 1, "Alarm: 06:30    "));
+  CHECK(shows(lcd, fb));
+  uint32_t full = lcd.bytes;
+
+  // The same frame drawn again on every tick puts nothing on the bus
+  lcd.transactions.clear();
+  lcd.bytes = 0;
+  for (int tick = 0; tick < 120; tick++) {
+    draw_clock(&fb, 12, 34);
+    CHECK(fb.flush() == 0);
+  }
+  CHECK(lcd.transactions.empty() && lcd.bytes == 0);
+
+  // A new minute is one cell, with the cursor command
+  draw_clock(&fb, 12, 35);
+  uint32_t minute = lcd.bytes;
+  CHECK(fb.flush() == 1);
+  CHECK(lcd.transactions.size() == 1);
+  CHECK(same(lcd.transactions[0], 15, 0, "5"));
+  CHECK(shows(lcd, fb));
+  minute = lcd.bytes - minute;
+
+  // A new hour: 12:35 to 13:00 changes cells 12, 14 and 15. The unchanged
+  // ':' in between is sent again rather than starting a new transaction.
+  lcd.transactions.clear();
+  draw_clock(&fb, 13, 0);
+  CHECK(fb.flush() == 4);
+  CHECK(lcd.transactions.size() == 1);
+  CHECK(same(lcd.transactions[0], 12, 0, "3:00"));
+  CHECK(shows(lcd, fb));
+  printf("clock screen: %u bytes for the first frame, 0 for an unchanged "
+         "one, %u for a new minute\n",
+         full, minute);
+}
+
+static void test_gaps() {
+  DFRobot_RGBLCD1602 lcd;
+  LcdFrameBuffer fb(&lcd);
+  fb.flush();
+
+  // Two changed cells LCD_FB_MAX_GAP apart go in one run with the cells
+  // between them
+  char expected[LCD_FB_COLS + 1];
+  lcd.transactions.clear();
+  fb.setCursor(2, 0);
+  fb.write('a');
+  fb.setCursor(2 + LCD_FB_MAX_GAP + 1, 0);
+  fb.write('b');
+  CHECK(fb.flush() == LCD_FB_MAX_GAP + 2);
+  memset(expected, ' ', sizeof(expected));
+  expected[0] = 'a';
+  expected[LCD_FB_MAX_GAP + 1] = 'b';
+  expected[LCD_FB_MAX_GAP + 2] = '\0';
+  CHECK(lcd.transactions.size() == 1);
+  CHECK(same(lcd.transactions[0], 2, 0, expected));
+
+  // One cell further apart they are two runs, each with its cursor command
+  lcd.transactions.clear();
+  fb.setCursor(2, 0);
+  fb.write('c');
+  fb.setCursor(2 + LCD_FB_MAX_GAP + 2, 0);
+  fb.write('d');
+  CHECK(fb.flush() == 2);
+  CHECK(lcd.transactions.size() == 2);
+  CHECK(same(lcd.transactions[0], 2, 0, "c"));
+  CHECK(same(lcd.transactions[1], 2 + LCD_FB_MAX_GAP + 2, 0, "d"));
+
+  // A run that starts where the last one ended needs no cursor command
+  lcd.transactions.clear();
+  fb.setCursor(2 + LCD_FB_MAX_GAP + 3, 0);
+  fb.printf("ef");
+  CHECK(fb.flush() == 2);
+  CHECK(lcd.transactions.size() == 1);
+  CHECK(same(lcd.transactions[0], -1, 0, "ef"));
+
+  // The same column on the other row does
+  lcd.transactions.clear();
+  fb.setCursor(2 + LCD_FB_MAX_GAP + 5, 1);
+  fb.write('g');
+  CHECK(fb.flush() == 1);
+  CHECK(lcd.transactions.size() == 1);
+  CHECK(same(lcd.transactions[0], 2 + LCD_FB_MAX_GAP + 5, 1, "g"));
+  CHECK(shows(lcd, fb));
+
+  // Suspended, nothing is sent. Taken back, every cell is.
+  lcd.transactions.clear();
+  fb.suspend();
+  fb.clear();
+  CHECK(fb.flush() == 0 && lcd.transactions.empty());
+  fb.resume();
+  CHECK(fb.flush() == 2 * LCD_FB_COLS && lcd.transactions.size() == 2);
+  CHECK(shows(lcd, fb));
+}
+
+/*
+Random cells changed between flushes. Every run has to start and end on a
+changed cell and hold no more than LCD_FB_MAX_GAP unchanged ones in a row,
+and a changed cell may not be left out.
+*/
+static void test_random() {
+  DFRobot_RGBLCD1602 lcd;
+  LcdFrameBuffer fb(&lcd);
+  fb.flush();
+  std::minstd_rand random(2);
+  int wrong = 0, differ = 0;
+  size_t runs = 0;
+  int col = 0, row = 0; // the display's cursor, from one flush to the next
+  for (int frame = 0; frame < 20000; frame++) {
+    char before[LCD_FB_ROWS][LCD_FB_COLS];
+    memcpy(before, lcd.ddram, sizeof(before));
+    int changes = random() % 6;
+    for (int i = 0; i < changes; i++) {
+      fb.setCursor(random() % LCD_FB_COLS, random() % LCD_FB_ROWS);
+      fb.write('a' + random() % 3);
+    }
+    lcd.transactions.clear();
+    fb.flush();
+    runs += lcd.transactions.size();
+
+    bool sent[LCD_FB_ROWS][LCD_FB_COLS] = {};
+    for (const Transaction &t : lcd.transactions) {
+      if (t.col >= 0) {
+        col = t.col;
+        row = t.row;
+      }
+      int gap = 0;
+      for (size_t i = 0; i < t.data.size(); i++, col++) {
+        bool changed = t.data[i] != before[row][col];
+        gap = changed ? 0 : gap + 1;
+        if ((i == 0 || i == t.data.size() - 1) && !changed) {
+          wrong++;
+        }
+        if (gap > LCD_FB_MAX_GAP) {
+          wrong++;
+        }
+        sent[row][col] = true;
+      }
+    }
+    for (int r = 0; r < LCD_FB_ROWS; r++) {
+      for (int c = 0; c < LCD_FB_COLS; c++) {
+        if (fb.row(r)[c] != before[r][c] && !sent[r][c]) {
+          wrong++;
+        }
+      }
+    }
+    differ += !shows(lcd, fb);
+  }
+  CHECK(wrong == 0 && differ == 0);
+  printf("20000 random frames: %zu transactions\n", runs);
+}
+
+int main() {
+  test_clock();
+  test_gaps();
+  test_random();
+  return check_result();
+}
@@ -0,0 +1,148 @@
+/**
+ * @file test_rss_parser.cpp
+ * @brief Replays a recorded BBC feed through RssParser in chunks of every
+ * size a socket might return, and reports how much of it had to be read.
+ */
+#include "check.h"
+#include "fixture.h"
+#include "rss_parser.h"
+
+#include <random>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// The titles as a plain search over the whole document finds them
+static void expected_titles(const std::string &doc, int max_items,
+                            std::string *source,
+                            std::vector<std::string> *headlines) {
+  const std::string open = "<title><![CDATA[", close = "]]></title>";
+  size_t pos = doc.find("<channel>");
+  size_t start = doc.find(open, pos) + open.size();
+  *source = doc.substr(start, doc.find(close, start) - start);
+  pos = start;
+  while ((int)headlines->size() < max_items &&
+         (pos = doc.find("<item>", pos)) != std::string::npos) {
+    start = doc.find(open, pos) + open.size();
+    pos = doc.find(close, start);
+    headlines->push_back(doc.substr(start, pos - start));
+  }
+}
+
+// Feeds the document in chunks from next_size() until the parser is done
+template <typename F>
+static size_t replay(const std::string &doc, RssParser *parser, F next_size) {
+  size_t offset = 0;
+  while (offset < doc.size() && !parser->done()) {
+    size_t n = next_size();
+    if (n > doc.size() - offset) {
+      n = doc.size() - offset;
+    }
+    parser->parse(doc.data() + offset, n);
+    offset += n;
+  }
+  return offset;
+}
+
+static bool same(const RssFeed &feed, const std::string &source,
+                 const std::vector<std::string> &headlines) {
+  if (source != feed.source || feed.headline_count != (int)headlines.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < headlines.size(); i++) {
+    if (headlines[i] != feed.headlines[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void test_feed(const std::string &doc) {
+  std::string source;
+  std::vector<std::string> headlines;
+  expected_titles(doc, RSS_MAX_HEADLINES, &source, &headlines);
+  CHECK(source == "BBC News");
+  CHECK(headlines.size() == RSS_MAX_HEADLINES);
+
+  RssFeed feed;
+  int lost = 0;
+  for (size_t chunk = 1; chunk <= 1460; chunk++) {
+    RssParser parser(&feed);
+    replay(doc, &parser, [chunk] { return chunk; });
+    if (!parser.done() || !same(feed, source, headlines)) {
+      lost++;
+    }
+  }
+  CHECK(lost == 0);
+
+  // Chunk sizes as uneven as TLS records and TCP segments make them
+  std::mt19937 rng(1);
+  for (int run = 0; run < 2000; run++) {
+    RssParser parser(&feed);
+    replay(doc, &parser, [&rng] { return (size_t)(1 + rng() % 700); });
+    if (!parser.done() || !same(feed, source, headlines)) {
+      lost++;
+    }
+  }
+  CHECK(lost == 0);
+  printf("%d headlines, lost in %d of 3460 replays\n", RSS_MAX_HEADLINES, lost);
+}
+
+static void test_edges() {
+  // "]]" inside a title, and a title tag opened twice
+  const std::string doc =
+      "<rss><channel><title><![CDATA[BBC News - World]]></title>"
+      "<item><title><![CDATA[First ]]]] headline]]></title></item>"
+      "<item><title><title><![CDATA[Second]]></title></item>"
+      "<item><title><![CDATA[Third one]]></title></item>"
+      "<item><title><![CDATA[Fourth]]></title></item></channel></rss>";
+  RssFeed feed;
+  for (size_t chunk = 1; chunk < doc.size(); chunk++) {
+    RssParser parser(&feed, 3);
+    replay(doc, &parser, [chunk] { return chunk; });
+    CHECK(parser.done());
+    CHECK(strcmp(feed.source, "BBC News - World") == 0);
+    CHECK(strcmp(feed.headlines[0], "First ]]]] headline") == 0);
+    CHECK(strcmp(feed.headlines[1], "Second") == 0);
+    CHECK(strcmp(feed.headlines[2], "Third one") == 0);
+  }
+
+  // A title longer than the buffer is cut, the next one is still found
+  std::string long_doc = "<channel><title><![CDATA[" +
+                         std::string(400, 'x') +
+                         "]]></title><item><title><![CDATA[After]]></title>";
+  RssParser parser(&feed, 1);
+  parser.parse(long_doc.data(), long_doc.size());
+  CHECK(parser.done());
+  CHECK(strlen(feed.source) == RSS_TEXT_SIZE - 1);
+  CHECK(strcmp(feed.headlines[0], "After") == 0);
+
+  // Nothing more is consumed once done
+  size_t used = parser.parse("<item>", 6);
+  CHECK(used == 0);
+}
+
+static void bench(const std::string &doc) {
+  RssFeed feed;
+  printf("feed %zu bytes\n", doc.size());
+  for (size_t chunk : {1, 64, 512, 1460}) {
+    size_t read = 0;
+    double ns = bench_ns(200, [&] {
+      RssParser parser(&feed);
+      read = replay(doc, &parser, [chunk] { return chunk; });
+    });
+    printf("chunk %4zu: %5zu bytes read, %4zu per headline, %6.1f us\n", chunk,
+           read, read / feed.headline_count, ns / 1000);
+  }
+}
+
+int main() {
+  std::string doc = read_fixture("bbc_world.xml");
+  CHECK(!doc.empty());
+  if (!doc.empty()) {
+    test_feed(doc);
+    bench(doc);
+  }
+  test_edges();
+  return check_result();
+}
@@ -0,0 +1,165 @@
+/**
+ * @file test_sample_history.cpp
+ * @brief SampleHistory against a brute force pass over every raw sample,
+ * with uneven rates and gaps in the samples, and what it costs per sample
+ * and in memory.
+ */
+#include "check.h"
+#include "sample_history.h"
+
+#include <random>
+#include <vector>
+
+struct Expected {
+  uint32_t count;
+  int16_t min;
+  int16_t max;
+  int64_t sum;
+};
+
+// Samples whose bucket of the given width is one of the last n up to now
+static Expected brute_force(const std::vector<EnvSample> &samples, time_t now,
+                            time_t width, time_t n, bool humidity) {
+  Expected e = {0, INT16_MAX, INT16_MIN, 0};
+  time_t first = now - now % width - (n - 1) * width;
+  for (const EnvSample &s : samples) {
+    if (s.time < first) {
+      continue;
+    }
+    int16_t value = humidity ? (int16_t)s.humidity : s.temperature;
+    e.count++;
+    e.min = value < e.min ? value : e.min;
+    e.max = value > e.max ? value : e.max;
+    e.sum += value;
+  }
+  return e;
+}
+
+static bool matches(const StatSummary &s, const Expected &e) {
+  if (s.count != e.count || s.sum != e.sum) {
+    return false;
+  }
+  return e.count == 0 || (s.min == e.min && s.max == e.max);
+}
+
+static int check_windows(const SampleHistory &history,
+                         const std::vector<EnvSample> &samples, time_t now) {
+  int wrong = 0;
+  const time_t widths[] = {1, 60, 3600};
+  const time_t counts[] = {HISTORY_SECONDS, HISTORY_MINUTES, HISTORY_HOURS};
+  for (int w = SampleHistory::MINUTE; w <= SampleHistory::DAY; w++) {
+    for (bool humidity : {false, true}) {
+      StatSummary s;
+      if (humidity) {
+        history.humidity((SampleHistory::Window)w, &s);
+      } else {
+        history.temperature((SampleHistory::Window)w, &s);
+      }
+      if (!matches(s, brute_force(samples, now, widths[w], counts[w],
+                                  humidity))) {
+        wrong++;
+      }
+    }
+  }
+  return wrong;
+}
+
+static void test_against_brute_force() {
+  std::mt19937 rng(7);
+  SampleHistory history;
+  std::vector<EnvSample> samples;
+  time_t t = 1700000000 + 1234;
+  int checks = 0, wrong = 0;
+
+  // Two days at 1, 12.5 and 0.2 Hz, with gaps of seconds up to a few hours
+  while (t < 1700000000 + 2 * 86400) {
+    int rate = rng() % 3;
+    int burst = 1 + rng() % 400;
+    for (int i = 0; i < burst; i++) {
+      EnvSample s;
+      s.time = t;
+      s.temperature = (int16_t)(1500 + (int)(rng() % 1500) - 500);
+      s.humidity = (uint16_t)(rng() % 1001);
+      history.add(s);
+      samples.push_back(s);
+
+      if (rng() % 50 == 0) {
+        wrong += check_windows(history, samples, t);
+        checks++;
+      }
+      t += rate == 0 ? 1 : rate == 1 ? (rng() % 8 == 0) : 5;
+    }
+    switch (rng() % 20) {
+    case 0:
+      t += 1 + rng() % 120;
+      break;
+    case 1:
+      t += 3600 + rng() % 7200;
+      break;
+    }
+    // The brute force only needs the last day
+    if (samples.size() > 200000) {
+      samples.erase(samples.begin(), samples.begin() + 100000);
+    }
+  }
+  CHECK(wrong == 0);
+  CHECK(checks > 1000);
+  printf("%d checkpoints, %d windows differ from brute force\n", checks,
+         wrong);
+
+  // After more than a day without samples every window is empty
+  EnvSample s = {t + 2 * 86400, 2000, 500};
+  history.add(s);
+  StatSummary day;
+  history.temperature(SampleHistory::DAY, &day);
+  CHECK(day.count == 1 && day.min == 2000 && day.max == 2000);
+}
+
+static void test_window_edges() {
+  // One sample a second for two minutes, the minute is the last 60 of them
+  SampleHistory history;
+  for (time_t t = 0; t < 120; t++) {
+    EnvSample s = {1000 * 3600 + t, (int16_t)t, 0};
+    history.add(s);
+  }
+  StatSummary minute;
+  history.temperature(SampleHistory::MINUTE, &minute);
+  CHECK(minute.count == HISTORY_SECONDS);
+  CHECK(minute.min == 120 - HISTORY_SECONDS && minute.max == 119);
+}
+
+static void bench() {
+  // Cost per sample when the windows are empty and when they are full
+  SampleHistory history;
+  EnvSample s = {1700000000, 2000, 500};
+  volatile int16_t value = 0;
+  double first_ns = bench_ns(1000, [&] {
+    s.temperature = value++;
+    history.add(s);
+    s.time++;
+  });
+  for (int i = 0; i < 3 * 86400; i++) {
+    history.add(s);
+    s.time++;
+  }
+  double full_ns = bench_ns(1000000, [&] {
+    s.temperature = value++;
+    history.add(s);
+    s.time++;
+  });
+  printf("add at 1 Hz: %.1f ns with empty windows, %.1f ns with full ones\n",
+         first_ns, full_ns);
+
+  // Every raw sample of a day at 1 Hz against the summaries
+  printf("SampleHistory %zu bytes, %zu per hour of the day window; "
+         "a day of raw samples at 1 Hz would be %zu bytes\n",
+         sizeof(SampleHistory), sizeof(SampleHistory) / HISTORY_HOURS,
+         (size_t)86400 * sizeof(EnvSample));
+}
+
+int main() {
+  test_against_brute_force();
+  test_window_edges();
+  bench();
+  return check_result();
+}
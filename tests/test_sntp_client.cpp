@@ -0,0 +1,154 @@
+/**
+ * @file test_sntp_client.cpp
+ * @brief SntpClient against an in-process SNTP server over the UDPSocket
+ * stand-in: how close it sets the RTC with symmetric, asymmetric and
+ * jittery paths, the drift it measures between syncs, and the answers it
+ * has to refuse.
+ */
+#include "check.h"
+#include "dns_cache.h"
+#include "sntp_client.h"
+#include "sntp_server.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static void test_step(SntpClient *sntp, SntpServer *server) {
+  // 7.3 s behind on a symmetric path
+  set_rtc_off(*server, 7300);
+  SntpResult result;
+  CHECK(sntp->sync("pool.ntp.org", &result) == NSAPI_ERROR_OK);
+  CHECK(result.stepped && result.stratum == 2);
+  CHECK(llabs(result.offset_ms - 7300) <= 2);
+  CHECK(result.delay_ms == 40);
+  CHECK(result.time == time(NULL));
+  CHECK(fabs(rtc_behind_ms(*server)) <= 2);
+
+  // Close enough is left alone
+  set_rtc_off(*server, 10);
+  CHECK(sntp->sync("pool.ntp.org", &result) == NSAPI_ERROR_OK);
+  CHECK(!result.stepped && llabs(result.offset_ms - 10) <= 2);
+
+  // With 40 ms more on the way there than back, the answer is taken to be
+  // 20 ms older than it is and the RTC is set that much ahead
+  server->to_server = 60ms;
+  set_rtc_off(*server, -5000);
+  CHECK(sntp->sync("pool.ntp.org", &result) == NSAPI_ERROR_OK);
+  CHECK(result.stepped);
+  CHECK(fabs(rtc_behind_ms(*server) + 20) <= 2);
+  server->to_server = 20ms;
+}
+
+// Syncs at random offsets and phases with up to 40 ms added each way
+static void test_jitter(SntpClient *sntp, SntpServer *server) {
+  server->jitter = 40ms;
+  std::minstd_rand random(22);
+  const int syncs = 50;
+  double total = 0, worst = 0;
+  for (int i = 0; i < syncs; i++) {
+    host::skip(std::chrono::microseconds(random() % 1000000));
+    set_rtc_off(*server, (int64_t)(random() % 20000) - 10000);
+    SntpResult result;
+    CHECK(sntp->sync("pool.ntp.org", &result) == NSAPI_ERROR_OK);
+    double error = fabs(rtc_behind_ms(*server));
+    total += error;
+    worst = error > worst ? error : worst;
+  }
+  // The RTC is left as it is up to SNTP_STEP_LIMIT_MS, on top of which the
+  // best of SNTP_SAMPLES round trips can be up to 40 ms lopsided
+  CHECK(worst <= SNTP_STEP_LIMIT_MS + 20 + 2);
+  printf("%d syncs, 20 ms each way plus up to 40 ms jitter: RTC off by "
+         "%.1f ms on average, %.1f ms at most\n",
+         syncs, total / syncs, worst);
+  server->jitter = 0us;
+}
+
+// An RTC 50 ppm slow, synced two hours apart
+static void test_drift(NetworkInterface *network, DnsCache *dns,
+                       SntpServer *server) {
+  SntpClient sntp(network, dns);
+  host::rtc_drift(-50);
+  set_rtc_off(*server, 3000);
+  SntpResult first, second, third;
+  CHECK(sntp.sync("pool.ntp.org", &first) == NSAPI_ERROR_OK);
+  CHECK(first.drift_ppm == 0 && first.elapsed_ms == 0);
+
+  host::skip(2h);
+  CHECK(sntp.sync("pool.ntp.org", &second) == NSAPI_ERROR_OK);
+  CHECK(fabs(second.drift_ppm - 50) < 1);
+  CHECK(second.stepped && llabs(second.offset_ms - 360) <= 3);
+  // Two hours and the few seconds the first sync took
+  CHECK(llabs(second.elapsed_ms - 7200000) <= 3000);
+  CHECK(llabs(second.drift_total_ms - 360) <= 3);
+
+  // Too soon after the last one to say anything about the rate, but it
+  // still counts towards the totals
+  host::skip(5min);
+  CHECK(sntp.sync("pool.ntp.org", &third) == NSAPI_ERROR_OK);
+  CHECK(third.drift_ppm == 0);
+  CHECK(llabs(third.drift_total_ms - 375) <= 4);
+  printf("50 ppm slow RTC over 2 h: measured %.2f ppm, %lld ms behind\n",
+         second.drift_ppm, (long long)second.drift_total_ms);
+  host::rtc_drift(0);
+}
+
+static void test_refused(NetworkInterface *network, DnsCache *dns,
+                         SntpServer *server) {
+  SntpClient sntp(network, dns);
+  SntpResult result;
+  set_rtc_off(*server, 2000);
+
+  // Every answer wrong in one way, the RTC is left alone and the name is
+  // looked up again next time
+  for (int i = 0; i < 4; i++) {
+    server->leap = i == 0 ? 3 : 0;
+    server->stratum = i == 1 ? 0 : 2;
+    server->mode = i == 2 ? 5 : 4;
+    server->zero_transmit = i == 3;
+    uint32_t rejected = sntp.stats().rejected;
+    time_t rtc = time(NULL);
+    CHECK(sntp.sync("pool.ntp.org", &result) == NSAPI_ERROR_DEVICE_ERROR);
+    CHECK(sntp.stats().rejected == rejected + SNTP_SAMPLES);
+    CHECK(time(NULL) - rtc < 2 + SNTP_SAMPLES);
+    uint32_t lookups = network->lookups;
+    sntp.sync("pool.ntp.org", &result);
+    CHECK(network->lookups == lookups + 1);
+  }
+  server->leap = 0;
+  server->stratum = 2;
+  server->mode = 4;
+  server->zero_transmit = false;
+
+  // No answers at all
+  server->drop = SNTP_SAMPLES;
+  CHECK(sntp.sync("pool.ntp.org", &result) == NSAPI_ERROR_WOULD_BLOCK);
+  CHECK(sntp.stats().timeouts == SNTP_SAMPLES);
+
+  // The first answer comes after its query timed out, ahead of the second
+  // one's, and is passed over while the second query waits for its own
+  server->late = 1;
+  uint32_t rejected = sntp.stats().rejected;
+  set_rtc_off(*server, 2000);
+  CHECK(sntp.sync("pool.ntp.org", &result) == NSAPI_ERROR_OK);
+  CHECK(sntp.stats().timeouts == SNTP_SAMPLES + 1);
+  CHECK(sntp.stats().rejected == rejected + 1);
+  CHECK(fabs(rtc_behind_ms(*server)) <= 2);
+
+  CHECK(sntp.sync("no.such.pool", &result) == NSAPI_ERROR_DNS_FAILURE);
+}
+
+int main() {
+  host::simulate();
+  NetworkInterface network;
+  DnsCache dns(&network);
+  SntpServer server;
+  host::serve_udp("pool.ntp.org", &server);
+  SntpClient sntp(&network, &dns);
+
+  test_step(&sntp, &server);
+  test_jitter(&sntp, &server);
+  test_drift(&network, &dns, &server);
+  test_refused(&network, &dns, &server);
+  host::serve_udp("pool.ntp.org", nullptr);
+  return check_result();
+}
@@ -0,0 +1,256 @@
+/**
+ * @file test_time_zone.cpp
+ * @brief TimeZone against the host's tz database in /usr/share/zoneinfo for
+ * every zone in its table, hour by hour and at each transition from 2017 to
+ * 2037, civil_time() against gmtime_r(), and the cost of a lookup compared
+ * with localtime_r().
+ */
+#include "check.h"
+#include "time_zone.h"
+
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+
+// Every zone in the table in time_zone.cpp
+static const char *const zones[] = {
+    "UTC",
+    "Europe/London",
+    "Europe/Dublin",
+    "Europe/Lisbon",
+    "Atlantic/Canary",
+    "Atlantic/Reykjavik",
+    "Europe/Oslo",
+    "Arctic/Longyearbyen",
+    "Europe/Stockholm",
+    "Europe/Copenhagen",
+    "Europe/Berlin",
+    "Europe/Amsterdam",
+    "Europe/Brussels",
+    "Europe/Luxembourg",
+    "Europe/Paris",
+    "Europe/Madrid",
+    "Europe/Rome",
+    "Europe/Malta",
+    "Europe/Zurich",
+    "Europe/Vienna",
+    "Europe/Prague",
+    "Europe/Bratislava",
+    "Europe/Warsaw",
+    "Europe/Budapest",
+    "Europe/Ljubljana",
+    "Europe/Zagreb",
+    "Europe/Belgrade",
+    "Europe/Helsinki",
+    "Europe/Tallinn",
+    "Europe/Riga",
+    "Europe/Vilnius",
+    "Europe/Kyiv",
+    "Europe/Kiev",
+    "Europe/Bucharest",
+    "Europe/Sofia",
+    "Europe/Athens",
+    "Europe/Istanbul",
+    "Europe/Moscow",
+    "America/St_Johns",
+    "America/Halifax",
+    "America/New_York",
+    "America/Toronto",
+    "America/Detroit",
+    "America/Chicago",
+    "America/Winnipeg",
+    "America/Denver",
+    "America/Edmonton",
+    "America/Phoenix",
+    "America/Los_Angeles",
+    "America/Vancouver",
+    "America/Anchorage",
+    "Pacific/Honolulu",
+    "Asia/Dubai",
+    "Asia/Kolkata",
+    "Asia/Kathmandu",
+    "Asia/Singapore",
+    "Asia/Shanghai",
+    "Asia/Hong_Kong",
+    "Asia/Seoul",
+    "Asia/Tokyo",
+    "Australia/Perth",
+    "Australia/Darwin",
+    "Australia/Adelaide",
+    "Australia/Brisbane",
+    "Australia/Sydney",
+    "Australia/Melbourne",
+    "Australia/Hobart",
+    "Pacific/Auckland",
+};
+
+static const time_t from = 1483228800; // 2017-01-01
+static const time_t until = 2145916800; // 2038-01-01
+
+static void use_system_zone(const char *name) {
+  setenv("TZ", name, 1);
+  tzset();
+}
+
+static int32_t system_offset(time_t utc) {
+  struct tm tm;
+  localtime_r(&utc, &tm);
+  return (int32_t)tm.tm_gmtoff;
+}
+
+static bool have_zoneinfo(const char *name) {
+  std::string path = std::string("/usr/share/zoneinfo/") + name;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file) {
+    fclose(file);
+  }
+  return file != nullptr;
+}
+
+/*
+Hour by hour, both go forward together. Each change the system shows is
+then found to the second and checked against next_transition(), and a
+second either side of it.
+*/
+static void test_zones() {
+  int checked = 0, differ = 0, transitions = 0, missed = 0;
+  for (const char *name : zones) {
+    if (!have_zoneinfo(name)) {
+      printf("%s: not in the host's zoneinfo, skipped\n", name);
+      continue;
+    }
+    checked++;
+    use_system_zone(name);
+    TimeZone zone;
+    CHECK(zone.set(name, 12345));
+    int zone_differ = 0;
+    int32_t last = system_offset(from);
+    for (time_t t = from; t < until; t += 3600) {
+      int32_t want = system_offset(t);
+      if (want != last) {
+        // Between t - 1 h and t, to the second
+        time_t lo = t - 3600, hi = t;
+        while (hi - lo > 1) {
+          time_t mid = lo + (hi - lo) / 2;
+          (system_offset(mid) == last ? lo : hi) = mid;
+        }
+        transitions++;
+        TimeZone seek;
+        seek.set(name, 0);
+        seek.offset(hi - 1);
+        if (seek.next_transition() != hi || seek.offset(hi) != want ||
+            seek.offset(hi - 1) != last) {
+          missed++;
+        }
+        last = want;
+      }
+      if (zone.offset(t) != want) {
+        zone_differ++;
+      }
+    }
+    if (zone_differ) {
+      printf("%s: %d hours differ\n", name, zone_differ);
+    }
+    differ += zone_differ;
+  }
+  CHECK(differ == 0 && missed == 0);
+  CHECK(checked > 0);
+  printf("%d zones, 2017-2037 hourly against zoneinfo: %d hours differ, "
+         "%d of %d transitions wrong\n",
+         checked, differ, missed, transitions);
+  unsetenv("TZ");
+  tzset();
+}
+
+static void test_civil() {
+  std::minstd_rand random(24);
+  int differ = 0;
+  for (int i = 0; i < 200000; i++) {
+    // 1901 to 2105, and the days around the epoch and the 2038 wrap
+    time_t t = (time_t)(random() % 6400000000LL) - 2140000000LL;
+    if (i < 2000) {
+      t = (i % 2 ? 0 : 2147483647) + (i / 2 - 500) * 3600 + 59;
+    }
+    CivilTime civil;
+    civil_time(t, &civil);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    if (civil.year != tm.tm_year + 1900 || civil.month != tm.tm_mon + 1 ||
+        civil.day != tm.tm_mday || civil.hour != tm.tm_hour ||
+        civil.minute != tm.tm_min || civil.second != tm.tm_sec ||
+        civil.weekday != tm.tm_wday) {
+      differ++;
+    }
+  }
+  CHECK(differ == 0);
+  CHECK(strcmp(civil_weekdays[4], "Thu") == 0);
+  CHECK(strcmp(civil_months[9], "Oct") == 0);
+}
+
+static void test_table() {
+  // Unknown names keep the offset they were given
+  TimeZone zone;
+  CHECK(!zone.set("Mars/Olympus_Mons", -7200));
+  CHECK(zone.offset(from) == -7200 && zone.next_transition() == 0);
+  CHECK(strcmp(zone.name(), "Mars/Olympus_Mons") == 0);
+
+  // Going forward redoes the table once every TZ_YEARS, going back each
+  // time the clock crosses a transition backwards
+  CHECK(zone.set("Europe/Oslo", 0));
+  for (time_t t = from; t < until; t += 3600) {
+    zone.offset(t);
+  }
+  CHECK(zone.rebuilds() == (2038 - 2017 + TZ_YEARS - 1) / TZ_YEARS);
+  uint32_t rebuilds = zone.rebuilds();
+  CHECK(zone.offset(1793491200) == 3600);              // 1 November 2026
+  CHECK(zone.offset(1793491200 - 30 * 86400) == 7200); // 2 October
+  CHECK(zone.rebuilds() == rebuilds + 2);
+
+  // Local time of the switches in Oslo, 2026
+  CivilTime civil;
+  civil_time(zone.local(1774746000 - 1), &civil); // 29 March 01:00 UTC
+  CHECK(civil.hour == 1 && civil.minute == 59 && civil.second == 59);
+  civil_time(zone.local(1774746000), &civil);
+  CHECK(civil.hour == 3 && civil.minute == 0);
+  civil_time(zone.local(1792890000 - 1), &civil); // 25 October 01:00 UTC
+  CHECK(civil.hour == 2 && civil.minute == 59);
+  civil_time(zone.local(1792890000), &civil);
+  CHECK(civil.hour == 2 && civil.minute == 0);
+}
+
+/*
+A lookup a minute for 20 years, as the clock screen does, against
+localtime_r() with TZ set. Both get the same times in order.
+*/
+static void bench() {
+  const int lookups = 20 * 365 * 24 * 60;
+  use_system_zone("Europe/Oslo");
+  TimeZone zone;
+  zone.set("Europe/Oslo", 0);
+  int64_t sum[2] = {0, 0};
+  double ns[2];
+  ns[0] = bench_ns(1, [&] {
+    for (int i = 0; i < lookups; i++) {
+      sum[0] += zone.offset(from + (time_t)i * 60);
+    }
+  });
+  ns[1] = bench_ns(1, [&] {
+    for (int i = 0; i < lookups; i++) {
+      sum[1] += system_offset(from + (time_t)i * 60);
+    }
+  });
+  CHECK(sum[0] == sum[1]);
+  printf("offset() %.1f ns a lookup, localtime_r() %.1f ns, %u rebuilds and "
+         "%zu bytes of TimeZone\n",
+         ns[0] / lookups, ns[1] / lookups, zone.rebuilds(), sizeof(zone));
+  unsetenv("TZ");
+  tzset();
+}
+
+int main() {
+  test_zones();
+  test_civil();
+  test_table();
+  bench();
+  return check_result();
+}
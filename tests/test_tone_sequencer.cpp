@@ -0,0 +1,175 @@
+/**
+ * @file test_tone_sequencer.cpp
+ * @brief The PWM writes of ToneSequencer turned into a timeline and checked
+ * millisecond by millisecond against the note tables, for the patterns in
+ * tone_patterns.h and a few made for the test.
+ */
+#include "check.h"
+#include "tone_patterns.h"
+#include "tone_sequencer.h"
+
+struct Output {
+  int period_us;
+  int pulsewidth_us; // 0 is silent
+};
+
+/*
+What the output should be t_ms into the pattern, straight from the tables:
+a ramp holds each duty for TONE_RAMP_STEP_MS, and every round is played at
+its level. False once the pattern is over.
+*/
+static bool expected_at(const TonePattern &pattern, int64_t t_ms,
+                        Output *out) {
+  for (int round = 0; pattern.repeats == 0 || round < pattern.repeats;
+       round++) {
+    int level = pattern.start_level + round * pattern.level_step;
+    level = level < 100 ? level : 100;
+    for (int i = 0; i < pattern.count; i++) {
+      const Note &note = pattern.notes[i];
+      if (t_ms >= note.duration_ms) {
+        t_ms -= note.duration_ms;
+        continue;
+      }
+      int elapsed = t_ms / TONE_RAMP_STEP_MS * TONE_RAMP_STEP_MS;
+      int duty = note.duty +
+                 (note.duty_end - note.duty) * elapsed / note.duration_ms;
+      out->period_us = note.frequency ? 1000000 / note.frequency : 0;
+      out->pulsewidth_us = out->period_us * (duty * level / 100) / 100;
+      return true;
+    }
+  }
+  *out = {0, 0};
+  return false;
+}
+
+// The output at a time, from the writes logged up to it
+static Output output_at(const PwmOut &pwm, int64_t us) {
+  Output out = {20000, 0};
+  for (const PwmOut::Change &change : pwm.log) {
+    if (change.us > us) {
+      break;
+    }
+    out = {change.period_us, change.pulsewidth_us};
+  }
+  return out;
+}
+
+/**
+ * @brief play pattern for ms and compare the timeline with the tables in
+ * the middle of every millisecond
+ * @return milliseconds that differ
+ */
+static int compare(const TonePattern &pattern, int ms, PwmOut *pwm) {
+  ToneSequencer tones(pwm);
+  pwm->log.clear();
+  int64_t start = host::now_us();
+  tones.play(&pattern);
+  host::skip(std::chrono::milliseconds(ms));
+  int differ = 0;
+  for (int t = 0; t < ms; t++) {
+    Output want, got = output_at(*pwm, start + t * 1000 + 500);
+    expected_at(pattern, t, &want);
+    if (got.pulsewidth_us != want.pulsewidth_us ||
+        (want.pulsewidth_us && got.period_us != want.period_us)) {
+      differ++;
+    }
+  }
+  CHECK(tones.playing() == (pattern.repeats == 0));
+  tones.stop();
+  return differ;
+}
+
+// Frequencies heard one after the other, the period is only written when
+// the next one differs
+static int frequency_changes(const PwmOut &pwm) {
+  int changes = 0, period_us = 0;
+  for (const PwmOut::Change &change : pwm.log) {
+    if (change.pulsewidth_us && change.period_us != period_us) {
+      period_us = change.period_us;
+      changes++;
+    }
+  }
+  return changes;
+}
+
+// One line per write, as the buzzer would be heard
+static void print_timeline(const PwmOut &pwm, int64_t start) {
+  for (const PwmOut::Change &change : pwm.log) {
+    int duty = change.pulsewidth_us * 100 / change.period_us;
+    printf("  %5lld ms  %5d Hz  %2d%%\n",
+           (long long)(change.us - start) / 1000, 1000000 / change.period_us,
+           duty);
+  }
+}
+
+// Odd lengths, ramps both ways and the ends of the range
+constexpr Note scale_notes[] = {
+    tone(262, 150),        tone(294, 150, 40),    rest(50),
+    tone(330, 150, 30),    ramp(349, 255, 5, 45), ramp(392, 95, 45, 0),
+    rest(1),               tone(20000, 7, 1),
+};
+constexpr TonePattern SCALE_PATTERN = tone_pattern(scale_notes, 3, 50, 30);
+static_assert(tone_pattern_valid(SCALE_PATTERN), "scale_notes");
+
+// Not playable, for the static_assert next to a table to catch
+constexpr Note loud_notes[] = {tone(TONE_BUZZER_HZ, 100, TONE_MAX_DUTY + 1)};
+constexpr Note silent_notes[] = {rest(0)};
+constexpr Note low_notes[] = {tone(19, 100)};
+static_assert(!tone_pattern_valid(tone_pattern(loud_notes, 1)), "loud");
+static_assert(!tone_pattern_valid(tone_pattern(silent_notes, 1)), "silent");
+static_assert(!tone_pattern_valid(tone_pattern(low_notes, 1)), "low");
+
+int main() {
+  host::simulate();
+  PwmOut pwm(NC);
+
+  // The confirm chirp, once, and silent after it
+  int64_t start = host::now_us();
+  CHECK(compare(CONFIRM_PATTERN, 300, &pwm) == 0);
+  CHECK(frequency_changes(pwm) == 2);
+  CHECK(pwm.log.back().pulsewidth_us == 0);
+  printf("confirm:\n");
+  print_timeline(pwm, start);
+
+  // Seven rounds of the alarm, getting louder up to full volume
+  int round_ms = 0;
+  for (const Note &note : alarm_notes) {
+    round_ms += note.duration_ms;
+  }
+  CHECK(compare(ALARM_PATTERN, 7 * round_ms, &pwm) == 0);
+  CHECK(frequency_changes(pwm) == 1);
+  printf("alarm: %zu PWM writes in 7 rounds of %d ms, level per round:",
+         pwm.log.size(), round_ms);
+  for (int round = 0; round < 7; round++) {
+    int loudest = 0;
+    for (const PwmOut::Change &change : pwm.log) {
+      int64_t t = (change.us - pwm.log[0].us) / 1000;
+      if (t >= round * round_ms && t < (round + 1) * round_ms &&
+          change.pulsewidth_us > loudest) {
+        loudest = change.pulsewidth_us;
+      }
+    }
+    printf(" %d%%", loudest * 100 / (500 * TONE_MAX_DUTY / 100));
+  }
+  printf("\n");
+
+  CHECK(compare(SCALE_PATTERN, 3000, &pwm) == 0);
+
+  // stop() silences at once and nothing is written after it; play()
+  // replaces what is playing
+  ToneSequencer tones(&pwm);
+  tones.play(&ALARM_PATTERN);
+  host::skip(130ms);
+  tones.play(&CONFIRM_PATTERN);
+  pwm.log.clear();
+  host::skip(30ms);
+  CHECK(pwm.log.empty());
+  host::skip(40ms);
+  CHECK(pwm.log.size() == 1 && pwm.log[0].pulsewidth_us == 0);
+  tones.stop();
+  CHECK(!tones.playing() && pwm.log.back().pulsewidth_us == 0);
+  size_t writes = pwm.log.size();
+  host::skip(10s);
+  CHECK(pwm.log.size() == writes);
+  return check_result();
+}
@@ -0,0 +1,232 @@
+/**
+ * @file time_zone.cpp
+ * @brief Zone rules and transition table, see time_zone.h
+ */
+#include "time_zone.h"
+
+#include <string.h>
+
+#define SECONDS_PER_DAY 86400
+// 1 January 1970 was a Thursday
+#define EPOCH_WEEKDAY 4
+
+struct TzZone {
+  const char *name;
+  int16_t standard_minutes; // east of UTC
+  const TzRules *rules;     // nullptr when there is no DST
+};
+
+// The EU switches everywhere at the same moment, 01:00 UTC
+static const TzRules tz_eu = {{3, 5, 0, 60, true}, {10, 5, 0, 60, true}, 60};
+static const TzRules tz_us = {{3, 2, 0, 120, false}, {11, 1, 0, 120, false},
+                              60};
+// Southern hemisphere, DST starts late in the year
+static const TzRules tz_au = {{10, 1, 0, 120, false}, {4, 1, 0, 180, false},
+                              60};
+static const TzRules tz_nz = {{9, 5, 0, 120, false}, {4, 1, 0, 180, false},
+                              60};
+
+static const TzZone tz_zones[] = {
+    {"UTC", 0, nullptr},
+    {"Europe/London", 0, &tz_eu},
+    {"Europe/Dublin", 0, &tz_eu},
+    {"Europe/Lisbon", 0, &tz_eu},
+    {"Atlantic/Canary", 0, &tz_eu},
+    {"Atlantic/Reykjavik", 0, nullptr},
+    {"Europe/Oslo", 60, &tz_eu},
+    {"Arctic/Longyearbyen", 60, &tz_eu},
+    {"Europe/Stockholm", 60, &tz_eu},
+    {"Europe/Copenhagen", 60, &tz_eu},
+    {"Europe/Berlin", 60, &tz_eu},
+    {"Europe/Amsterdam", 60, &tz_eu},
+    {"Europe/Brussels", 60, &tz_eu},
+    {"Europe/Luxembourg", 60, &tz_eu},
+    {"Europe/Paris", 60, &tz_eu},
+    {"Europe/Madrid", 60, &tz_eu},
+    {"Europe/Rome", 60, &tz_eu},
+    {"Europe/Malta", 60, &tz_eu},
+    {"Europe/Zurich", 60, &tz_eu},
+    {"Europe/Vienna", 60, &tz_eu},
+    {"Europe/Prague", 60, &tz_eu},
+    {"Europe/Bratislava", 60, &tz_eu},
+    {"Europe/Warsaw", 60, &tz_eu},
+    {"Europe/Budapest", 60, &tz_eu},
+    {"Europe/Ljubljana", 60, &tz_eu},
+    {"Europe/Zagreb", 60, &tz_eu},
+    {"Europe/Belgrade", 60, &tz_eu},
+    {"Europe/Helsinki", 120, &tz_eu},
+    {"Europe/Tallinn", 120, &tz_eu},
+    {"Europe/Riga", 120, &tz_eu},
+    {"Europe/Vilnius", 120, &tz_eu},
+    {"Europe/Kyiv", 120, &tz_eu},
+    {"Europe/Kiev", 120, &tz_eu},
+    {"Europe/Bucharest", 120, &tz_eu},
+    {"Europe/Sofia", 120, &tz_eu},
+    {"Europe/Athens", 120, &tz_eu},
+    {"Europe/Istanbul", 180, nullptr},
+    {"Europe/Moscow", 180, nullptr},
+    {"America/St_Johns", -210, &tz_us},
+    {"America/Halifax", -240, &tz_us},
+    {"America/New_York", -300, &tz_us},
+    {"America/Toronto", -300, &tz_us},
+    {"America/Detroit", -300, &tz_us},
+    {"America/Chicago", -360, &tz_us},
+    {"America/Winnipeg", -360, &tz_us},
+    {"America/Denver", -420, &tz_us},
+    {"America/Edmonton", -420, &tz_us},
+    {"America/Phoenix", -420, nullptr},
+    {"America/Los_Angeles", -480, &tz_us},
+    {"America/Vancouver", -480, &tz_us},
+    {"America/Anchorage", -540, &tz_us},
+    {"Pacific/Honolulu", -600, nullptr},
+    {"Asia/Dubai", 240, nullptr},
+    {"Asia/Kolkata", 330, nullptr},
+    {"Asia/Kathmandu", 345, nullptr},
+    {"Asia/Singapore", 480, nullptr},
+    {"Asia/Shanghai", 480, nullptr},
+    {"Asia/Hong_Kong", 480, nullptr},
+    {"Asia/Seoul", 540, nullptr},
+    {"Asia/Tokyo", 540, nullptr},
+    {"Australia/Perth", 480, nullptr},
+    {"Australia/Darwin", 570, nullptr},
+    {"Australia/Adelaide", 570, &tz_au},
+    {"Australia/Brisbane", 600, nullptr},
+    {"Australia/Sydney", 600, &tz_au},
+    {"Australia/Melbourne", 600, &tz_au},
+    {"Australia/Hobart", 600, &tz_au},
+    {"Pacific/Auckland", 720, &tz_nz},
+};
+
+// Days from 1970-01-01 to a date, and back (Howard Hinnant's algorithms,
+// counted in 400 year eras of 146097 days, March first)
+static int32_t days_from_civil(int32_t year, uint32_t month, uint32_t day) {
+  year -= month <= 2;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  uint32_t year_of_era = (uint32_t)(year - era * 400);
+  uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                         day - 1;
+  uint32_t day_of_era =
+      year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + (int32_t)day_of_era - 719468;
+}
+
+static int32_t weekday_of(int32_t days) {
+  return (days % 7 + 7 + EPOCH_WEEKDAY) % 7;
+}
+
+void civil_time(time_t t, CivilTime *civil) {
+  int32_t days = (int32_t)(t / SECONDS_PER_DAY);
+  int32_t seconds = (int32_t)(t % SECONDS_PER_DAY);
+  if (seconds < 0) {
+    seconds += SECONDS_PER_DAY;
+    days--;
+  }
+  civil->hour = seconds / 3600;
+  civil->minute = seconds / 60 % 60;
+  civil->second = seconds % 60;
+  civil->weekday = weekday_of(days);
+
+  days += 719468;
+  int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  uint32_t day_of_era = (uint32_t)(days - era * 146097);
+  uint32_t year_of_era = (day_of_era - day_of_era / 1460 +
+                          day_of_era / 36524 - day_of_era / 146096) /
+                         365;
+  uint32_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  uint32_t mp = (5 * day_of_year + 2) / 153;
+  civil->day = day_of_year - (153 * mp + 2) / 5 + 1;
+  civil->month = mp < 10 ? mp + 3 : mp - 9;
+  civil->year = (int32_t)year_of_era + era * 400 + (civil->month <= 2);
+}
+
+static bool leap_year(int32_t year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// UTC of a rule's switch in a year, offset is the one in force before it
+static time_t rule_time(const TzRule &rule, int32_t year, int32_t offset) {
+  static const uint8_t month_days[] = {31, 28, 31, 30, 31, 30,
+                                       31, 31, 30, 31, 30, 31};
+  int32_t first = days_from_civil(year, rule.month, 1);
+  int32_t day = 1 + (rule.weekday - weekday_of(first) + 7) % 7;
+  day += 7 * (rule.week - 1);
+  int32_t length =
+      month_days[rule.month - 1] + (rule.month == 2 && leap_year(year));
+  while (day > length) {
+    day -= 7;
+  }
+  time_t t = (time_t)(first + day - 1) * SECONDS_PER_DAY + rule.minute * 60;
+  return rule.utc ? t : t - offset;
+}
+
+TimeZone::TimeZone()
+    : _standard(0), _rules(nullptr), _count(0), _cursor(0), _before(0),
+      _from(0), _until(0), _rebuilds(0) {
+  strcpy(_name, "UTC");
+}
+
+bool TimeZone::set(const char *name, int32_t fallback_offset) {
+  strncpy(_name, name, sizeof(_name) - 1);
+  _name[sizeof(_name) - 1] = '\0';
+  _standard = fallback_offset;
+  _rules = nullptr;
+  _count = 0;
+  _cursor = 0;
+  _before = fallback_offset;
+  for (const TzZone &zone : tz_zones) {
+    if (strcmp(zone.name, name) == 0) {
+      _standard = zone.standard_minutes * 60;
+      _before = _standard;
+      _rules = zone.rules;
+      // The table is worked out on the first lookup, for its year
+      _from = 0;
+      _until = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t TimeZone::offset(time_t utc) {
+  if (!_rules) {
+    return _before;
+  }
+  // The clock was set back past the transition the cursor is at, or on
+  // beyond the table
+  if (utc < _from || utc >= _until ||
+      (_cursor > 0 && utc < _transitions[_cursor - 1].utc)) {
+    rebuild(utc);
+  }
+  while (_cursor < _count && utc >= _transitions[_cursor].utc) {
+    _cursor++;
+  }
+  return _cursor == 0 ? _before : _transitions[_cursor - 1].offset;
+}
+
+time_t TimeZone::next_transition() const {
+  return _cursor < _count ? _transitions[_cursor].utc : 0;
+}
+
+void TimeZone::rebuild(time_t utc) {
+  CivilTime civil;
+  civil_time(utc, &civil);
+  int32_t year = civil.year;
+  int32_t daylight = _standard + _rules->save_minutes * 60;
+
+  _count = 0;
+  for (int32_t y = year; y < year + TZ_YEARS; y++) {
+    TzTransition start = {rule_time(_rules->start, y, _standard), daylight};
+    TzTransition end = {rule_time(_rules->end, y, daylight), _standard};
+    bool start_first = start.utc < end.utc;
+    _transitions[_count++] = start_first ? start : end;
+    _transitions[_count++] = start_first ? end : start;
+  }
+  // The rules are the same every year, so the year begins with the offset
+  // it ends with
+  _before = _transitions[1].offset;
+  _from = (time_t)days_from_civil(year, 1, 1) * SECONDS_PER_DAY;
+  _until = (time_t)days_from_civil(year + TZ_YEARS, 1, 1) * SECONDS_PER_DAY;
+  _cursor = 0;
+  _rebuilds++;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file time_zone.h
+ * @brief UTC to local time from the DST rules of a zone, compiled into flash,
+ * so the clock changes at the DST switch instead of when the location is
+ * fetched again. Also a calendar split of a time_t that stands in for
+ * localtime().
+ */
+#ifndef __TIME_ZONE_H__
+#define __TIME_ZONE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Years of transitions worked out at a time. The table is redone when the
+// time leaves them, once every few years or when the clock is set back.
+#define TZ_YEARS 4
+#define TZ_TRANSITIONS (2 * TZ_YEARS)
+
+#define TZ_NAME_SIZE 40
+
+// One switch a year, e.g. the last Sunday of March at 01:00 UTC
+struct TzRule {
+  uint8_t month;   // 1-12
+  uint8_t week;    // 1-4, 5 is the last one in the month
+  uint8_t weekday; // 0 is Sunday
+  int16_t minute;  // of the day
+  bool utc;        // minute is UTC, otherwise the local time before it
+};
+
+struct TzRules {
+  TzRule start; // to daylight saving time
+  TzRule end;
+  int16_t save_minutes;
+};
+
+struct TzTransition {
+  time_t utc;
+  int32_t offset; // seconds, from this moment on
+};
+
+// Fields of struct tm that the UI shows
+struct CivilTime {
+  int16_t year;
+  uint8_t month; // 1-12
+  uint8_t day;   // 1-31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t weekday; // 0 is Sunday
+};
+
+/**
+ * @brief split a time into date and time of day, as gmtime() does, without
+ * the locks and time zone handling of the C library
+ */
+void civil_time(time_t t, CivilTime *civil);
+
+static const char *const civil_weekdays[] = {"Sun", "Mon", "Tue", "Wed",
+                                             "Thu", "Fri", "Sat"};
+static const char *const civil_months[] = {"Jan", "Feb", "Mar", "Apr",
+                                           "May", "Jun", "Jul", "Aug",
+                                           "Sep", "Oct", "Nov", "Dec"};
+
+/**
+ * The transitions of the next TZ_YEARS are kept in a table, and a cursor
+ * moves along it as time passes, so a lookup compares against the next
+ * transition only. Not thread-safe, keep it on the thread that reads the
+ * clock.
+ */
+class TimeZone {
+public:
+  TimeZone();
+
+  /**
+   * @brief use the rules of an IANA zone name such as "Europe/Oslo"
+   * @param fallback_offset seconds east of UTC, used when the zone is not
+   * in the table, and then fixed until the next call
+   * @return true when the zone's rules are known
+   */
+  bool set(const char *name, int32_t fallback_offset);
+
+  /**
+   * @return seconds to add to utc for the local time. Moving on to a later
+   * time is O(1), an earlier one redoes the table.
+   */
+  int32_t offset(time_t utc);
+
+  time_t local(time_t utc) { return utc + offset(utc); }
+
+  const char *name() const { return _name; }
+
+  /**
+   * @return the next transition, 0 when the offset is fixed or the table
+   * has run out
+   */
+  time_t next_transition() const;
+
+  /**
+   * @return times the table was worked out
+   */
+  uint32_t rebuilds() const { return _rebuilds; }
+
+private:
+  void rebuild(time_t utc);
+
+  char _name[TZ_NAME_SIZE];
+  int32_t _standard; // seconds east of UTC without DST
+  const TzRules *_rules;
+
+  TzTransition _transitions[TZ_TRANSITIONS];
+  size_t _count;
+  size_t _cursor;  // transitions passed
+  int32_t _before; // offset before the first transition
+  time_t _from;    // the table covers [_from, _until)
+  time_t _until;
+  uint32_t _rebuilds;
+};
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * @file tone_patterns.h
+ * @brief Buzzer sounds for ToneSequencer, compiled into flash
+ */
+#ifndef __TONE_PATTERNS_H__
+#define __TONE_PATTERNS_H__
+
+#include "tone_sequencer.h"
+
+// The piezo's resonance, where it is loudest
+#define TONE_BUZZER_HZ 2000
+
+// Four beeps, the last one fading out. Each round is louder than the one
+// before, from a fifth of full volume to full in five rounds.
+constexpr Note alarm_notes[] = {
+    ramp(TONE_BUZZER_HZ, 20, 0, TONE_MAX_DUTY),
+    tone(TONE_BUZZER_HZ, 100),
+    rest(100),
+    ramp(TONE_BUZZER_HZ, 20, 0, TONE_MAX_DUTY),
+    tone(TONE_BUZZER_HZ, 100),
+    rest(100),
+    ramp(TONE_BUZZER_HZ, 20, 0, TONE_MAX_DUTY),
+    tone(TONE_BUZZER_HZ, 100),
+    rest(100),
+    ramp(TONE_BUZZER_HZ, 300, TONE_MAX_DUTY, 0),
+    rest(600),
+};
+constexpr TonePattern ALARM_PATTERN = tone_pattern(alarm_notes, 0, 20, 20);
+static_assert(tone_pattern_valid(ALARM_PATTERN), "alarm_notes");
+
+// Rising chirp when the alarm time is confirmed
+constexpr Note confirm_notes[] = {
+    tone(TONE_BUZZER_HZ, 60, TONE_MAX_DUTY / 2),
+    rest(40),
+    tone(TONE_BUZZER_HZ * 5 / 4, 80, TONE_MAX_DUTY / 2),
+};
+constexpr TonePattern CONFIRM_PATTERN = tone_pattern(confirm_notes, 1);
+static_assert(tone_pattern_valid(CONFIRM_PATTERN), "confirm_notes");
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file tone_sequencer.cpp
+ * @brief Interrupt-driven note tables, see tone_sequencer.h
+ */
+#include "tone_sequencer.h"
+
+ToneSequencer::ToneSequencer(PwmOut *pwm)
+    : _pwm(pwm), _pattern(nullptr), _index(0), _repeat(0), _level(0),
+      _elapsed_ms(0), _frequency(0) {}
+
+void ToneSequencer::play(const TonePattern *pattern) {
+  // Once detached the interrupt cannot run, the state is ours
+  _timeout.detach();
+  _pattern = pattern;
+  _index = 0;
+  _repeat = 0;
+  _level = pattern->start_level;
+  start_note();
+}
+
+void ToneSequencer::stop() {
+  _timeout.detach();
+  _pattern = nullptr;
+  output(0, 0);
+}
+
+void ToneSequencer::start_note() {
+  _elapsed_ms = 0;
+  step();
+}
+
+void ToneSequencer::step() {
+  const TonePattern *pattern = _pattern;
+  if (pattern == nullptr) {
+    return;
+  }
+  const Note &note = pattern->notes[_index];
+
+  if (_elapsed_ms >= note.duration_ms) {
+    // Next note, or the pattern again a step louder
+    _index++;
+    if (_index == pattern->count) {
+      _index = 0;
+      _repeat++;
+      if (pattern->repeats != 0 && _repeat == pattern->repeats) {
+        stop();
+        return;
+      }
+      _level = _level + pattern->level_step < 100
+                   ? _level + pattern->level_step
+                   : 100;
+    }
+    start_note();
+    return;
+  }
+
+  int32_t duty = note.duty;
+  uint16_t wait_ms = note.duration_ms - _elapsed_ms;
+  if (note.duty_end != note.duty) {
+    duty += ((int32_t)note.duty_end - note.duty) * _elapsed_ms /
+            note.duration_ms;
+    if (wait_ms > TONE_RAMP_STEP_MS) {
+      wait_ms = TONE_RAMP_STEP_MS;
+    }
+  }
+  output(note.frequency, duty * _level / 100);
+
+  _elapsed_ms += wait_ms;
+  _timeout.attach(callback(this, &ToneSequencer::step),
+                  std::chrono::milliseconds(wait_ms));
+}
+
+void ToneSequencer::output(uint16_t frequency, uint32_t duty) {
+  if (frequency == 0 || duty == 0) {
+    _pwm->pulsewidth_us(0);
+    return;
+  }
+  uint32_t period_us = 1000000 / frequency;
+  if (frequency != _frequency) {
+    _pwm->period_us(period_us);
+    _frequency = frequency;
+  }
+  _pwm->pulsewidth_us(period_us * duty / 100);
+}
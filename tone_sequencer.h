@@ -0,0 +1,121 @@
+/**
+ * @file tone_sequencer.h
+ * @brief Plays note tables on a PwmOut from a chain of Timeout interrupts,
+ * with no allocation and no thread. The tables are constexpr and stay in
+ * flash.
+ */
+#ifndef __TONE_SEQUENCER_H__
+#define __TONE_SEQUENCER_H__
+
+#include "mbed.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A ramp changes the duty cycle this often
+#define TONE_RAMP_STEP_MS 10
+
+// A piezo is loudest at half the period
+#define TONE_MAX_DUTY 50
+
+struct Note {
+  uint16_t frequency; // Hz, 0 is a rest
+  uint16_t duration_ms;
+  uint8_t duty;     // percent of the period at the start of the note
+  uint8_t duty_end; // and at its end, in between it ramps linearly
+};
+
+constexpr Note tone(uint16_t frequency, uint16_t duration_ms,
+                    uint8_t duty = TONE_MAX_DUTY) {
+  return Note{frequency, duration_ms, duty, duty};
+}
+
+constexpr Note ramp(uint16_t frequency, uint16_t duration_ms, uint8_t from,
+                    uint8_t to) {
+  return Note{frequency, duration_ms, from, to};
+}
+
+constexpr Note rest(uint16_t duration_ms) {
+  return Note{0, duration_ms, 0, 0};
+}
+
+/*
+The notes are played repeats times, 0 is until stop(). The duty of every
+note is scaled by a level in percent, which starts at start_level and goes up
+by level_step each time the notes start over, so an alarm can begin quietly
+and get louder.
+*/
+struct TonePattern {
+  const Note *notes;
+  uint8_t count;
+  uint8_t repeats;
+  uint8_t start_level;
+  uint8_t level_step;
+};
+
+template <size_t N>
+constexpr TonePattern tone_pattern(const Note (&notes)[N], uint8_t repeats,
+                                   uint8_t start_level = 100,
+                                   uint8_t level_step = 0) {
+  static_assert(N > 0 && N < 256, "a pattern has 1 to 255 notes");
+  return TonePattern{notes, N, repeats, start_level, level_step};
+}
+
+/**
+ * @return true when every note can be played, for a static_assert next to the
+ * table
+ */
+constexpr bool tone_pattern_valid(const TonePattern &pattern) {
+  if (pattern.start_level > 100) {
+    return false;
+  }
+  for (size_t i = 0; i < pattern.count; i++) {
+    const Note &note = pattern.notes[i];
+    if (note.duration_ms == 0 || note.duty > TONE_MAX_DUTY ||
+        note.duty_end > TONE_MAX_DUTY ||
+        (note.frequency != 0 &&
+         (note.frequency < 20 || note.frequency > 20000))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * play() and stop() are called from a thread, everything else runs in the
+ * Timeout's interrupt. The PWM period is only written when the frequency
+ * changes, ramp steps only write the pulse width.
+ */
+class ToneSequencer {
+public:
+  explicit ToneSequencer(PwmOut *pwm);
+
+  /**
+   * @brief play a pattern from its first note, replacing whatever played
+   * @param pattern has to outlive the playback, e.g. a constexpr table
+   */
+  void play(const TonePattern *pattern);
+
+  /**
+   * @brief silence the output
+   */
+  void stop();
+
+  bool playing() const { return _pattern != nullptr; }
+
+private:
+  void start_note();
+  void step();
+  void output(uint16_t frequency, uint32_t duty);
+
+  PwmOut *_pwm;
+  Timeout _timeout;
+  const TonePattern *volatile _pattern;
+  uint8_t _index;
+  uint8_t _repeat;
+  uint8_t _level;
+  uint16_t _elapsed_ms; // into the current note
+  uint16_t _frequency;  // on the output, 0 when silent
+};
+
+#endif